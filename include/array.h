@@ -3,13 +3,438 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+
+#if !defined(ARRAY_NO_THREADS) && !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+#define ARRAY_HAS_THREADS 1
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+*   Bulk operations touching at least this many bytes are split across threads
+*   @note Define before including array.h to override
+*/
+#ifndef ARRAY_PARALLEL_THRESHOLD
+#define ARRAY_PARALLEL_THRESHOLD (16ull << 20)
+#endif
+
+/**
+*   Bulk writes of at least this many bytes use non-temporal stores, should be about the size of the last level cache
+*   @note Define before including array.h to override
+*/
+#ifndef ARRAY_NONTEMPORAL_THRESHOLD
+#define ARRAY_NONTEMPORAL_THRESHOLD (32ull << 20)
+#endif
+
+/**
+*   Upper bound on the number of threads used by bulk operations
+*   @note Define ARRAY_THREADS to force an exact thread count instead of the number of online cpus
+*/
+#ifndef ARRAY_MAX_THREADS
+#define ARRAY_MAX_THREADS 64
+#endif
+
+/**
+*   Number of elements ahead that batched accessors prefetch
+*   @note Define before including array.h to tune for the latency of the memory being accessed
+*/
+#ifndef ARRAY_PREFETCH_DISTANCE
+#define ARRAY_PREFETCH_DISTANCE 16
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ARRAY_PREFETCH(addr) __builtin_prefetch(addr, 0, 0)
+#define ARRAY_PREFETCH_WRITE(addr) __builtin_prefetch(addr, 1, 0)
+#else
+#define ARRAY_PREFETCH(addr) ((void)0)
+#define ARRAY_PREFETCH_WRITE(addr) ((void)0)
+#endif
+
+/* Index of the lowest set bit, x must not be 0 */
+static inline unsigned array__ctz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned n = 0;
+    for(; !(x & 1); x >>= 1) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
+/* Number of set bits */
+static inline unsigned array__popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (unsigned)((x * 0x0101010101010101ull) >> 56);
+#endif
+}
 
 typedef enum {
     ARRAY_OK_ERROR,
     ARRAY_OUT_OF_MEM,
-    ARRAY_OUT_OF_BOUNDS
+    ARRAY_OUT_OF_BOUNDS,
+    ARRAY_SIZE_MISMATCH,
+    ARRAY_INVALID_DATA,
+    ARRAY_IO_ERROR
 } array_error;
 
+typedef void (*array__task)(void* ctx, uint64_t begin, uint64_t end);
+
+typedef struct {
+    array__task task;
+    void* ctx;
+    uint64_t begin;
+    uint64_t end;
+} array__job;
+
+/**
+*   Gets the number of threads bulk operations may use
+*   @return Thread count between 1 and ARRAY_MAX_THREADS
+*/
+static inline unsigned array__thread_count(void) {
+#if defined(ARRAY_THREADS)
+    return ARRAY_THREADS;
+#elif defined(ARRAY_HAS_THREADS)
+    /* Worker threads may ask at the same time, they all store the same answer */
+    static unsigned count = 0;
+#if defined(__GNUC__) || defined(__clang__)
+    unsigned cached = __atomic_load_n(&count, __ATOMIC_RELAXED);
+#else
+    unsigned cached = count;
+#endif
+    if(cached == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        cached = online < 1 ? 1 : online > ARRAY_MAX_THREADS ? ARRAY_MAX_THREADS : (unsigned)online;
+#if defined(__GNUC__) || defined(__clang__)
+        __atomic_store_n(&count, cached, __ATOMIC_RELAXED);
+#else
+        count = cached;
+#endif
+    }
+    return cached;
+#else
+    return 1;
+#endif
+}
+
+static inline void* array__job_run(void* arg) {
+    array__job* job = arg;
+    job->task(job->ctx, job->begin, job->end);
+    return NULL;
+}
+
+/**
+*   Runs task over [0, n) split into one contiguous range per thread
+*   @param n Number of items
+*   @param grain Every range except the last starts and ends on a multiple of grain
+*   @param bytes Number of bytes touched, work below ARRAY_PARALLEL_THRESHOLD runs on the calling thread
+*   @param task Function called with ctx and a [begin, end) range
+*   @note Falls back to the calling thread if a thread cannot be created
+*/
+static inline void array__parallel_for(uint64_t n, uint64_t grain, uint64_t bytes, array__task task, void* ctx) {
+    unsigned threads = bytes < ARRAY_PARALLEL_THRESHOLD ? 1 : array__thread_count();
+    uint64_t chunk = (n + threads - 1) / threads;
+    chunk = (chunk + grain - 1) / grain * grain;
+    if(threads <= 1 || chunk >= n) {
+        if(n > 0) {
+            task(ctx, 0, n);
+        }
+        return;
+    }
+#if defined(ARRAY_HAS_THREADS)
+    array__job jobs[ARRAY_MAX_THREADS];
+    pthread_t ids[ARRAY_MAX_THREADS];
+    int started[ARRAY_MAX_THREADS];
+    unsigned count = 0;
+    for(uint64_t begin = 0; begin < n && count < ARRAY_MAX_THREADS; begin += chunk, ++count) {
+        jobs[count].task = task;
+        jobs[count].ctx = ctx;
+        jobs[count].begin = begin;
+        jobs[count].end = n - begin < chunk ? n : begin + chunk;
+    }
+    jobs[count - 1].end = n;
+    for(unsigned i = 1; i < count; ++i) {
+        started[i] = pthread_create(&ids[i], NULL, array__job_run, &jobs[i]) == 0;
+    }
+    array__job_run(&jobs[0]);
+    for(unsigned i = 1; i < count; ++i) {
+        if(started[i]) {
+            pthread_join(ids[i], NULL);
+        }
+        else {
+            array__job_run(&jobs[i]);
+        }
+    }
+#endif
+}
+
+/**
+*   Copies bytes with non-temporal stores so a large destination does not evict the cache
+*/
+static inline void array__stream_copy(void* dst, const void* src, uint64_t bytes) {
+    char* d = dst;
+    const char* s = src;
+#if defined(__SSE2__)
+    uint64_t head = (16 - ((uintptr_t)d & 15)) & 15;
+    if(bytes >= head + 64) {
+        memcpy(d, s, head);
+        d += head;
+        s += head;
+        bytes -= head;
+        for(; bytes >= 64; bytes -= 64, d += 64, s += 64) {
+            __m128i x0 = _mm_loadu_si128((const __m128i*)s);
+            __m128i x1 = _mm_loadu_si128((const __m128i*)(s + 16));
+            __m128i x2 = _mm_loadu_si128((const __m128i*)(s + 32));
+            __m128i x3 = _mm_loadu_si128((const __m128i*)(s + 48));
+            _mm_stream_si128((__m128i*)d, x0);
+            _mm_stream_si128((__m128i*)(d + 16), x1);
+            _mm_stream_si128((__m128i*)(d + 32), x2);
+            _mm_stream_si128((__m128i*)(d + 48), x3);
+        }
+        _mm_sfence();
+    }
+#endif
+    memcpy(d, s, bytes);
+}
+
+typedef struct {
+    char* dst;
+    const char* src;
+    size_t elem_size;
+    int nontemporal;
+} array__bulk;
+
+static inline void array__copy_task(void* ctx, uint64_t begin, uint64_t end) {
+    array__bulk* bulk = ctx;
+    if(bulk->nontemporal) {
+        array__stream_copy(bulk->dst + begin, bulk->src + begin, end - begin);
+    }
+    else {
+        memcpy(bulk->dst + begin, bulk->src + begin, end - begin);
+    }
+}
+
+/**
+*   Copies bytes between non-overlapping buffers, in parallel above ARRAY_PARALLEL_THRESHOLD
+*/
+static inline void array__copy_bytes(void* dst, const void* src, uint64_t bytes) {
+    array__bulk bulk = { dst, src, 1, bytes >= ARRAY_NONTEMPORAL_THRESHOLD };
+    array__parallel_for(bytes, 4096, bytes, array__copy_task, &bulk);
+}
+
+static inline void array__fill_task(void* ctx, uint64_t begin, uint64_t end) {
+    array__bulk* bulk = ctx;
+    size_t es = bulk->elem_size;
+    char* p = bulk->dst + begin * es;
+    uint64_t count = end - begin;
+    if(begin != 0) {
+        memcpy(p, bulk->dst, es);
+    }
+    /* Double a pattern of whole elements that stays in cache, then replicate it over the range */
+    uint64_t pattern = 4096 / es < 16 ? 16 : 4096 / es / 16 * 16;
+    if(pattern > count) {
+        pattern = count;
+    }
+    for(uint64_t filled = 1; filled < pattern; ) {
+        uint64_t n = filled < pattern - filled ? filled : pattern - filled;
+        memcpy(p + filled * es, p, n * es);
+        filled += n;
+    }
+    uint64_t pattern_bytes = pattern * es;
+    char* q = p + pattern_bytes;
+    char* last = p + count * es;
+#if defined(__SSE2__)
+    if(bulk->nontemporal && ((uintptr_t)p & 15) == 0 && (pattern_bytes & 15) == 0) {
+        for(; (uint64_t)(last - q) >= pattern_bytes; q += pattern_bytes) {
+            for(uint64_t off = 0; off < pattern_bytes; off += 16) {
+                _mm_stream_si128((__m128i*)(q + off), _mm_load_si128((const __m128i*)(p + off)));
+            }
+        }
+        _mm_sfence();
+    }
+#endif
+    for(; (uint64_t)(last - q) >= pattern_bytes; q += pattern_bytes) {
+        memcpy(q, p, pattern_bytes);
+    }
+    memcpy(q, p, last - q);
+}
+
+/**
+*   Replicates the element at buf[0] over the first count elements, in parallel above ARRAY_PARALLEL_THRESHOLD
+*/
+static inline void array__fill_elems(void* buf, size_t elem_size, uint64_t count) {
+    uint64_t bytes = count * elem_size;
+    if(elem_size == 1 && bytes < ARRAY_NONTEMPORAL_THRESHOLD) {
+        memset((char*)buf + 1, *(unsigned char*)buf, count - 1);
+        return;
+    }
+    array__bulk bulk = { buf, NULL, elem_size, bytes >= ARRAY_NONTEMPORAL_THRESHOLD };
+    array__parallel_for(count, 4096, bytes, array__fill_task, &bulk);
+}
+
+/**
+*   Finds the first index that is not below size, checking blocks branch free so the scan vectorizes
+*   @return Position of the first invalid index or n if all are valid
+*/
+static inline uint64_t array__first_invalid(const uint64_t* indices, uint64_t n, uint64_t size) {
+    uint64_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        int bad = 0;
+        for(uint64_t j = 0; j < 64; ++j) {
+            bad |= indices[i + j] >= size;
+        }
+        if(bad) {
+            break;
+        }
+    }
+    for(; i < n; ++i) {
+        if(indices[i] >= size) {
+            return i;
+        }
+    }
+    return n;
+}
+
+/**
+*   Gets the common size of arrays iterated together
+*   @return The common size, or 0 if any error state is set or the sizes differ
+*   @note Sets every error state to ARRAY_SIZE_MISMATCH when the sizes differ
+*/
+static inline uint64_t array__zip_size(array_error* errors[], const uint64_t sizes[], unsigned count) {
+    for(unsigned i = 0; i < count; ++i) {
+        if(*errors[i] != ARRAY_OK_ERROR) {
+            return 0;
+        }
+    }
+    for(unsigned i = 1; i < count; ++i) {
+        if(sizes[i] != sizes[0]) {
+            for(unsigned j = 0; j < count; ++j) {
+                *errors[j] = ARRAY_SIZE_MISMATCH;
+            }
+            return 0;
+        }
+    }
+    return sizes[0];
+}
+
+/**
+*   Finds the first byte where two buffers differ, comparing a word at a time
+*   @return Offset of the first differing byte or bytes if the buffers are equal
+*/
+static inline uint64_t array__mismatch(const void* a, const void* b, uint64_t bytes) {
+    const unsigned char* x = a;
+    const unsigned char* y = b;
+    uint64_t i = 0;
+    for(; i + 64 <= bytes; i += 64) {
+        if(memcmp(x + i, y + i, 64) != 0) {
+            break;
+        }
+    }
+    for(; i < bytes && x[i] == y[i]; ++i) {
+    }
+    return i;
+}
+
+typedef struct array_hook array_hook;
+
+/**
+*   Observer attached to an array with array_attach_hook, called around every change made through the array macros
+*   @note before is called with the old contents while elements [begin, end) are about to be overwritten or removed
+*   @note after is called once elements [begin, end) hold their new values and size is the new size
+*   @note Either callback may be NULL, writes through buf or array_foreach_ptr are not observed
+*/
+struct array_hook {
+    void (*before)(array_hook* hook, const void* buf, uint64_t begin, uint64_t end);
+    void (*after)(array_hook* hook, const void* buf, uint64_t begin, uint64_t end, uint64_t size);
+    array_hook* next;
+};
+
+static inline void array__notify_before(array_hook* hook, const void* buf, uint64_t begin, uint64_t end) {
+    for(; hook; hook = hook->next) {
+        if(hook->before && begin < end) {
+            hook->before(hook, buf, begin, end);
+        }
+    }
+}
+
+static inline void array__notify_after(array_hook* hook, const void* buf, uint64_t begin, uint64_t end, uint64_t size) {
+    for(; hook; hook = hook->next) {
+        if(hook->after) {
+            hook->after(hook, buf, begin, end, size);
+        }
+    }
+}
+
+#define array__before(array_struct, begin, end) do { \
+        if(array_struct.hooks) { \
+            array__notify_before(array_struct.hooks, array_struct.buf, begin, end); \
+        } \
+    } while(0)
+
+#define array__after(array_struct, begin, end) do { \
+        if(array_struct.hooks) { \
+            array__notify_after(array_struct.hooks, array_struct.buf, begin, end, array_struct.size); \
+        } \
+    } while(0)
+
+typedef struct array_allocator array_allocator;
+
+/**
+*   Source of the memory behind buf for arrays that do not live on the heap, set with array_set_allocator
+*   @note resize behaves like realloc, old_bytes is the size of the current block and buf may be NULL
+*   @note release is called by array_free with the size of the block
+*/
+struct array_allocator {
+    void* (*resize)(array_allocator* alloc, void* buf, uint64_t old_bytes, uint64_t new_bytes);
+    void (*release)(array_allocator* alloc, void* buf, uint64_t bytes);
+};
+
+/**
+*   Resizes the block behind buf, every growth and shrink of an array goes through here
+*/
+static inline void* array__realloc(array_allocator* alloc, void* buf, uint64_t old_bytes, uint64_t new_bytes) {
+    return alloc ? alloc->resize(alloc, buf, old_bytes, new_bytes) : realloc(buf, new_bytes);
+}
+
+/**
+*   Grows a block of capacity elements of es bytes to hold at least need elements, doubling it when memory
+*   allows and otherwise retrying with halved increments down to exactly need
+*   @return The block, NULL when not even need elements fit, capacity is only updated on success
+*/
+static inline void* array__grow(array_allocator* alloc, void* buf, uint64_t es, uint64_t* capacity, uint64_t need) {
+    for(uint64_t step = *capacity > 0 ? *capacity : 1; ; step /= 2) {
+        uint64_t target = *capacity + step > need ? *capacity + step : need;
+        void* temp = array__realloc(alloc, buf, es * *capacity, es * target);
+        if(temp) {
+            *capacity = target;
+            return temp;
+        }
+        if(target == need) {
+            return NULL;
+        }
+    }
+}
+
+static inline void array__release(array_allocator* alloc, void* buf, uint64_t bytes) {
+    if(alloc) {
+        alloc->release(alloc, buf, bytes);
+    }
+    else {
+        free(buf);
+    }
+}
+
 /** 
 *   Creates a struct that stores the state of a dynamically resizable array
 *   @param T Type stored in array struct
@@ -22,6 +447,8 @@ typedef enum {
         uint64_t size; \
         uint64_t min_capacity; \
         array_error error; \
+        array_hook* hooks; \
+        array_allocator* alloc; \
     }
 
 /** 
@@ -35,6 +462,8 @@ typedef enum {
 *   @example array_init(char, a, 10);
 */ 
 #define array_init(T, array_struct, init_capacity) do { \
+        array_struct.hooks = NULL; \
+        array_struct.alloc = NULL; \
         array_struct.buf = calloc(init_capacity, sizeof(T)); \
         if(array_struct.buf) { \
             array_struct.size = 0; \
@@ -52,15 +481,16 @@ typedef enum {
 *   @param T Type stored in array struct
 *   @param array_struct Array struct to add to
 *   @param val Value to store
+*   @note Doubles the capacity when full, or grows it by less when memory is short
 *   @note Will not execute if error state is not ARRAY_OK_ERROR
-*   @note Can modify error state to ARRAY_OUT_OF_MEM
+*   @note Can modify error state to ARRAY_OUT_OF_MEM, the array then keeps its values and capacity
 *   @example array_add(char, a, 'a');
 */
 #define array_add(T, array_struct, val) do { \
         if(array_struct.error == ARRAY_OK_ERROR) { \
             if(array_struct.size == array_struct.capacity) { \
-                array_struct.capacity *= 2; \
-                T* temp = realloc(array_struct.buf, sizeof(T) * array_struct.capacity); \
+                T* temp = array__grow(array_struct.alloc, array_struct.buf, sizeof(T), &array_struct.capacity, \
+                    array_struct.size + 1); \
                 if(!temp) { \
                     array_struct.error = ARRAY_OUT_OF_MEM; \
                     break; \
@@ -68,6 +498,7 @@ typedef enum {
                 array_struct.buf = temp; \
             } \
             array_struct.buf[array_struct.size++] = val; \
+            array__after(array_struct, array_struct.size - 1, array_struct.size); \
         } \
     } while(0)
 
@@ -84,8 +515,8 @@ typedef enum {
 #define array_add_index(T, array_struct, index, val) do { \
         if(array_struct.error == ARRAY_OK_ERROR) { \
             if(array_struct.size == array_struct.capacity) { \
-                array_struct.capacity *= 2; \
-                T* temp = realloc(array_struct.buf, sizeof(T) * array_struct.capacity); \
+                T* temp = array__grow(array_struct.alloc, array_struct.buf, sizeof(T), &array_struct.capacity, \
+                    array_struct.size + 1); \
                 if(!temp) { \
                     array_struct.error = ARRAY_OUT_OF_MEM; \
                     break; \
@@ -93,11 +524,13 @@ typedef enum {
                 array_struct.buf = temp; \
             } \
             if(0 <= index && index <= array_struct.size) { \
+                array__before(array_struct, index, array_struct.size); \
                 array_struct.size++; \
                 for(uint64_t i = array_struct.size - 1; index < i; --i) { \
                     array_struct.buf[i] = array_struct.buf[i - 1]; \
                 } \
                 array_struct.buf[index] = val; \
+                array__after(array_struct, index, array_struct.size); \
             } \
             else { \
                 array_struct.error = ARRAY_OUT_OF_BOUNDS; \
@@ -117,7 +550,9 @@ typedef enum {
 #define array_set(array_struct, index, val) do { \
         if(array_struct.error == ARRAY_OK_ERROR) { \
             if(0 <= index && index < array_struct.size) { \
+                array__before(array_struct, index, (index) + 1); \
                 array_struct.buf[index] = val; \
+                array__after(array_struct, index, (index) + 1); \
             } \
             else { \
                 array_struct.error = ARRAY_OUT_OF_BOUNDS; \
@@ -149,25 +584,103 @@ typedef enum {
         } \
     } while(0)
 
+/**
+*   Finds the first out of bounds entry in a list of indices
+*   @param array_struct Array struct the indices refer to
+*   @param indices Pointer to n uint64_t indices
+*   @param n Number of indices
+*   @return Position in indices of the first out of bounds entry, or n if every index is valid
+*   @example uint64_t bad = array_check_indices(a, idx, n);
+*/
+#define array_check_indices(array_struct, indices, n) array__first_invalid(indices, n, array_struct.size)
+
+/**
+*   Gets the values at many indices, prefetching ARRAY_PREFETCH_DISTANCE indices ahead
+*   @param array_struct Array struct to get from
+*   @param indices Pointer to n uint64_t indices
+*   @param n Number of indices
+*   @param out Pointer to n elements where the values are stored in the order of indices
+*   @note All indices are validated before any value is read, use array_check_indices to locate the bad one
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_BOUNDS
+*   @example array_gather(a, idx, n, values);
+*/
+#define array_gather(array_struct, indices, n, out) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            if(array__first_invalid(indices, n, array_struct.size) != (n)) { \
+                array_struct.error = ARRAY_OUT_OF_BOUNDS; \
+                break; \
+            } \
+            uint64_t array__i = 0; \
+            for(; array__i + ARRAY_PREFETCH_DISTANCE < (n); ++array__i) { \
+                ARRAY_PREFETCH(array_struct.buf + (indices)[array__i + ARRAY_PREFETCH_DISTANCE]); \
+                (out)[array__i] = array_struct.buf[(indices)[array__i]]; \
+            } \
+            for(; array__i < (n); ++array__i) { \
+                (out)[array__i] = array_struct.buf[(indices)[array__i]]; \
+            } \
+        } \
+    } while(0)
+
+/**
+*   Overwrites the values at many indices, prefetching ARRAY_PREFETCH_DISTANCE indices ahead
+*   @param array_struct Array struct to modify
+*   @param indices Pointer to n uint64_t indices
+*   @param values Pointer to n values, values[i] is written at indices[i]
+*   @param n Number of indices
+*   @note All indices are validated before any value is written, use array_check_indices to locate the bad one
+*   @note Duplicate indices keep the last value written
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_BOUNDS
+*   @example array_scatter(a, idx, values, n);
+*/
+#define array_scatter(array_struct, indices, values, n) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            if(array__first_invalid(indices, n, array_struct.size) != (n)) { \
+                array_struct.error = ARRAY_OUT_OF_BOUNDS; \
+                break; \
+            } \
+            uint64_t array__i = 0; \
+            if(array_struct.hooks) { \
+                for(; array__i < (n); ++array__i) { \
+                    array__before(array_struct, (indices)[array__i], (indices)[array__i] + 1); \
+                    array_struct.buf[(indices)[array__i]] = (values)[array__i]; \
+                    array__after(array_struct, (indices)[array__i], (indices)[array__i] + 1); \
+                } \
+            } \
+            for(; array__i + ARRAY_PREFETCH_DISTANCE < (n); ++array__i) { \
+                ARRAY_PREFETCH_WRITE(array_struct.buf + (indices)[array__i + ARRAY_PREFETCH_DISTANCE]); \
+                array_struct.buf[(indices)[array__i]] = (values)[array__i]; \
+            } \
+            for(; array__i < (n); ++array__i) { \
+                array_struct.buf[(indices)[array__i]] = (values)[array__i]; \
+            } \
+        } \
+    } while(0)
+
 /**
 *   Removes value at tail
 *   @param T Type stored in array struct
 *   @param array_struct Array struct to be removed from
+*   @note Halves the capacity when the size drops to half of it, the capacity is kept if that fails
 *   @note Will not execute if error state is not ARRAY_OK_ERROR
-*   @note Can modify error state to ARRAY_OUT_OF_MEM or ARRAY_OUT_OF_BOUNDS
+*   @note Can modify error state to ARRAY_OUT_OF_BOUNDS
 *   @example array_remove(char, a);
 */
 #define array_remove(T, array_struct) do { \
         if(array_struct.error == ARRAY_OK_ERROR) { \
             if(array_struct.size > 0) { \
-                if(--(array_struct.size) == array_struct.capacity / 2 && array_struct.capacity != array_struct.min_capacity) { \
-                    array_struct.capacity /= 2; \
-                    T* temp = realloc(array_struct.buf, sizeof(T) * array_struct.capacity); \
-                    if(!temp) { \
-                        array_struct.error = ARRAY_OUT_OF_MEM; \
-                        break; \
+                array__before(array_struct, array_struct.size - 1, array_struct.size); \
+                --(array_struct.size); \
+                array__after(array_struct, array_struct.size, array_struct.size); \
+                if(array_struct.size == array_struct.capacity / 2 && array_struct.capacity / 2 >= array_struct.min_capacity) { \
+                    T* temp = array__realloc(array_struct.alloc, array_struct.buf, sizeof(T) * array_struct.capacity, \
+                        sizeof(T) * (array_struct.capacity / 2)); \
+                    /* A failed shrink keeps the old block, which still holds every value */ \
+                    if(temp) { \
+                        array_struct.buf = temp; \
+                        array_struct.capacity /= 2; \
                     } \
-                    array_struct.buf = temp; \
                 } \
             } \
             else { \
@@ -181,24 +694,28 @@ typedef enum {
 *   @param T Type stored in array struct
 *   @param array_struct Array struct to be removed from
 *   @param index Index to remove value at
+*   @note Halves the capacity when the size drops to half of it, the capacity is kept if that fails
 *   @note Will not execute if error state is not ARRAY_OK_ERROR
-*   @note Can modify error state to ARRAY_OUT_OF_MEM or ARRAY_OUT_OF_BOUNDS
+*   @note Can modify error state to ARRAY_OUT_OF_BOUNDS
 *   @example array_remove_index(char, a, 0);
 */
 #define array_remove_index(T, array_struct, index) do { \
         if(array_struct.error == ARRAY_OK_ERROR) { \
             if(array_struct.size > 0 && 0 <= index && index < array_struct.size) { \
+                array__before(array_struct, index, array_struct.size); \
                 for(uint64_t i = index; i < array_struct.size - 1; ++i) { \
                     array_struct.buf[i] = array_struct.buf[i + 1]; \
                 } \
-                if(--(array_struct.size) == array_struct.capacity / 2 && array_struct.capacity != array_struct.min_capacity) { \
-                    array_struct.capacity /= 2; \
-                    T* temp = realloc(array_struct.buf, sizeof(T) * array_struct.capacity); \
-                    if(!temp) { \
-                        array_struct.error = ARRAY_OUT_OF_MEM; \
-                        break; \
+                --(array_struct.size); \
+                array__after(array_struct, index, array_struct.size); \
+                if(array_struct.size == array_struct.capacity / 2 && array_struct.capacity / 2 >= array_struct.min_capacity) { \
+                    T* temp = array__realloc(array_struct.alloc, array_struct.buf, sizeof(T) * array_struct.capacity, \
+                        sizeof(T) * (array_struct.capacity / 2)); \
+                    /* A failed shrink keeps the old block, which still holds every value */ \
+                    if(temp) { \
+                        array_struct.buf = temp; \
+                        array_struct.capacity /= 2; \
                     } \
-                    array_struct.buf = temp; \
                 } \
             } \
             else { \
@@ -207,6 +724,337 @@ typedef enum {
         } \
     } while(0)
 
+/**
+*   Grows the capacity to exactly new_capacity elements if it is currently smaller
+*   @param T Type stored in array struct
+*   @param array_struct Array struct to grow
+*   @param new_capacity Number of elements the array must be able to hold
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM
+*   @example array_reserve(char, a, 1024);
+*/
+#define array_reserve(T, array_struct, new_capacity) do { \
+        if(array_struct.error == ARRAY_OK_ERROR && array_struct.capacity < (new_capacity)) { \
+            T* temp = array__realloc(array_struct.alloc, array_struct.buf, sizeof(T) * array_struct.capacity, \
+                sizeof(T) * (new_capacity)); \
+            if(!temp) { \
+                array_struct.error = ARRAY_OUT_OF_MEM; \
+                break; \
+            } \
+            array_struct.buf = temp; \
+            array_struct.capacity = (new_capacity); \
+        } \
+    } while(0)
+
+/**
+*   Replaces the contents of the array with count copies of val
+*   @param T Type stored in array struct
+*   @param array_struct Array struct to fill
+*   @param count Number of elements the array holds afterwards
+*   @param val Value to store in every element
+*   @note Grows the capacity to exactly count when it is too small
+*   @note Splits the work across threads above ARRAY_PARALLEL_THRESHOLD bytes
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM
+*   @example array_fill(char, a, 100, ' ');
+*/
+#define array_fill(T, array_struct, count, val) do { \
+        array_reserve(T, array_struct, count); \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            array__before(array_struct, 0, array_struct.size); \
+            array_struct.size = (count); \
+            if(array_struct.size > 0) { \
+                array_struct.buf[0] = val; \
+                array__fill_elems(array_struct.buf, sizeof(T), array_struct.size); \
+            } \
+            array__after(array_struct, 0, array_struct.size); \
+        } \
+    } while(0)
+
+/**
+*   Replaces the contents of an initialized array with the contents of another
+*   @param T Type stored in both array structs
+*   @param dst_struct Array struct to copy into
+*   @param src_struct Array struct to copy from
+*   @note Grows the capacity of dst_struct to exactly the size of src_struct when it is too small
+*   @note Splits the work across threads above ARRAY_PARALLEL_THRESHOLD bytes
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_copy(char, b, a);
+*/
+#define array_copy(T, dst_struct, src_struct) do { \
+        if(src_struct.error == ARRAY_OK_ERROR && dst_struct.buf != src_struct.buf) { \
+            array_reserve(T, dst_struct, src_struct.size); \
+            if(dst_struct.error == ARRAY_OK_ERROR) { \
+                array__before(dst_struct, 0, dst_struct.size); \
+                array__copy_bytes(dst_struct.buf, src_struct.buf, sizeof(T) * src_struct.size); \
+                dst_struct.size = src_struct.size; \
+                array__after(dst_struct, 0, dst_struct.size); \
+            } \
+        } \
+    } while(0)
+
+/**
+*   Initializes an array as a copy of another, with capacity for exactly its elements or its minimum capacity
+*   @param T Type stored in both array structs
+*   @param dst_struct Array struct to initialize
+*   @param src_struct Array struct to copy from
+*   @warning The buf is stored in the heap and needs to be released by array_free
+*   @note Splits the work across threads above ARRAY_PARALLEL_THRESHOLD bytes
+*   @note dst_struct takes the error state of src_struct if it is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_clone(char, b, a);
+*/
+#define array_clone(T, dst_struct, src_struct) do { \
+        dst_struct.buf = NULL; \
+        dst_struct.size = 0; \
+        dst_struct.capacity = 0; \
+        dst_struct.min_capacity = src_struct.min_capacity; \
+        dst_struct.error = src_struct.error; \
+        dst_struct.hooks = NULL; \
+        dst_struct.alloc = NULL; \
+        if(dst_struct.error == ARRAY_OK_ERROR) { \
+            dst_struct.capacity = src_struct.size > src_struct.min_capacity ? src_struct.size : src_struct.min_capacity; \
+            dst_struct.capacity = dst_struct.capacity > 0 ? dst_struct.capacity : 1; \
+            dst_struct.buf = malloc(sizeof(T) * dst_struct.capacity); \
+            if(!dst_struct.buf) { \
+                dst_struct.error = ARRAY_OUT_OF_MEM; \
+                break; \
+            } \
+            array__copy_bytes(dst_struct.buf, src_struct.buf, sizeof(T) * src_struct.size); \
+            dst_struct.size = src_struct.size; \
+        } \
+    } while(0)
+
+/**
+*   Loops over every value in the array from head to tail
+*   @param T Type stored in array struct
+*   @param var Name of the variable holding a copy of the current value
+*   @param array_struct Array struct to iterate over
+*   @warning The buf and size are read once, the body must not add or remove values
+*   @note Every loop variable gets its own declaration, so T can be a pointer type, and break leaves the whole loop
+*   @note Does not iterate if error state is not ARRAY_OK_ERROR
+*   @example array_foreach(int, x, a) { sum += x; }
+*/
+#define array_foreach(T, var, array_struct) \
+    for(T* array__end_##var = array_struct.buf + (array_struct.error == ARRAY_OK_ERROR ? array_struct.size : 0); \
+        array__end_##var; array__end_##var = NULL) \
+    for(T* array__p_##var = array_struct.buf; array__p_##var; array__p_##var = NULL) \
+    for(T var; array__p_##var < array__end_##var && (var = *array__p_##var, 1); ++array__p_##var)
+
+/**
+*   Loops over a pointer to every value in the array from head to tail
+*   @param T Type stored in array struct
+*   @param ptr Name of the pointer to the current value
+*   @param array_struct Array struct to iterate over
+*   @warning The buf and size are read once, the body must not add or remove values
+*   @note Does not iterate if error state is not ARRAY_OK_ERROR
+*   @example array_foreach_ptr(int, p, a) { *p *= 2; }
+*/
+#define array_foreach_ptr(T, ptr, array_struct) \
+    for(T* array__end_##ptr = array_struct.buf + (array_struct.error == ARRAY_OK_ERROR ? array_struct.size : 0); \
+        array__end_##ptr; array__end_##ptr = NULL) \
+    for(T* ptr = array_struct.buf; ptr < array__end_##ptr; ++ptr)
+
+/**
+*   Loops over every value in the array from tail to head
+*   @param T Type stored in array struct
+*   @param var Name of the variable holding a copy of the current value
+*   @param array_struct Array struct to iterate over
+*   @warning The buf and size are read once, the body must not add or remove values
+*   @note Does not iterate if error state is not ARRAY_OK_ERROR
+*   @example array_foreach_reverse(char, c, a) { putchar(c); }
+*/
+#define array_foreach_reverse(T, var, array_struct) \
+    for(T* array__begin_##var = array_struct.buf; array__begin_##var; array__begin_##var = NULL) \
+    for(T* array__p_##var = array_struct.buf + (array_struct.error == ARRAY_OK_ERROR ? array_struct.size : 0); \
+        array__p_##var; array__p_##var = NULL) \
+    for(T var; array__p_##var > array__begin_##var && (var = *--array__p_##var, 1); )
+
+/**
+*   Loops over a pointer to every value in the array from tail to head
+*   @param T Type stored in array struct
+*   @param ptr Name of the pointer to the current value
+*   @param array_struct Array struct to iterate over
+*   @warning The buf and size are read once, the body must not add or remove values
+*   @note Does not iterate if error state is not ARRAY_OK_ERROR
+*   @example array_foreach_ptr_reverse(int, p, a) { *p = 0; }
+*/
+#define array_foreach_ptr_reverse(T, ptr, array_struct) \
+    for(T* array__begin_##ptr = array_struct.buf; array__begin_##ptr; array__begin_##ptr = NULL) \
+    for(T* ptr = array_struct.buf + (array_struct.error == ARRAY_OK_ERROR ? array_struct.size : 0); \
+        ptr-- > array__begin_##ptr; )
+
+/**
+*   Loops over an index into two arrays of the same size
+*   @param i Name of the uint64_t index variable
+*   @param a_struct First array struct
+*   @param b_struct Second array struct
+*   @warning The sizes are read once, the body must not add or remove values
+*   @note Does not iterate if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of both arrays to ARRAY_SIZE_MISMATCH
+*   @example array_foreach_zip(i, x, y) { y.buf[i] += 2 * x.buf[i]; }
+*/
+#define array_foreach_zip(i, a_struct, b_struct) \
+    for(uint64_t i = 0, array__n_##i = array__zip_size((array_error*[]){ &a_struct.error, &b_struct.error }, \
+            (uint64_t[]){ a_struct.size, b_struct.size }, 2); \
+        i < array__n_##i; ++i)
+
+/**
+*   Loops over an index into three arrays of the same size
+*   @param i Name of the uint64_t index variable
+*   @param a_struct First array struct
+*   @param b_struct Second array struct
+*   @param c_struct Third array struct
+*   @warning The sizes are read once, the body must not add or remove values
+*   @note Does not iterate if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of all the arrays to ARRAY_SIZE_MISMATCH
+*   @example array_foreach_zip3(i, x, y, z) { z.buf[i] = x.buf[i] * y.buf[i]; }
+*/
+#define array_foreach_zip3(i, a_struct, b_struct, c_struct) \
+    for(uint64_t i = 0, array__n_##i = array__zip_size((array_error*[]){ &a_struct.error, &b_struct.error, &c_struct.error }, \
+            (uint64_t[]){ a_struct.size, b_struct.size, c_struct.size }, 3); \
+        i < array__n_##i; ++i)
+
+/**
+*   Loops over an index into four arrays of the same size
+*   @param i Name of the uint64_t index variable
+*   @param a_struct First array struct
+*   @param b_struct Second array struct
+*   @param c_struct Third array struct
+*   @param d_struct Fourth array struct
+*   @warning The sizes are read once, the body must not add or remove values
+*   @note Does not iterate if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of all the arrays to ARRAY_SIZE_MISMATCH
+*   @example array_foreach_zip4(i, x, y, z, w) { w.buf[i] = x.buf[i] * y.buf[i] + z.buf[i]; }
+*/
+#define array_foreach_zip4(i, a_struct, b_struct, c_struct, d_struct) \
+    for(uint64_t i = 0, array__n_##i = array__zip_size( \
+            (array_error*[]){ &a_struct.error, &b_struct.error, &c_struct.error, &d_struct.error }, \
+            (uint64_t[]){ a_struct.size, b_struct.size, c_struct.size, d_struct.size }, 4); \
+        i < array__n_##i; ++i)
+
+/**
+*   Checks whether two arrays have the same size and the same bytes in every element
+*   @param a_struct First array struct
+*   @param b_struct Second array struct
+*   @return Nonzero if the arrays are equal
+*   @warning Only meaningful for element types without padding whose equality is bitwise, use array_equal_by otherwise
+*   @example if(array_equal(a, b)) { ... }
+*/
+#define array_equal(a_struct, b_struct) \
+    (a_struct.size == b_struct.size && \
+        (a_struct.size == 0 || memcmp(a_struct.buf, b_struct.buf, sizeof(*a_struct.buf) * a_struct.size) == 0))
+
+/**
+*   Checks whether two arrays have the same size and equal elements according to a comparison function
+*   @param a_struct First array struct
+*   @param b_struct Second array struct
+*   @param cmp Function taking pointers to two elements and returning 0 when they are equal
+*   @param ret_val Where nonzero is stored if the arrays are equal and zero otherwise
+*   @example array_equal_by(a, b, point_cmp, same);
+*/
+#define array_equal_by(a_struct, b_struct, cmp, ret_val) do { \
+        ret_val = a_struct.size == b_struct.size; \
+        for(uint64_t array__i = 0; ret_val && array__i < a_struct.size; ++array__i) { \
+            ret_val = cmp(&a_struct.buf[array__i], &b_struct.buf[array__i]) == 0; \
+        } \
+    } while(0)
+
+/**
+*   Compares two arrays of an integer or char type lexicographically
+*   @param a_struct First array struct
+*   @param b_struct Second array struct
+*   @param ret_val Where -1, 0 or 1 is stored when a_struct is less than, equal to or greater than b_struct
+*   @note Skips the common prefix with word sized compares before comparing the first differing element with <
+*   @warning Only meaningful for element types whose equality is bitwise, use array_compare_by otherwise
+*   @example int order; array_compare(a, b, order);
+*/
+#define array_compare(a_struct, b_struct, ret_val) do { \
+        uint64_t array__n = a_struct.size < b_struct.size ? a_struct.size : b_struct.size; \
+        uint64_t array__i = array__n == 0 ? 0 : \
+            array__mismatch(a_struct.buf, b_struct.buf, sizeof(*a_struct.buf) * array__n) / sizeof(*a_struct.buf); \
+        if(array__i < array__n) { \
+            ret_val = a_struct.buf[array__i] < b_struct.buf[array__i] ? -1 : 1; \
+        } \
+        else { \
+            ret_val = a_struct.size < b_struct.size ? -1 : a_struct.size > b_struct.size; \
+        } \
+    } while(0)
+
+/**
+*   Compares two arrays lexicographically according to a comparison function
+*   @param a_struct First array struct
+*   @param b_struct Second array struct
+*   @param cmp Function taking pointers to two elements and returning a negative, zero or positive int like qsort
+*   @param ret_val Where -1, 0 or 1 is stored when a_struct is less than, equal to or greater than b_struct
+*   @example int order; array_compare_by(a, b, point_cmp, order);
+*/
+#define array_compare_by(a_struct, b_struct, cmp, ret_val) do { \
+        uint64_t array__n = a_struct.size < b_struct.size ? a_struct.size : b_struct.size; \
+        int array__c = 0; \
+        for(uint64_t array__i = 0; array__c == 0 && array__i < array__n; ++array__i) { \
+            array__c = cmp(&a_struct.buf[array__i], &b_struct.buf[array__i]); \
+        } \
+        if(array__c == 0) { \
+            array__c = a_struct.size < b_struct.size ? -1 : a_struct.size > b_struct.size; \
+        } \
+        ret_val = array__c < 0 ? -1 : array__c > 0; \
+    } while(0)
+
+/**
+*   Attaches an observer that is told about every change made through the array macros
+*   @param array_struct Array struct to observe
+*   @param hook Pointer to an array_hook that stays valid until it is detached
+*   @note Hooks attached later are called first
+*   @example array_attach_hook(a, &tracker.hook);
+*/
+#define array_attach_hook(array_struct, hook) do { \
+        (hook)->next = array_struct.hooks; \
+        array_struct.hooks = (hook); \
+    } while(0)
+
+/**
+*   Detaches an observer attached with array_attach_hook
+*   @param array_struct Array struct being observed
+*   @param hook Pointer to the array_hook to detach, nothing happens if it is not attached
+*   @example array_detach_hook(a, &tracker.hook);
+*/
+#define array_detach_hook(array_struct, hook) do { \
+        for(array_hook** array__link = &array_struct.hooks; *array__link; array__link = &(*array__link)->next) { \
+            if(*array__link == (hook)) { \
+                *array__link = (hook)->next; \
+                break; \
+            } \
+        } \
+    } while(0)
+
+/**
+*   Moves the buffer of an empty array to memory from an allocator, all later growth and shrinking goes through it
+*   @param array_struct Initialized array struct without values
+*   @param allocator Pointer to an array_allocator that stays valid until array_free
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM or ARRAY_SIZE_MISMATCH if the array holds values
+*   @example array_set_allocator(a, &arena.alloc);
+*/
+#define array_set_allocator(array_struct, allocator) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            if(array_struct.size > 0) { \
+                array_struct.error = ARRAY_SIZE_MISMATCH; \
+                break; \
+            } \
+            array_allocator* array__alloc = (allocator); \
+            void* array__buf = array__realloc(array__alloc, NULL, 0, sizeof(*array_struct.buf) * array_struct.capacity); \
+            if(!array__buf) { \
+                array_struct.error = ARRAY_OUT_OF_MEM; \
+                break; \
+            } \
+            array__release(array_struct.alloc, array_struct.buf, sizeof(*array_struct.buf) * array_struct.capacity); \
+            array_struct.buf = array__buf; \
+            array_struct.alloc = array__alloc; \
+        } \
+    } while(0)
+
 /** 
 * Gets the current array size
 * @param array_struct Array struct to return size of
@@ -223,14 +1071,26 @@ typedef enum {
 */
 #define array_error(array_struct) array_struct.error
 
+/**
+* Resets the error state so the array accepts operations again, for example once memory was freed elsewhere
+* @param array_struct Array struct to recover
+* @note Failed operations leave the values, size and capacity of the array as they were before them
+* @warning Not for an array whose array_init failed, it has no buffer
+* @example if(array_error(a) == ARRAY_OUT_OF_MEM) { release_caches(); array_clear_error(a); }
+*/
+#define array_clear_error(array_struct) do { \
+        array_struct.error = ARRAY_OK_ERROR; \
+    } while(0)
+
 /**
 * Attempts to free the array from the heap
 * @param array_struct Array struct to free the buffer of
+* @note Arrays with an allocator hand the buffer back to it instead
 * @example array_free(a);
 */
 #define array_free(array_struct) do { \
         if(array_struct.buf != NULL) { \
-            free(array_struct.buf); \
+            array__release(array_struct.alloc, array_struct.buf, sizeof(*array_struct.buf) * array_struct.capacity); \
         } \
     } while(0)
     
@@ -0,0 +1,364 @@
+#ifndef ARRAY_AGGREGATE_H
+#define ARRAY_AGGREGATE_H
+
+#include <math.h>
+#include "array.h"
+
+/*
+*   An aggregate keeps the sum, count, min and max of an array up to date as the array macros change
+*   it. The sum and count are adjusted in O(1) per changed element, min and max come from a segment
+*   tree whose root is read in O(1) and which is repaired in O(log n) per changed element.
+*
+*   The segment tree stores 64 bit words and orders them with the min and max functions it is given,
+*   so array_range.h builds its int64_t index on the same tree.
+*
+*   array_aggregate stats;
+*   array_track_aggregate(a, &stats);
+*   array_set(a, 3, 42);
+*   double peak = array_aggregate_max(&stats);
+*/
+
+typedef uint64_t (*array__tree_combine)(uint64_t a, uint64_t b);
+
+/* Bottom-up segment tree kept as two flat arrays with the leaves last, node n has children 2n and 2n + 1 */
+typedef struct {
+    uint64_t* mins;
+    uint64_t* maxs;
+    uint64_t leaves;
+    array__tree_combine min;
+    array__tree_combine max;
+    uint64_t min_empty;
+    uint64_t max_empty;
+} array__tree;
+
+typedef struct {
+    array_hook hook;
+    double (*value)(const void* buf, uint64_t index);
+    double sum;
+    double sum_err;
+    uint64_t count;
+    array__tree tree;
+    array_error error;
+} array_aggregate;
+
+#define ARRAY__AGG_VALUE(T, sfx) \
+    static inline double array__agg_value_##sfx(const void* buf, uint64_t index) { \
+        return (double)((const T*)buf)[index]; \
+    }
+
+ARRAY__AGG_VALUE(char, char)
+ARRAY__AGG_VALUE(signed char, schar)
+ARRAY__AGG_VALUE(unsigned char, uchar)
+ARRAY__AGG_VALUE(short, short)
+ARRAY__AGG_VALUE(unsigned short, ushort)
+ARRAY__AGG_VALUE(int, int)
+ARRAY__AGG_VALUE(unsigned int, uint)
+ARRAY__AGG_VALUE(long, long)
+ARRAY__AGG_VALUE(unsigned long, ulong)
+ARRAY__AGG_VALUE(long long, llong)
+ARRAY__AGG_VALUE(unsigned long long, ullong)
+ARRAY__AGG_VALUE(float, float)
+ARRAY__AGG_VALUE(double, double)
+
+#define array__agg_value(buf) _Generic((buf), \
+        char*: array__agg_value_char, signed char*: array__agg_value_schar, unsigned char*: array__agg_value_uchar, \
+        short*: array__agg_value_short, unsigned short*: array__agg_value_ushort, \
+        int*: array__agg_value_int, unsigned int*: array__agg_value_uint, \
+        long*: array__agg_value_long, unsigned long*: array__agg_value_ulong, \
+        long long*: array__agg_value_llong, unsigned long long*: array__agg_value_ullong, \
+        float*: array__agg_value_float, double*: array__agg_value_double)
+
+/* Neumaier summation keeps the error of adding and taking away values of different magnitude */
+static inline void array__agg_sum(array_aggregate* agg, double x) {
+    double t = agg->sum + x;
+    if(fabs(agg->sum) >= fabs(x)) {
+        agg->sum_err += (agg->sum - t) + x;
+    }
+    else {
+        agg->sum_err += (x - t) + agg->sum;
+    }
+    agg->sum = t;
+}
+
+static inline uint64_t array__tree_word(double x) {
+    uint64_t w;
+    memcpy(&w, &x, sizeof(w));
+    return w;
+}
+
+static inline double array__tree_double(uint64_t w) {
+    double x;
+    memcpy(&x, &w, sizeof(x));
+    return x;
+}
+
+static inline uint64_t array__tree_min_f64(uint64_t a, uint64_t b) {
+    return array__tree_double(a) < array__tree_double(b) ? a : b;
+}
+
+static inline uint64_t array__tree_max_f64(uint64_t a, uint64_t b) {
+    return array__tree_double(a) > array__tree_double(b) ? a : b;
+}
+
+static inline void array__tree_init(array__tree* tree, array__tree_combine min, array__tree_combine max,
+        uint64_t min_empty, uint64_t max_empty) {
+    tree->mins = NULL;
+    tree->maxs = NULL;
+    tree->leaves = 0;
+    tree->min = min;
+    tree->max = max;
+    tree->min_empty = min_empty;
+    tree->max_empty = max_empty;
+}
+
+static inline void array__tree_free(array__tree* tree) {
+    free(tree->mins);
+    free(tree->maxs);
+    tree->mins = NULL;
+    tree->maxs = NULL;
+    tree->leaves = 0;
+}
+
+/**
+*   Makes room for at least size leaves, a power of two
+*   @return 0 if memory ran out
+*/
+static inline int array__tree_reserve(array__tree* tree, uint64_t size) {
+    uint64_t leaves = tree->leaves > 0 ? tree->leaves : 1;
+    while(leaves < size) {
+        leaves *= 2;
+    }
+    if(leaves != tree->leaves) {
+        uint64_t* mins = realloc(tree->mins, sizeof(uint64_t) * 2 * leaves);
+        if(!mins) {
+            return 0;
+        }
+        tree->mins = mins;
+        uint64_t* maxs = realloc(tree->maxs, sizeof(uint64_t) * 2 * leaves);
+        if(!maxs) {
+            return 0;
+        }
+        tree->maxs = maxs;
+        tree->leaves = leaves;
+    }
+    return 1;
+}
+
+static inline void array__tree_set(array__tree* tree, uint64_t i, uint64_t x) {
+    tree->mins[tree->leaves + i] = x;
+    tree->maxs[tree->leaves + i] = x;
+}
+
+static inline void array__tree_clear(array__tree* tree, uint64_t i) {
+    tree->mins[tree->leaves + i] = tree->min_empty;
+    tree->maxs[tree->leaves + i] = tree->max_empty;
+}
+
+static inline void array__tree_pull(array__tree* tree, uint64_t node) {
+    tree->mins[node] = tree->min(tree->mins[2 * node], tree->mins[2 * node + 1]);
+    tree->maxs[node] = tree->max(tree->maxs[2 * node], tree->maxs[2 * node + 1]);
+}
+
+/* Recomputes every parent after all leaves were set */
+static inline void array__tree_build(array__tree* tree) {
+    for(uint64_t node = tree->leaves - 1; node > 0; --node) {
+        array__tree_pull(tree, node);
+    }
+}
+
+/* Recomputes the parents of leaves [begin, end) one level at a time */
+static inline void array__tree_repair(array__tree* tree, uint64_t begin, uint64_t end) {
+    if(begin >= end) {
+        return;
+    }
+    for(uint64_t l = (tree->leaves + begin) / 2, r = (tree->leaves + end - 1) / 2; l > 0; l /= 2, r /= 2) {
+        for(uint64_t node = l; node <= r; ++node) {
+            array__tree_pull(tree, node);
+        }
+    }
+}
+
+/* Combines leaves [l, r) touching two short runs of parents, the empty words for an empty range */
+static inline void array__tree_query(const array__tree* tree, uint64_t l, uint64_t r, uint64_t* lo, uint64_t* hi) {
+    *lo = tree->min_empty;
+    *hi = tree->max_empty;
+    for(l += tree->leaves, r += tree->leaves; l < r; l /= 2, r /= 2) {
+        if(l & 1) {
+            *lo = tree->min(tree->mins[l], *lo);
+            *hi = tree->max(tree->maxs[l], *hi);
+            ++l;
+        }
+        if(r & 1) {
+            --r;
+            *lo = tree->min(tree->mins[r], *lo);
+            *hi = tree->max(tree->maxs[r], *hi);
+        }
+    }
+}
+
+static inline void array__agg_build(array_aggregate* agg, const void* buf, uint64_t size) {
+    if(!array__tree_reserve(&agg->tree, size)) {
+        agg->error = ARRAY_OUT_OF_MEM;
+        return;
+    }
+    for(uint64_t i = 0; i < agg->tree.leaves; ++i) {
+        if(i < size) {
+            array__tree_set(&agg->tree, i, array__tree_word(agg->value(buf, i)));
+        }
+        else {
+            array__tree_clear(&agg->tree, i);
+        }
+    }
+    array__tree_build(&agg->tree);
+}
+
+static inline void array__agg_before(array_hook* hook, const void* buf, uint64_t begin, uint64_t end) {
+    array_aggregate* agg = (array_aggregate*)hook;
+    for(uint64_t i = begin; i < end; ++i) {
+        array__agg_sum(agg, -agg->value(buf, i));
+    }
+}
+
+static inline void array__agg_after(array_hook* hook, const void* buf, uint64_t begin, uint64_t end, uint64_t size) {
+    array_aggregate* agg = (array_aggregate*)hook;
+    uint64_t old_size = agg->count;
+    for(uint64_t i = begin; i < end; ++i) {
+        array__agg_sum(agg, agg->value(buf, i));
+    }
+    agg->count = size;
+    if(agg->error != ARRAY_OK_ERROR) {
+        return;
+    }
+    if(size > agg->tree.leaves) {
+        array__agg_build(agg, buf, size);
+        return;
+    }
+    /* Repair the leaves that changed or were removed, then their ancestors */
+    uint64_t hi = old_size > size && old_size > end ? old_size : end;
+    for(uint64_t i = begin; i < hi; ++i) {
+        if(i < size) {
+            array__tree_set(&agg->tree, i, array__tree_word(agg->value(buf, i)));
+        }
+        else {
+            array__tree_clear(&agg->tree, i);
+        }
+    }
+    array__tree_repair(&agg->tree, begin, hi);
+}
+
+/**
+*   Starts maintaining the aggregates of an array, with a custom function reading each value
+*   @param array_struct Array struct to track
+*   @param agg Pointer to an array_aggregate that stays valid until array_untrack_aggregate
+*   @param value_fn Function returning the value of element index of buf as a double
+*   @note Reads every element once to initialize, changes through buf or array_foreach_ptr are not seen
+*   @note Can modify error state of agg to ARRAY_OUT_OF_MEM, min and max are then NAN while sum and count stay correct
+*   @example array_track_aggregate_by(orders, &stats, order_price);
+*/
+#define array_track_aggregate_by(array_struct, agg, value_fn) do { \
+        array_aggregate* array__agg = (agg); \
+        array__agg->hook.before = array__agg_before; \
+        array__agg->hook.after = array__agg_after; \
+        array__agg->value = (value_fn); \
+        array__agg->sum = 0; \
+        array__agg->sum_err = 0; \
+        array__agg->count = array_struct.size; \
+        array__tree_init(&array__agg->tree, array__tree_min_f64, array__tree_max_f64, \
+            array__tree_word(INFINITY), array__tree_word(-INFINITY)); \
+        array__agg->error = ARRAY_OK_ERROR; \
+        for(uint64_t array__i = 0; array__i < array_struct.size; ++array__i) { \
+            array__agg_sum(array__agg, array__agg->value(array_struct.buf, array__i)); \
+        } \
+        array__agg_build(array__agg, array_struct.buf, array_struct.size); \
+        array_attach_hook(array_struct, &array__agg->hook); \
+    } while(0)
+
+/**
+*   Starts maintaining the aggregates of an array of a builtin integer or floating point type
+*   @param array_struct Array struct to track
+*   @param agg Pointer to an array_aggregate that stays valid until array_untrack_aggregate
+*   @note Integers beyond 2^53 lose precision, as they are summed as doubles
+*   @example array_track_aggregate(a, &stats);
+*/
+#define array_track_aggregate(array_struct, agg) \
+    array_track_aggregate_by(array_struct, agg, array__agg_value(array_struct.buf))
+
+/**
+*   Stops maintaining the aggregates of an array and frees the segment tree
+*   @param array_struct Array struct passed to array_track_aggregate
+*   @param agg Pointer to the aggregate
+*   @example array_untrack_aggregate(a, &stats);
+*/
+#define array_untrack_aggregate(array_struct, agg) do { \
+        array_aggregate* array__agg = (agg); \
+        array_detach_hook(array_struct, &array__agg->hook); \
+        array__tree_free(&array__agg->tree); \
+    } while(0)
+
+/**
+*   Gets the sum of the tracked array in O(1)
+*   @param agg Pointer to the aggregate
+*   @return Sum of all values, 0 for an empty array
+*/
+static inline double array_aggregate_sum(const array_aggregate* agg) {
+    return agg->sum + agg->sum_err;
+}
+
+/**
+*   Gets the number of values in the tracked array in O(1)
+*   @param agg Pointer to the aggregate
+*   @return Number of values
+*/
+static inline uint64_t array_aggregate_count(const array_aggregate* agg) {
+    return agg->count;
+}
+
+/**
+*   Gets the smallest value of the tracked array in O(1)
+*   @param agg Pointer to the aggregate
+*   @return Smallest value, INFINITY for an empty array, NAN if the aggregate ran out of memory
+*/
+static inline double array_aggregate_min(const array_aggregate* agg) {
+    if(agg->error != ARRAY_OK_ERROR) {
+        return NAN;
+    }
+    return agg->count > 0 ? array__tree_double(agg->tree.mins[1]) : INFINITY;
+}
+
+/**
+*   Gets the largest value of the tracked array in O(1)
+*   @param agg Pointer to the aggregate
+*   @return Largest value, -INFINITY for an empty array, NAN if the aggregate ran out of memory
+*/
+static inline double array_aggregate_max(const array_aggregate* agg) {
+    if(agg->error != ARRAY_OK_ERROR) {
+        return NAN;
+    }
+    return agg->count > 0 ? array__tree_double(agg->tree.maxs[1]) : -INFINITY;
+}
+
+/**
+*   Gets the smallest and largest values of elements [begin, end) of the tracked array in O(log n)
+*   @param agg Pointer to the aggregate
+*   @param begin First element of the range
+*   @param end One past the last element of the range, clipped to the size
+*   @param min Set to the smallest value, INFINITY for an empty range
+*   @param max Set to the largest value, -INFINITY for an empty range
+*   @note Sets both to NAN if the aggregate ran out of memory
+*   @example array_aggregate_range(&stats, 0, 100, &lo, &hi);
+*/
+static inline void array_aggregate_range(const array_aggregate* agg, uint64_t begin, uint64_t end, double* min, double* max) {
+    if(agg->error != ARRAY_OK_ERROR) {
+        *min = NAN;
+        *max = NAN;
+        return;
+    }
+    uint64_t lo;
+    uint64_t hi;
+    end = end < agg->count ? end : agg->count;
+    array__tree_query(&agg->tree, begin, begin < end ? end : begin, &lo, &hi);
+    *min = array__tree_double(lo);
+    *max = array__tree_double(hi);
+}
+
+#endif
@@ -0,0 +1,359 @@
+#ifndef ARRAY_BUDGET_H
+#define ARRAY_BUDGET_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "array.h"
+
+/*
+*   A budget is an allocator shared by a group of arrays that keeps their buffers below a byte limit
+*   together. Buffers are page mappings, charged for the pages of their capacity. Growth that would go
+*   over the limit is handled by the policy of the budget:
+*
+*   ARRAY_BUDGET_FAIL   the growth fails and the array gets ARRAY_OUT_OF_MEM
+*   ARRAY_BUDGET_BLOCK  the growing thread waits until other arrays of the group shrink or are freed
+*   ARRAY_BUDGET_SPILL  the arrays grown least recently are moved to files until the growth fits
+*
+*   Under every policy a buffer that would be over the limit by itself fails to grow right away, so the
+*   growth retries with a smaller increment instead of waiting or spilling for room that cannot appear.
+*
+*   A spilled array keeps its address and stays usable, its buffer is remapped onto an unlinked file in
+*   the spill directory so the kernel pages it in from disk on access instead of holding it in memory.
+*   Growing a spilled array brings it back into memory first. Spilling remaps a buffer in place, so with
+*   ARRAY_BUDGET_SPILL no thread may write an array of the group while another array of it grows.
+*
+*   array_budget budget;
+*   array_budget_init(&budget, 512 << 20, ARRAY_BUDGET_SPILL, NULL);
+*   array_set_allocator(a, &budget.alloc);
+*   array_set_allocator(b, &budget.alloc);
+*
+*   Needs MAP_ANONYMOUS and mkstemp, define _DEFAULT_SOURCE or _GNU_SOURCE when building with -std=c11.
+*/
+
+typedef enum {
+    ARRAY_BUDGET_FAIL,
+    ARRAY_BUDGET_BLOCK,
+    ARRAY_BUDGET_SPILL
+} array_budget_policy;
+
+typedef struct {
+    uint64_t limit;
+    uint64_t used;
+    uint64_t peak;
+    uint64_t failures;
+    uint64_t waits;
+    uint64_t spills;
+    uint64_t spilled_bytes;
+} array_budget_stats;
+
+/* Sits in front of every buffer of a budget, resident buffers are linked from most to least recently grown */
+typedef struct array__budget_block array__budget_block;
+struct array__budget_block {
+    uint64_t mapped;
+    uint64_t charged;
+    array__budget_block* prev;
+    array__budget_block* next;
+    int spilled;
+};
+
+/**
+*   Bytes before the first element of a buffer in a budget, keeps the elements cache line aligned
+*/
+#define ARRAY_BUDGET_HEADER 64
+
+typedef struct {
+    array_allocator alloc;
+    pthread_mutex_t lock;
+    pthread_cond_t freed;
+    array_budget_policy policy;
+    const char* spill_dir;
+    array__budget_block* head;
+    array__budget_block* tail;
+    array_budget_stats stats;
+} array_budget;
+
+static inline uint64_t array__budget_round(uint64_t bytes) {
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    return (bytes + page - 1) / page * page;
+}
+
+static inline void array__budget_unlink(array_budget* budget, array__budget_block* b) {
+    *(b->prev ? &b->prev->next : &budget->head) = b->next;
+    *(b->next ? &b->next->prev : &budget->tail) = b->prev;
+    b->prev = NULL;
+    b->next = NULL;
+}
+
+static inline void array__budget_push(array_budget* budget, array__budget_block* b) {
+    b->prev = NULL;
+    b->next = budget->head;
+    *(budget->head ? &budget->head->prev : &budget->tail) = b;
+    budget->head = b;
+}
+
+/**
+*   Moves a resident buffer onto an unlinked file mapped over the same addresses
+*   @return 1 on success, 0 if the file could not be written, the buffer is then unchanged
+*/
+static inline int array__budget_spill(array_budget* budget, array__budget_block* b) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/array-spill-XXXXXX", budget->spill_dir);
+    int fd = mkstemp(path);
+    if(fd < 0) {
+        return 0;
+    }
+    unlink(path);
+    int ok = ftruncate(fd, (off_t)b->mapped) == 0;
+    /* Pages past the charged capacity were released and only read as zeros, the file is sparse there */
+    for(uint64_t done = 0; ok && done < b->charged; ) {
+        ssize_t n = pwrite(fd, (unsigned char*)b + done, b->charged - done, (off_t)done);
+        ok = n > 0;
+        done += ok ? (uint64_t)n : 0;
+    }
+    ok = ok && mmap(b, b->mapped, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+    close(fd);
+    if(!ok) {
+        return 0;
+    }
+    array__budget_unlink(budget, b);
+    budget->stats.used -= b->charged;
+    budget->stats.spilled_bytes += b->charged;
+    ++budget->stats.spills;
+    b->spilled = 1;
+    return 1;
+}
+
+/**
+*   Charges bytes to the budget, applying its policy while they do not fit
+*   @param self Buffer being grown, never spilled to make room for itself
+*   @return 1 once charged, 0 if the growth has to fail
+*/
+static inline int array__budget_charge(array_budget* budget, uint64_t bytes, array__budget_block* self) {
+    /* A buffer that would be over the limit on its own never fits, waiting for it would never end */
+    uint64_t own = self ? self->charged : 0;
+    while(budget->stats.used + bytes > budget->stats.limit) {
+        array__budget_block* victim = budget->tail;
+        victim = victim == self ? victim->prev : victim;
+        if(bytes + own > budget->stats.limit || budget->policy == ARRAY_BUDGET_FAIL ||
+                (budget->policy == ARRAY_BUDGET_SPILL && (!victim || !array__budget_spill(budget, victim)))) {
+            ++budget->stats.failures;
+            return 0;
+        }
+        if(budget->policy == ARRAY_BUDGET_BLOCK) {
+            ++budget->stats.waits;
+            pthread_cond_wait(&budget->freed, &budget->lock);
+        }
+    }
+    budget->stats.used += bytes;
+    budget->stats.peak = budget->stats.used > budget->stats.peak ? budget->stats.used : budget->stats.peak;
+    return 1;
+}
+
+static inline void array__budget_uncharge(array_budget* budget, uint64_t bytes) {
+    budget->stats.used -= bytes;
+    pthread_cond_broadcast(&budget->freed);
+}
+
+/**
+*   Maps charged bytes of fresh memory and copies the first keep bytes of from into it
+*   @return The new block, NULL if mapping failed
+*/
+static inline array__budget_block* array__budget_map(uint64_t mapped, const void* from, uint64_t keep) {
+    void* base = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED) {
+        return NULL;
+    }
+    if(from) {
+        memcpy(base, from, keep);
+    }
+    array__budget_block* b = base;
+    b->mapped = mapped;
+    b->spilled = 0;
+    return b;
+}
+
+static inline void* array__budget_resize_locked(array_budget* budget, void* buf, uint64_t old_bytes, uint64_t new_bytes) {
+    uint64_t charge = array__budget_round(ARRAY_BUDGET_HEADER + new_bytes);
+    if(!buf) {
+        if(!array__budget_charge(budget, charge, NULL)) {
+            return NULL;
+        }
+        array__budget_block* b = array__budget_map(charge, NULL, 0);
+        if(!b) {
+            array__budget_uncharge(budget, charge);
+            return NULL;
+        }
+        b->charged = charge;
+        array__budget_push(budget, b);
+        return (unsigned char*)b + ARRAY_BUDGET_HEADER;
+    }
+    array__budget_block* b = (array__budget_block*)((unsigned char*)buf - ARRAY_BUDGET_HEADER);
+    if(b->spilled) {
+        if(new_bytes <= old_bytes) {
+            return buf;
+        }
+        /* A spilled buffer that grows is in use again, bring it back into memory */
+        if(!array__budget_charge(budget, charge, NULL)) {
+            return NULL;
+        }
+        array__budget_block* moved = array__budget_map(charge, b, ARRAY_BUDGET_HEADER + old_bytes);
+        if(!moved) {
+            array__budget_uncharge(budget, charge);
+            return NULL;
+        }
+        budget->stats.spilled_bytes -= b->charged;
+        munmap(b, b->mapped);
+        moved->charged = charge;
+        array__budget_push(budget, moved);
+        return (unsigned char*)moved + ARRAY_BUDGET_HEADER;
+    }
+    if(charge <= b->charged) {
+        if(charge < b->charged) {
+            madvise((unsigned char*)b + charge, b->charged - charge, MADV_DONTNEED);
+            array__budget_uncharge(budget, b->charged - charge);
+            b->charged = charge;
+        }
+        return buf;
+    }
+    if(!array__budget_charge(budget, charge - b->charged, b)) {
+        return NULL;
+    }
+    array__budget_unlink(budget, b);
+    if(charge > b->mapped) {
+        array__budget_block* moved = array__budget_map(charge, b, ARRAY_BUDGET_HEADER + old_bytes);
+        if(!moved) {
+            array__budget_push(budget, b);
+            array__budget_uncharge(budget, charge - b->charged);
+            return NULL;
+        }
+        munmap(b, b->mapped);
+        b = moved;
+    }
+    b->charged = charge;
+    array__budget_push(budget, b);
+    return (unsigned char*)b + ARRAY_BUDGET_HEADER;
+}
+
+static inline void* array__budget_resize(array_allocator* alloc, void* buf, uint64_t old_bytes, uint64_t new_bytes) {
+    array_budget* budget = (array_budget*)alloc;
+    pthread_mutex_lock(&budget->lock);
+    void* result = array__budget_resize_locked(budget, buf, old_bytes, new_bytes);
+    pthread_mutex_unlock(&budget->lock);
+    return result;
+}
+
+static inline void array__budget_release(array_allocator* alloc, void* buf, uint64_t bytes) {
+    (void)bytes;
+    array_budget* budget = (array_budget*)alloc;
+    array__budget_block* b = (array__budget_block*)((unsigned char*)buf - ARRAY_BUDGET_HEADER);
+    pthread_mutex_lock(&budget->lock);
+    if(b->spilled) {
+        budget->stats.spilled_bytes -= b->charged;
+    }
+    else {
+        array__budget_unlink(budget, b);
+        array__budget_uncharge(budget, b->charged);
+    }
+    munmap(b, b->mapped);
+    pthread_mutex_unlock(&budget->lock);
+}
+
+/**
+*   Initializes a budget shared by the arrays that use its allocator
+*   @param budget Pointer to the array_budget, must stay valid and in place until every array of it is freed
+*   @param limit Bytes the resident buffers of the group may use together
+*   @param policy What happens to growth that would go over the limit
+*   @param spill_dir Directory for the files of spilled arrays, NULL for $TMPDIR or /tmp, must stay valid
+*   @return ARRAY_OK_ERROR, or ARRAY_OUT_OF_MEM if the lock could not be created
+*   @note Every buffer is charged for whole pages plus ARRAY_BUDGET_HEADER bytes
+*   @example array_budget_init(&budget, 512 << 20, ARRAY_BUDGET_BLOCK, NULL);
+*/
+static inline array_error array_budget_init(array_budget* budget, uint64_t limit, array_budget_policy policy, const char* spill_dir) {
+    budget->alloc.resize = array__budget_resize;
+    budget->alloc.release = array__budget_release;
+    budget->policy = policy;
+    budget->spill_dir = spill_dir ? spill_dir : getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    budget->head = NULL;
+    budget->tail = NULL;
+    memset(&budget->stats, 0, sizeof(budget->stats));
+    budget->stats.limit = limit;
+    if(pthread_mutex_init(&budget->lock, NULL) != 0) {
+        return ARRAY_OUT_OF_MEM;
+    }
+    if(pthread_cond_init(&budget->freed, NULL) != 0) {
+        pthread_mutex_destroy(&budget->lock);
+        return ARRAY_OUT_OF_MEM;
+    }
+    return ARRAY_OK_ERROR;
+}
+
+/**
+*   Releases a budget once every array of it has been freed
+*   @param budget Pointer to the array_budget
+*   @example array_budget_free(&budget);
+*/
+static inline void array_budget_free(array_budget* budget) {
+    pthread_mutex_destroy(&budget->lock);
+    pthread_cond_destroy(&budget->freed);
+}
+
+/**
+*   Gets a snapshot of how much of a budget is used
+*   @param budget Pointer to the array_budget
+*   @return Limit, resident bytes and their peak, failed growths, waits for memory, spills and spilled bytes
+*   @example array_budget_stats s = array_budget_stats_of(&budget);
+*/
+static inline array_budget_stats array_budget_stats_of(array_budget* budget) {
+    pthread_mutex_lock(&budget->lock);
+    array_budget_stats stats = budget->stats;
+    pthread_mutex_unlock(&budget->lock);
+    return stats;
+}
+
+/**
+*   Changes the limit of a budget, waiting growths are woken up to try again
+*   @param budget Pointer to the array_budget
+*   @param limit New limit in bytes, arrays already over it are not spilled until one of them grows
+*   @example array_budget_set_limit(&budget, 1ull << 30);
+*/
+static inline void array_budget_set_limit(array_budget* budget, uint64_t limit) {
+    pthread_mutex_lock(&budget->lock);
+    budget->stats.limit = limit;
+    pthread_cond_broadcast(&budget->freed);
+    pthread_mutex_unlock(&budget->lock);
+}
+
+static inline array_error array__budget_spill_buf(array_allocator* alloc, void* buf) {
+    if(!alloc || alloc->resize != array__budget_resize) {
+        return ARRAY_INVALID_DATA;
+    }
+    array_budget* budget = (array_budget*)alloc;
+    array__budget_block* b = (array__budget_block*)((unsigned char*)buf - ARRAY_BUDGET_HEADER);
+    pthread_mutex_lock(&budget->lock);
+    int ok = b->spilled || array__budget_spill(budget, b);
+    if(ok) {
+        pthread_cond_broadcast(&budget->freed);
+    }
+    pthread_mutex_unlock(&budget->lock);
+    return ok ? ARRAY_OK_ERROR : ARRAY_IO_ERROR;
+}
+
+/**
+*   Spills an array known to be cold to its file now, releasing its memory from the budget
+*   @param array_struct Array struct using the allocator of a budget
+*   @warning No other thread may use the array while it is spilled
+*   @note The array stays usable, its pages are read back from the file when accessed
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_INVALID_DATA if the array is not in a budget or ARRAY_IO_ERROR if
+*   its file could not be written
+*   @example array_budget_spill(history);
+*/
+#define array_budget_spill(array_struct) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            array_struct.error = array__budget_spill_buf(array_struct.alloc, array_struct.buf); \
+        } \
+    } while(0)
+
+#endif
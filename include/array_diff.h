@@ -0,0 +1,384 @@
+#ifndef ARRAY_DIFF_H
+#define ARRAY_DIFF_H
+
+#include "array_hash.h"
+
+/*
+*   A patch turns one version of an array into another. It starts with the magic bytes ADF1, the element size,
+*   old size and new size as varints and the XXH64 hash of the new contents, followed by operations:
+*   0 copies a run of elements from the old array (varint old offset, varint count) and 1 inserts literal
+*   elements (varint count, then the element bytes). The operations fill the new array from head to tail.
+*/
+
+/**
+*   Size in bytes of the blocks array_diff indexes to find unchanged regions that moved
+*   @note Define before including array_diff.h to trade patch size against diff speed
+*/
+#ifndef ARRAY_DIFF_BLOCK_BYTES
+#define ARRAY_DIFF_BLOCK_BYTES 256
+#endif
+
+#define ARRAY__DIFF_COPY 0
+#define ARRAY__DIFF_LITERAL 1
+#define ARRAY__DIFF_BASE 0x100000001B3ull
+
+typedef struct {
+    array_allocator* alloc;
+    uint8_t** buf;
+    uint64_t* size;
+    uint64_t* capacity;
+    int failed;
+    uint64_t copy_offset;
+    uint64_t copy_count;
+} array__patch_writer;
+
+static inline void array__patch_put(array__patch_writer* w, const void* data, uint64_t n) {
+    if(w->failed) {
+        return;
+    }
+    if(*w->size + n > *w->capacity) {
+        uint8_t* temp = array__grow(w->alloc, *w->buf, 1, w->capacity, *w->size + n);
+        if(!temp) {
+            w->failed = 1;
+            return;
+        }
+        *w->buf = temp;
+    }
+    memcpy(*w->buf + *w->size, data, n);
+    *w->size += n;
+}
+
+static inline void array__patch_varint(array__patch_writer* w, uint64_t x) {
+    uint8_t bytes[10];
+    unsigned n = 0;
+    for(; x >= 0x80; x >>= 7) {
+        bytes[n++] = (uint8_t)(x | 0x80);
+    }
+    bytes[n++] = (uint8_t)x;
+    array__patch_put(w, bytes, n);
+}
+
+static inline void array__patch_flush_copy(array__patch_writer* w) {
+    if(w->copy_count > 0) {
+        uint8_t op = ARRAY__DIFF_COPY;
+        array__patch_put(w, &op, 1);
+        array__patch_varint(w, w->copy_offset);
+        array__patch_varint(w, w->copy_count);
+        w->copy_count = 0;
+    }
+}
+
+/* Copies are held back so a copy continuing where the last one ended is merged into it */
+static inline void array__patch_copy(array__patch_writer* w, uint64_t offset, uint64_t count) {
+    if(count == 0) {
+        return;
+    }
+    if(w->copy_count > 0 && w->copy_offset + w->copy_count == offset) {
+        w->copy_count += count;
+        return;
+    }
+    array__patch_flush_copy(w);
+    w->copy_offset = offset;
+    w->copy_count = count;
+}
+
+static inline void array__patch_literal(array__patch_writer* w, const unsigned char* data, uint64_t count, size_t es) {
+    if(count == 0) {
+        return;
+    }
+    uint8_t op = ARRAY__DIFF_LITERAL;
+    array__patch_flush_copy(w);
+    array__patch_put(w, &op, 1);
+    array__patch_varint(w, count);
+    array__patch_put(w, data, count * es);
+}
+
+/* Polynomial hash of a block, which can be rolled forward one byte at a time */
+static inline uint64_t array__block_hash(const unsigned char* p, uint64_t bytes) {
+    uint64_t h = 0;
+    for(uint64_t i = 0; i < bytes; ++i) {
+        h = h * ARRAY__DIFF_BASE + p[i];
+    }
+    return h;
+}
+
+/* Counts the equal bytes at the end of two buffers */
+static inline uint64_t array__mismatch_back(const unsigned char* a_end, const unsigned char* b_end, uint64_t bytes) {
+    uint64_t i = 0;
+    for(; i + 64 <= bytes; i += 64) {
+        if(memcmp(a_end - i - 64, b_end - i - 64, 64) != 0) {
+            break;
+        }
+    }
+    for(; i < bytes && a_end[-(int64_t)i - 1] == b_end[-(int64_t)i - 1]; ++i) {
+    }
+    return i;
+}
+
+/**
+*   Writes a patch turning old into cur, finding moved blocks with a rolling hash over cur
+*   @return ARRAY_OK_ERROR or ARRAY_OUT_OF_MEM
+*/
+static inline array_error array__diff(array_allocator* alloc, uint8_t** buf, uint64_t* size, uint64_t* capacity,
+        const unsigned char* old, uint64_t old_n, const unsigned char* cur, uint64_t new_n, size_t es) {
+    array__patch_writer w = { alloc, buf, size, capacity, 0, 0, 0 };
+    uint64_t min_n = old_n < new_n ? old_n : new_n;
+    uint64_t prefix = min_n == 0 ? 0 : array__mismatch(old, cur, min_n * es) / es;
+    uint64_t suffix = min_n == prefix ? 0 :
+        array__mismatch_back(old + old_n * es, cur + new_n * es, (min_n - prefix) * es) / es;
+    uint64_t hash = array__hash_bytes(cur, new_n * es, 0);
+    uint8_t hash_bytes[8];
+    for(int i = 0; i < 8; ++i) {
+        hash_bytes[i] = (uint8_t)(hash >> (8 * i));
+    }
+    *size = 0;
+    array__patch_put(&w, "ADF1", 4);
+    array__patch_varint(&w, es);
+    array__patch_varint(&w, old_n);
+    array__patch_varint(&w, new_n);
+    array__patch_put(&w, hash_bytes, 8);
+    array__patch_copy(&w, 0, prefix);
+
+    uint64_t block = ARRAY_DIFF_BLOCK_BYTES / es > 0 ? ARRAY_DIFF_BLOCK_BYTES / es : 1;
+    uint64_t block_bytes = block * es;
+    uint64_t old_end = old_n - suffix;
+    uint64_t end = new_n - suffix;
+    uint64_t p = prefix;
+    uint64_t literal = prefix;
+    uint64_t blocks = (old_end - prefix) / block;
+    if(blocks > 0 && end - p >= block) {
+        /* Index the aligned blocks of the changed region of old by hash, with linear probing */
+        uint64_t slots = 2;
+        int shift = 63;
+        while(slots < 2 * blocks) {
+            slots *= 2;
+            --shift;
+        }
+        uint64_t* keys = malloc(sizeof(uint64_t) * slots);
+        uint64_t* offsets = calloc(slots, sizeof(uint64_t));
+        if(!keys || !offsets) {
+            free(keys);
+            free(offsets);
+            return ARRAY_OUT_OF_MEM;
+        }
+        for(uint64_t b = 0; b < blocks; ++b) {
+            uint64_t offset = prefix + b * block;
+            uint64_t h = array__block_hash(old + offset * es, block_bytes);
+            uint64_t slot = (h * ARRAY__XXH_P1) >> shift;
+            while(offsets[slot] != 0) {
+                slot = (slot + 1) & (slots - 1);
+            }
+            keys[slot] = h;
+            offsets[slot] = offset + 1;
+        }
+        uint64_t top = 1;
+        for(uint64_t i = 1; i < block_bytes; ++i) {
+            top *= ARRAY__DIFF_BASE;
+        }
+        uint64_t h = array__block_hash(cur + p * es, block_bytes);
+        while(p + block <= end) {
+            uint64_t match = 0;
+            for(uint64_t slot = (h * ARRAY__XXH_P1) >> shift; offsets[slot] != 0; slot = (slot + 1) & (slots - 1)) {
+                if(keys[slot] == h && memcmp(old + (offsets[slot] - 1) * es, cur + p * es, block_bytes) == 0) {
+                    match = offsets[slot];
+                    break;
+                }
+            }
+            if(match) {
+                uint64_t o = match - 1;
+                while(p > literal && o > 0 && memcmp(old + (o - 1) * es, cur + (p - 1) * es, es) == 0) {
+                    --p;
+                    --o;
+                }
+                uint64_t len = block;
+                while(o + len < old_n && p + len < end) {
+                    uint64_t room = old_n - o - len < end - p - len ? old_n - o - len : end - p - len;
+                    uint64_t same = array__mismatch(old + (o + len) * es, cur + (p + len) * es, room * es) / es;
+                    len += same;
+                    if(same < room) {
+                        break;
+                    }
+                }
+                array__patch_literal(&w, cur + literal * es, p - literal, es);
+                array__patch_copy(&w, o, len);
+                p += len;
+                literal = p;
+                if(p + block <= end) {
+                    h = array__block_hash(cur + p * es, block_bytes);
+                }
+                continue;
+            }
+            if(p + block < end) {
+                const unsigned char* out = cur + p * es;
+                const unsigned char* in = cur + (p + block) * es;
+                for(size_t i = 0; i < es; ++i) {
+                    h = (h - out[i] * top) * ARRAY__DIFF_BASE + in[i];
+                }
+            }
+            ++p;
+        }
+        free(keys);
+        free(offsets);
+    }
+    array__patch_literal(&w, cur + literal * es, end - literal, es);
+    array__patch_copy(&w, old_n - suffix, suffix);
+    array__patch_flush_copy(&w);
+    return w.failed ? ARRAY_OUT_OF_MEM : ARRAY_OK_ERROR;
+}
+
+static inline int array__patch_read_varint(const uint8_t** p, const uint8_t* end, uint64_t* x) {
+    *x = 0;
+    for(int shift = 0; *p < end && shift < 64; shift += 7) {
+        uint8_t byte = *(*p)++;
+        *x |= (uint64_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+*   Runs the copy and literal operations of a patch, into out or only counting the elements when out is NULL
+*   @return Number of elements the operations describe, or UINT64_MAX if an operation is corrupt or the
+*   elements would exceed max
+*/
+static inline uint64_t array__patch_ops(const uint8_t* p, const uint8_t* end, const unsigned char* old, uint64_t old_n,
+        size_t es, unsigned char* out, uint64_t max) {
+    uint64_t filled = 0;
+    while(p < end) {
+        uint8_t op = *p++;
+        uint64_t offset = 0, count;
+        if((op == ARRAY__DIFF_COPY && !array__patch_read_varint(&p, end, &offset)) ||
+                !array__patch_read_varint(&p, end, &count) || count > max - filled) {
+            return UINT64_MAX;
+        }
+        if(op == ARRAY__DIFF_COPY && offset <= old_n && count <= old_n - offset) {
+            if(out) {
+                memcpy(out + filled * es, old + offset * es, count * es);
+            }
+        }
+        else if(op == ARRAY__DIFF_LITERAL && count <= (uint64_t)(end - p) / es) {
+            if(out) {
+                memcpy(out + filled * es, p, count * es);
+            }
+            p += count * es;
+        }
+        else {
+            return UINT64_MAX;
+        }
+        filled += count;
+    }
+    return filled;
+}
+
+/**
+*   Builds the new contents described by a patch from the old contents
+*   @return Heap buffer holding the new contents, or NULL with err set
+*/
+static inline void* array__patch(const unsigned char* old, uint64_t old_n, size_t es,
+        const uint8_t* patch, uint64_t patch_n, uint64_t* new_n, array_error* err) {
+    const uint8_t* p = patch;
+    const uint8_t* end = patch + patch_n;
+    uint64_t patch_es, patch_old_n, hash = 0;
+    *err = ARRAY_INVALID_DATA;
+    if(patch_n < 4 || memcmp(p, "ADF1", 4) != 0) {
+        return NULL;
+    }
+    p += 4;
+    if(!array__patch_read_varint(&p, end, &patch_es) || !array__patch_read_varint(&p, end, &patch_old_n) ||
+            !array__patch_read_varint(&p, end, new_n) || end - p < 8) {
+        return NULL;
+    }
+    if(patch_es != es || patch_old_n != old_n) {
+        *err = ARRAY_SIZE_MISMATCH;
+        return NULL;
+    }
+    for(int i = 0; i < 8; ++i) {
+        hash |= (uint64_t)p[i] << (8 * i);
+    }
+    p += 8;
+    /* The size in the header is only trusted once the operations add up to it, so a corrupt one allocates nothing */
+    if(*new_n > UINT64_MAX / es / 2 || array__patch_ops(p, end, old, old_n, es, NULL, *new_n) != *new_n) {
+        return NULL;
+    }
+    unsigned char* out = malloc(es * (*new_n > 0 ? *new_n : 1));
+    if(!out) {
+        *err = ARRAY_OUT_OF_MEM;
+        return NULL;
+    }
+    array__patch_ops(p, end, old, old_n, es, out, *new_n);
+    if(array__hash_bytes(out, *new_n * es, 0) != hash) {
+        free(out);
+        return NULL;
+    }
+    *err = ARRAY_OK_ERROR;
+    return out;
+}
+
+/**
+*   Replaces the contents of a byte array with a compact patch that turns one version of an array into another
+*   @param old_struct Array struct holding the previous version
+*   @param new_struct Array struct holding the current version, of the same type as old_struct
+*   @param patch_struct array_struct(uint8_t) to store the patch in
+*   @note Unchanged head and tail runs are found with memcmp, moved runs with a rolling hash over ARRAY_DIFF_BLOCK_BYTES blocks
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of patch_struct to ARRAY_OUT_OF_MEM
+*   @example array_diff(snapshot, a, patch);
+*/
+#define array_diff(old_struct, new_struct, patch_struct) do { \
+        if(patch_struct.error == ARRAY_OK_ERROR && old_struct.error == ARRAY_OK_ERROR && new_struct.error == ARRAY_OK_ERROR) { \
+            array__before(patch_struct, 0, patch_struct.size); \
+            patch_struct.error = array__diff(patch_struct.alloc, &patch_struct.buf, &patch_struct.size, &patch_struct.capacity, \
+                (const unsigned char*)old_struct.buf, old_struct.size, \
+                (const unsigned char*)new_struct.buf, new_struct.size, sizeof(*new_struct.buf)); \
+            array__after(patch_struct, 0, patch_struct.size); \
+        } \
+    } while(0)
+
+/**
+*   Applies a patch made by array_diff, turning the previous version of an array into the current one
+*   @param array_struct Array struct holding the previous version
+*   @param patch_struct array_struct(uint8_t) holding the patch
+*   @note The array is left unchanged unless the whole patch applies and the result matches the hash in the patch
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM, ARRAY_SIZE_MISMATCH if the patch was made from a different
+*   size or element type, or ARRAY_INVALID_DATA if the patch is corrupt or made from different contents
+*   @example array_patch(replica, patch);
+*/
+#define array_patch(array_struct, patch_struct) do { \
+        if(array_struct.error == ARRAY_OK_ERROR && patch_struct.error == ARRAY_OK_ERROR) { \
+            uint64_t array__new_n = 0; \
+            void* array__out = array__patch((const unsigned char*)array_struct.buf, array_struct.size, \
+                sizeof(*array_struct.buf), patch_struct.buf, patch_struct.size, &array__new_n, &array_struct.error); \
+            if(array__out && array_struct.alloc) { \
+                /* Memory from an allocator cannot be swapped for the heap block, copy the result into it */ \
+                uint64_t array__bytes = sizeof(*array_struct.buf) * (array__new_n > 0 ? array__new_n : 1); \
+                array__before(array_struct, 0, array_struct.size); \
+                void* array__temp = array__realloc(array_struct.alloc, array_struct.buf, \
+                    sizeof(*array_struct.buf) * array_struct.capacity, array__bytes); \
+                if(!array__temp) { \
+                    array_struct.error = ARRAY_OUT_OF_MEM; \
+                    free(array__out); \
+                    array__after(array_struct, 0, array_struct.size); \
+                    break; \
+                } \
+                array_struct.buf = array__temp; \
+                memcpy(array_struct.buf, array__out, sizeof(*array_struct.buf) * array__new_n); \
+                free(array__out); \
+                array_struct.size = array__new_n; \
+                array_struct.capacity = array__new_n > 0 ? array__new_n : 1; \
+                array__after(array_struct, 0, array_struct.size); \
+            } \
+            else if(array__out) { \
+                array__before(array_struct, 0, array_struct.size); \
+                free(array_struct.buf); \
+                array_struct.buf = array__out; \
+                array_struct.size = array__new_n; \
+                array_struct.capacity = array__new_n > 0 ? array__new_n : 1; \
+                array__after(array_struct, 0, array_struct.size); \
+            } \
+        } \
+    } while(0)
+
+#endif
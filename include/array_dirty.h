@@ -0,0 +1,191 @@
+#ifndef ARRAY_DIRTY_H
+#define ARRAY_DIRTY_H
+
+#include "array.h"
+
+/*
+*   A dirty tracker remembers which chunks of an array changed since it was last cleared, so a snapshot
+*   or a cache built from the array only has to revisit those chunks. It is attached as an array_hook,
+*   arrays without a tracker pay a single NULL check per mutation.
+*
+*   array_dirty tracker;
+*   array_track_dirty(a, &tracker, 1024);
+*   ...
+*   for(uint64_t begin, end, at = 0; array_dirty_next(&tracker, at, &begin, &end); at = end) {
+*       save(a.buf + begin, end - begin);
+*   }
+*   array_dirty_clear(&tracker);
+*/
+
+typedef struct {
+    array_hook hook;
+    uint64_t* bits;
+    uint64_t words;
+    unsigned shift;
+    uint64_t size;
+    int all;
+} array_dirty;
+
+static inline void array__dirty_mark(array_dirty* dirty, uint64_t first, uint64_t last) {
+    if(dirty->all) {
+        return;
+    }
+    uint64_t need = (last >> 6) + 1;
+    if(need > dirty->words) {
+        uint64_t words = dirty->words * 2 > need ? dirty->words * 2 : need;
+        uint64_t* bits = realloc(dirty->bits, sizeof(uint64_t) * words);
+        if(!bits) {
+            /* Without room for the bitmap the only safe answer left is that everything changed */
+            dirty->all = 1;
+            return;
+        }
+        memset(bits + dirty->words, 0, sizeof(uint64_t) * (words - dirty->words));
+        dirty->bits = bits;
+        dirty->words = words;
+    }
+    uint64_t w = first >> 6;
+    uint64_t lw = last >> 6;
+    uint64_t head = ~0ull << (first & 63);
+    uint64_t tail = ~0ull >> (63 - (last & 63));
+    if(w == lw) {
+        dirty->bits[w] |= head & tail;
+        return;
+    }
+    dirty->bits[w] |= head;
+    for(++w; w < lw; ++w) {
+        dirty->bits[w] = ~0ull;
+    }
+    dirty->bits[lw] |= tail;
+}
+
+static inline void array__dirty_after(array_hook* hook, const void* buf, uint64_t begin, uint64_t end, uint64_t size) {
+    (void)buf;
+    array_dirty* dirty = (array_dirty*)hook;
+    if(begin < end) {
+        array__dirty_mark(dirty, begin >> dirty->shift, (end - 1) >> dirty->shift);
+    }
+    dirty->size = size;
+}
+
+static inline int array__dirty_test(const array_dirty* dirty, uint64_t chunk) {
+    return (chunk >> 6) < dirty->words && (dirty->bits[chunk >> 6] >> (chunk & 63) & 1);
+}
+
+/**
+*   Starts tracking changes to an array, with nothing dirty yet
+*   @param array_struct Array struct to track
+*   @param dirty Pointer to an array_dirty that stays valid until array_untrack_dirty
+*   @param chunk_elems Elements per tracked chunk, rounded up to a power of two
+*   @note Changes made through buf or array_foreach_ptr are not seen, use array_dirty_mark for them
+*   @example array_track_dirty(a, &tracker, 4096);
+*/
+#define array_track_dirty(array_struct, dirty, chunk_elems) do { \
+        array_dirty* array__dirty = (dirty); \
+        array__dirty->hook.before = NULL; \
+        array__dirty->hook.after = array__dirty_after; \
+        array__dirty->bits = NULL; \
+        array__dirty->words = 0; \
+        array__dirty->shift = 0; \
+        while(((uint64_t)1 << array__dirty->shift) < (uint64_t)(chunk_elems) && array__dirty->shift < 63) { \
+            ++array__dirty->shift; \
+        } \
+        array__dirty->size = array_struct.size; \
+        array__dirty->all = 0; \
+        array_attach_hook(array_struct, &array__dirty->hook); \
+    } while(0)
+
+/**
+*   Stops tracking changes to an array and frees the bitmap
+*   @param array_struct Array struct passed to array_track_dirty
+*   @param dirty Pointer to the tracker
+*   @example array_untrack_dirty(a, &tracker);
+*/
+#define array_untrack_dirty(array_struct, dirty) do { \
+        array_dirty* array__dirty = (dirty); \
+        array_detach_hook(array_struct, &array__dirty->hook); \
+        free(array__dirty->bits); \
+        array__dirty->bits = NULL; \
+        array__dirty->words = 0; \
+    } while(0)
+
+/**
+*   Marks elements as dirty by hand, for writes made directly through buf
+*   @param dirty Pointer to the tracker
+*   @param begin First changed element
+*   @param end One past the last changed element
+*   @example array_dirty_mark(&tracker, i, i + 1);
+*/
+static inline void array_dirty_mark(array_dirty* dirty, uint64_t begin, uint64_t end) {
+    if(begin < end) {
+        array__dirty_mark(dirty, begin >> dirty->shift, (end - 1) >> dirty->shift);
+    }
+}
+
+/**
+*   Marks the whole array as dirty, so the next enumeration covers every element
+*   @param dirty Pointer to the tracker
+*   @example array_dirty_mark_all(&tracker);
+*/
+static inline void array_dirty_mark_all(array_dirty* dirty) {
+    dirty->all = 1;
+}
+
+/**
+*   Forgets every change seen so far
+*   @param dirty Pointer to the tracker
+*   @example array_dirty_clear(&tracker);
+*/
+static inline void array_dirty_clear(array_dirty* dirty) {
+    if(dirty->words > 0) {
+        memset(dirty->bits, 0, sizeof(uint64_t) * dirty->words);
+    }
+    dirty->all = 0;
+}
+
+/**
+*   Finds the next run of dirty elements, adjacent dirty chunks are merged into one run
+*   @param dirty Pointer to the tracker
+*   @param from Element to start searching from, 0 or the end of the previous run
+*   @param begin Set to the first element of the run
+*   @param end Set to one past the last element of the run, never past the current size
+*   @return 1 when a run was found, 0 when there are no more
+*   @note Elements removed from the tail are not reported, compare the size with the one last saved
+*   @example for(uint64_t b, e, at = 0; array_dirty_next(&tracker, at, &b, &e); at = e) save(b, e);
+*/
+static inline int array_dirty_next(const array_dirty* dirty, uint64_t from, uint64_t* begin, uint64_t* end) {
+    if(from >= dirty->size) {
+        return 0;
+    }
+    if(dirty->all) {
+        *begin = from;
+        *end = dirty->size;
+        return 1;
+    }
+    uint64_t last = (dirty->size - 1) >> dirty->shift;
+    uint64_t chunk = from >> dirty->shift;
+    while(chunk <= last) {
+        uint64_t w = chunk >> 6;
+        if(w >= dirty->words) {
+            return 0;
+        }
+        uint64_t bits = dirty->bits[w] & (~0ull << (chunk & 63));
+        if(bits) {
+            chunk = (w << 6) + array__ctz64(bits);
+            break;
+        }
+        chunk = (w + 1) << 6;
+    }
+    if(chunk > last) {
+        return 0;
+    }
+    uint64_t stop = chunk + 1;
+    while(stop <= last && array__dirty_test(dirty, stop)) {
+        ++stop;
+    }
+    uint64_t first = chunk << dirty->shift;
+    *begin = first > from ? first : from;
+    *end = stop > last ? dirty->size : stop << dirty->shift;
+    return 1;
+}
+
+#endif
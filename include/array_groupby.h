@@ -0,0 +1,297 @@
+#ifndef ARRAY_GROUPBY_H
+#define ARRAY_GROUPBY_H
+
+#include <math.h>
+#include "array.h"
+
+/*
+*   Group-by folds an array of records into one row of aggregates per distinct key. Groups live in a
+*   flat open addressing table with linear probing, above ARRAY_PARALLEL_THRESHOLD bytes every thread
+*   pre-aggregates its slice of the records into its own table and the tables are merged afterwards.
+*
+*   static uint64_t user_of(const void* rec) { return ((const event*)rec)->user; }
+*   static double ms_of(const void* rec) { return ((const event*)rec)->ms; }
+*   array_agg_spec specs[] = { { ARRAY_AGG_COUNT, NULL }, { ARRAY_AGG_SUM, ms_of }, { ARRAY_AGG_MAX, ms_of } };
+*   array_groupby(events, user_of, specs, 3, users, stats);
+*   // users.buf[g] is a key, stats.buf[g * 3 + s] its aggregate for specs[s]
+*/
+
+typedef enum {
+    ARRAY_AGG_COUNT,
+    ARRAY_AGG_SUM,
+    ARRAY_AGG_MIN,
+    ARRAY_AGG_MAX
+} array_agg_op;
+
+typedef struct {
+    array_agg_op op;
+    double (*value)(const void* rec);
+} array_agg_spec;
+
+typedef uint64_t (*array_key_fn)(const void* rec);
+
+typedef struct {
+    uint64_t* slot_keys;
+    uint64_t* slot_groups;
+    uint64_t mask;
+    uint64_t* keys;
+    double* accs;
+    uint64_t groups;
+    uint64_t capacity;
+    const array_agg_spec* specs;
+    unsigned nspecs;
+    array_error error;
+} array__group_table;
+
+typedef struct {
+    const unsigned char* src;
+    uint64_t es;
+    uint64_t n;
+    uint64_t chunk;
+    array_key_fn key;
+    array__group_table* tables;
+} array__groupby_job;
+
+static inline uint64_t array__mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+static inline void array__group_free(array__group_table* t) {
+    free(t->slot_keys);
+    free(t->slot_groups);
+    free(t->keys);
+    free(t->accs);
+}
+
+static inline void array__group_init(array__group_table* t, const array_agg_spec* specs, unsigned nspecs) {
+    t->mask = 63;
+    t->groups = 0;
+    t->capacity = 32;
+    t->specs = specs;
+    t->nspecs = nspecs;
+    t->error = ARRAY_OK_ERROR;
+    t->slot_keys = malloc(sizeof(uint64_t) * (t->mask + 1));
+    t->slot_groups = calloc(t->mask + 1, sizeof(uint64_t));
+    t->keys = malloc(sizeof(uint64_t) * t->capacity);
+    t->accs = malloc(sizeof(double) * t->capacity * (nspecs > 0 ? nspecs : 1));
+    if(!t->slot_keys || !t->slot_groups || !t->keys || !t->accs) {
+        t->error = ARRAY_OUT_OF_MEM;
+    }
+}
+
+/* Doubles the slots once they are half full, slot_groups holds group + 1 so 0 marks an empty slot */
+static inline int array__group_rehash(array__group_table* t) {
+    uint64_t mask = t->mask * 2 + 1;
+    uint64_t* slot_keys = malloc(sizeof(uint64_t) * (mask + 1));
+    uint64_t* slot_groups = calloc(mask + 1, sizeof(uint64_t));
+    if(!slot_keys || !slot_groups) {
+        free(slot_keys);
+        free(slot_groups);
+        t->error = ARRAY_OUT_OF_MEM;
+        return 0;
+    }
+    for(uint64_t g = 0; g < t->groups; ++g) {
+        uint64_t s = array__mix64(t->keys[g]) & mask;
+        while(slot_groups[s]) {
+            s = (s + 1) & mask;
+        }
+        slot_keys[s] = t->keys[g];
+        slot_groups[s] = g + 1;
+    }
+    free(t->slot_keys);
+    free(t->slot_groups);
+    t->slot_keys = slot_keys;
+    t->slot_groups = slot_groups;
+    t->mask = mask;
+    return 1;
+}
+
+/**
+*   Finds the group of a key, adding a group with empty aggregates when the key is new
+*   @return Pointer to the first aggregate of the group, NULL when out of memory
+*/
+static inline double* array__group_find(array__group_table* t, uint64_t key) {
+    uint64_t s = array__mix64(key) & t->mask;
+    for(; t->slot_groups[s]; s = (s + 1) & t->mask) {
+        if(t->slot_keys[s] == key) {
+            return t->accs + (t->slot_groups[s] - 1) * t->nspecs;
+        }
+    }
+    if(t->groups == t->capacity) {
+        uint64_t capacity = t->capacity * 2;
+        uint64_t* keys = realloc(t->keys, sizeof(uint64_t) * capacity);
+        if(!keys) {
+            t->error = ARRAY_OUT_OF_MEM;
+            return NULL;
+        }
+        t->keys = keys;
+        double* accs = realloc(t->accs, sizeof(double) * capacity * (t->nspecs > 0 ? t->nspecs : 1));
+        if(!accs) {
+            t->error = ARRAY_OUT_OF_MEM;
+            return NULL;
+        }
+        t->accs = accs;
+        t->capacity = capacity;
+    }
+    uint64_t g = t->groups++;
+    t->slot_keys[s] = key;
+    t->slot_groups[s] = g + 1;
+    t->keys[g] = key;
+    double* acc = t->accs + g * t->nspecs;
+    for(unsigned i = 0; i < t->nspecs; ++i) {
+        acc[i] = t->specs[i].op == ARRAY_AGG_MIN ? INFINITY : t->specs[i].op == ARRAY_AGG_MAX ? -INFINITY : 0;
+    }
+    if(2 * t->groups > t->mask && !array__group_rehash(t)) {
+        return NULL;
+    }
+    return acc;
+}
+
+static inline void array__group_fold(const array_agg_spec* specs, unsigned nspecs, double* acc, const void* rec) {
+    for(unsigned i = 0; i < nspecs; ++i) {
+        double x;
+        switch(specs[i].op) {
+            case ARRAY_AGG_COUNT:
+                acc[i] += 1;
+                break;
+            case ARRAY_AGG_SUM:
+                acc[i] += specs[i].value(rec);
+                break;
+            case ARRAY_AGG_MIN:
+                x = specs[i].value(rec);
+                acc[i] = x < acc[i] ? x : acc[i];
+                break;
+            case ARRAY_AGG_MAX:
+                x = specs[i].value(rec);
+                acc[i] = x > acc[i] ? x : acc[i];
+                break;
+        }
+    }
+}
+
+static inline void array__group_merge(const array_agg_spec* specs, unsigned nspecs, double* acc, const double* other) {
+    for(unsigned i = 0; i < nspecs; ++i) {
+        switch(specs[i].op) {
+            case ARRAY_AGG_COUNT:
+            case ARRAY_AGG_SUM:
+                acc[i] += other[i];
+                break;
+            case ARRAY_AGG_MIN:
+                acc[i] = other[i] < acc[i] ? other[i] : acc[i];
+                break;
+            case ARRAY_AGG_MAX:
+                acc[i] = other[i] > acc[i] ? other[i] : acc[i];
+                break;
+        }
+    }
+}
+
+static inline void array__groupby_task(void* ctx, uint64_t begin, uint64_t end) {
+    array__groupby_job* job = ctx;
+    for(uint64_t c = begin; c < end; ++c) {
+        array__group_table* t = job->tables + c;
+        uint64_t hi = (c + 1) * job->chunk < job->n ? (c + 1) * job->chunk : job->n;
+        for(uint64_t i = c * job->chunk; i < hi && t->error == ARRAY_OK_ERROR; ++i) {
+            const void* rec = job->src + job->es * i;
+            double* acc = array__group_find(t, job->key(rec));
+            if(acc) {
+                array__group_fold(t->specs, t->nspecs, acc, rec);
+            }
+        }
+    }
+}
+
+/**
+*   Aggregates n records of es bytes into result, groups appear in the order their key is first seen
+*   @return ARRAY_OK_ERROR or ARRAY_OUT_OF_MEM, result only needs array__group_free when it succeeded
+*/
+static inline array_error array__groupby(const void* src, uint64_t es, uint64_t n, array_key_fn key,
+        const array_agg_spec* specs, unsigned nspecs, array__group_table* result) {
+    uint64_t bytes = es * n;
+    uint64_t chunks = bytes < ARRAY_PARALLEL_THRESHOLD ? 1 : array__thread_count();
+    array__group_table* tables = malloc(sizeof(array__group_table) * chunks);
+    if(!tables) {
+        return ARRAY_OUT_OF_MEM;
+    }
+    array_error error = ARRAY_OK_ERROR;
+    for(uint64_t c = 0; c < chunks; ++c) {
+        array__group_init(tables + c, specs, nspecs);
+        error = tables[c].error != ARRAY_OK_ERROR ? tables[c].error : error;
+    }
+    if(error == ARRAY_OK_ERROR) {
+        array__groupby_job job = { src, es, n, (n + chunks - 1) / chunks, key, tables };
+        array__parallel_for(chunks, 1, bytes, array__groupby_task, &job);
+        for(uint64_t c = 0; c < chunks; ++c) {
+            error = tables[c].error != ARRAY_OK_ERROR ? tables[c].error : error;
+        }
+    }
+    /* Merging in chunk order keeps the groups in order of first appearance over the whole array */
+    for(uint64_t c = 1; c < chunks && error == ARRAY_OK_ERROR; ++c) {
+        for(uint64_t g = 0; g < tables[c].groups; ++g) {
+            double* acc = array__group_find(tables, tables[c].keys[g]);
+            if(!acc) {
+                error = ARRAY_OUT_OF_MEM;
+                break;
+            }
+            array__group_merge(specs, nspecs, acc, tables[c].accs + g * nspecs);
+        }
+    }
+    for(uint64_t c = error == ARRAY_OK_ERROR; c < chunks; ++c) {
+        array__group_free(tables + c);
+    }
+    if(error == ARRAY_OK_ERROR) {
+        *result = tables[0];
+    }
+    free(tables);
+    return error;
+}
+
+/**
+*   Computes aggregates of the records of an array for every distinct key
+*   @param array_struct Array struct of records to group
+*   @param key_fn array_key_fn returning the key of a record
+*   @param specs C array of array_agg_spec, each naming an aggregate and the record value it folds
+*   @param n_specs Number of specs
+*   @param keys_struct array_struct(uint64_t) replaced by the distinct keys in order of first appearance
+*   @param aggs_struct array_struct(double) replaced by n_specs aggregates per key, row after row
+*   @note Counts are stored as doubles, min and max of a group without values are INFINITY and -INFINITY
+*   @note key_fn and the value functions are called from several threads above ARRAY_PARALLEL_THRESHOLD bytes
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of keys_struct and aggs_struct to ARRAY_OUT_OF_MEM, array_struct is never modified
+*   @example array_groupby(events, user_of, specs, 3, users, stats);
+*/
+#define array_groupby(array_struct, key_fn, specs, n_specs, keys_struct, aggs_struct) do { \
+        if(array_struct.error != ARRAY_OK_ERROR || keys_struct.error != ARRAY_OK_ERROR || \
+                aggs_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        unsigned array__nspecs = (n_specs); \
+        array__group_table array__groups; \
+        array_error array__error = array__groupby(array_struct.buf, sizeof(*array_struct.buf), array_struct.size, key_fn, \
+            specs, array__nspecs, &array__groups); \
+        if(array__error != ARRAY_OK_ERROR) { \
+            keys_struct.error = array__error; \
+            aggs_struct.error = array__error; \
+            break; \
+        } \
+        array_reserve(uint64_t, keys_struct, array__groups.groups); \
+        array_reserve(double, aggs_struct, array__groups.groups * array__nspecs); \
+        if(keys_struct.error == ARRAY_OK_ERROR && aggs_struct.error == ARRAY_OK_ERROR) { \
+            array__before(keys_struct, 0, keys_struct.size); \
+            memcpy(keys_struct.buf, array__groups.keys, sizeof(uint64_t) * array__groups.groups); \
+            keys_struct.size = array__groups.groups; \
+            array__after(keys_struct, 0, keys_struct.size); \
+            array__before(aggs_struct, 0, aggs_struct.size); \
+            memcpy(aggs_struct.buf, array__groups.accs, sizeof(double) * array__groups.groups * array__nspecs); \
+            aggs_struct.size = array__groups.groups * array__nspecs; \
+            array__after(aggs_struct, 0, aggs_struct.size); \
+        } \
+        array__group_free(&array__groups); \
+    } while(0)
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef ARRAY_HASH_H
+#define ARRAY_HASH_H
+
+#include "array_simd.h"
+
+#define ARRAY__XXH_P1 0x9E3779B185EBCA87ull
+#define ARRAY__XXH_P2 0xC2B2AE3D27D4EB4Full
+#define ARRAY__XXH_P3 0x165667B19E3779F9ull
+#define ARRAY__XXH_P4 0x85EBCA77C2B2AE63ull
+#define ARRAY__XXH_P5 0x27D4EB2F165667C5ull
+
+static inline uint64_t array__rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t array__read64(const unsigned char* p) {
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+}
+
+static inline uint32_t array__read32(const unsigned char* p) {
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap32(x);
+#endif
+    return x;
+}
+
+static inline uint64_t array__xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * ARRAY__XXH_P2;
+    return array__rotl64(acc, 31) * ARRAY__XXH_P1;
+}
+
+static inline uint64_t array__xxh_merge(uint64_t acc, uint64_t val) {
+    acc ^= array__xxh_round(0, val);
+    return acc * ARRAY__XXH_P1 + ARRAY__XXH_P4;
+}
+
+/**
+*   Hashes bytes with XXH64, four independent lanes keep the multipliers busy on 32 byte blocks
+*   @return The same value as the reference XXH64 implementation for the same bytes and seed
+*/
+static inline uint64_t array__hash_bytes(const void* data, uint64_t bytes, uint64_t seed) {
+    const unsigned char* p = data;
+    const unsigned char* end = p + bytes;
+    uint64_t h;
+    if(bytes >= 32) {
+        uint64_t v1 = seed + ARRAY__XXH_P1 + ARRAY__XXH_P2;
+        uint64_t v2 = seed + ARRAY__XXH_P2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - ARRAY__XXH_P1;
+        for(; end - p >= 32; p += 32) {
+            v1 = array__xxh_round(v1, array__read64(p));
+            v2 = array__xxh_round(v2, array__read64(p + 8));
+            v3 = array__xxh_round(v3, array__read64(p + 16));
+            v4 = array__xxh_round(v4, array__read64(p + 24));
+        }
+        h = array__rotl64(v1, 1) + array__rotl64(v2, 7) + array__rotl64(v3, 12) + array__rotl64(v4, 18);
+        h = array__xxh_merge(h, v1);
+        h = array__xxh_merge(h, v2);
+        h = array__xxh_merge(h, v3);
+        h = array__xxh_merge(h, v4);
+    }
+    else {
+        h = seed + ARRAY__XXH_P5;
+    }
+    h += bytes;
+    for(; end - p >= 8; p += 8) {
+        h ^= array__xxh_round(0, array__read64(p));
+        h = array__rotl64(h, 27) * ARRAY__XXH_P1 + ARRAY__XXH_P4;
+    }
+    if(end - p >= 4) {
+        h ^= (uint64_t)array__read32(p) * ARRAY__XXH_P1;
+        h = array__rotl64(h, 23) * ARRAY__XXH_P2 + ARRAY__XXH_P3;
+        p += 4;
+    }
+    for(; p < end; ++p) {
+        h ^= *p * ARRAY__XXH_P5;
+        h = array__rotl64(h, 11) * ARRAY__XXH_P1;
+    }
+    h ^= h >> 33;
+    h *= ARRAY__XXH_P2;
+    h ^= h >> 29;
+    h *= ARRAY__XXH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint32_t array__crc32c_table[8][256];
+
+static inline void array__crc32c_fill(void) {
+    uint32_t (*table)[256] = array__crc32c_table;
+    for(uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for(int k = 0; k < 8; ++k) {
+            c = c & 1 ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+        }
+        table[0][i] = c;
+    }
+    for(uint32_t i = 0; i < 256; ++i) {
+        for(int t = 1; t < 8; ++t) {
+            table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xFF];
+        }
+    }
+}
+
+static inline uint32_t array__crc32c_sw(uint32_t crc, const unsigned char* p, uint64_t bytes) {
+    /* Filled once on first use, parallel_for workers can get here at the same time */
+#if defined(ARRAY_HAS_THREADS)
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, array__crc32c_fill);
+#else
+    static int ready = 0;
+    if(!ready) {
+        array__crc32c_fill();
+        ready = 1;
+    }
+#endif
+    const uint32_t (*table)[256] = (const uint32_t (*)[256])array__crc32c_table;
+    /* Slicing by 8 looks up each byte of a word in its own table */
+    for(; bytes >= 8; bytes -= 8, p += 8) {
+        uint64_t x = array__read64(p) ^ crc;
+        crc = table[7][x & 0xFF] ^ table[6][(x >> 8) & 0xFF] ^ table[5][(x >> 16) & 0xFF] ^ table[4][(x >> 24) & 0xFF]
+            ^ table[3][(x >> 32) & 0xFF] ^ table[2][(x >> 40) & 0xFF] ^ table[1][(x >> 48) & 0xFF] ^ table[0][x >> 56];
+    }
+    for(; bytes > 0; --bytes, ++p) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *p) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(ARRAY_HAS_X86_SIMD) && defined(__x86_64__)
+static inline ARRAY_TARGET("sse4.2") uint32_t array__crc32c_hw(uint32_t crc, const unsigned char* p, uint64_t bytes) {
+    uint64_t c = crc;
+    for(; bytes >= 8; bytes -= 8, p += 8) {
+        uint64_t x;
+        memcpy(&x, p, sizeof(x));
+        c = _mm_crc32_u64(c, x);
+    }
+    crc = (uint32_t)c;
+    for(; bytes > 0; --bytes, ++p) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+#endif
+
+/**
+*   Continues a CRC32C (Castagnoli) checksum over more bytes, using SSE4.2 crc32 instructions when the cpu has them
+*   @param crc Checksum of the bytes so far, 0 to start
+*   @param data Bytes to add
+*   @param bytes Number of bytes
+*   @return Checksum of all bytes
+*   @example uint32_t crc = array_crc32c_update(0, header, sizeof(header));
+*/
+static inline uint32_t array_crc32c_update(uint32_t crc, const void* data, uint64_t bytes) {
+    crc = ~crc;
+#if defined(ARRAY_HAS_X86_SIMD) && defined(__x86_64__)
+    /* Worker threads may ask at the same time, they all store the same answer */
+    static int sse42 = -1;
+    int cached = __atomic_load_n(&sse42, __ATOMIC_RELAXED);
+    if(cached < 0) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("sse4.2") != 0;
+        __atomic_store_n(&sse42, cached, __ATOMIC_RELAXED);
+    }
+    if(cached) {
+        return ~array__crc32c_hw(crc, data, bytes);
+    }
+#endif
+    return ~array__crc32c_sw(crc, data, bytes);
+}
+
+/**
+*   Hashes the contents of the array with the 64 bit XXH64 hash
+*   @param array_struct Array struct to hash
+*   @return Hash of the bytes of the first size elements, identical on every cpu
+*   @warning Element types with padding bytes must have the padding zeroed for equal values to hash equally
+*   @example uint64_t key = array_hash(a);
+*/
+#define array_hash(array_struct) array_hash_seed(array_struct, 0)
+
+/**
+*   Hashes the contents of the array with the 64 bit XXH64 hash and a seed
+*   @param array_struct Array struct to hash
+*   @param seed Seed mixed into the hash
+*   @return Hash of the bytes of the first size elements, identical on every cpu
+*   @example uint64_t key = array_hash_seed(a, 42);
+*/
+#define array_hash_seed(array_struct, seed) \
+    array__hash_bytes(array_struct.buf, sizeof(*array_struct.buf) * array_struct.size, seed)
+
+/**
+*   Computes the CRC32C checksum of the contents of the array
+*   @param array_struct Array struct to checksum
+*   @return Checksum of the bytes of the first size elements
+*   @example uint32_t crc = array_crc32c(a);
+*/
+#define array_crc32c(array_struct) \
+    array_crc32c_update(0, array_struct.buf, sizeof(*array_struct.buf) * array_struct.size)
+
+#endif
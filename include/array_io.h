@@ -0,0 +1,208 @@
+#ifndef ARRAY_IO_H
+#define ARRAY_IO_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "array.h"
+
+/*
+*   File descriptor I/O straight into and out of array buffers. Reads go into the spare capacity past
+*   size, sized up front from fstat when the descriptor is a regular file and otherwise grown by
+*   doubling, so no bytes pass through a temporary buffer. array_writev sends several arrays with a
+*   single writev.
+*
+*   array_struct(char) text;
+*   array_init(char, text, 1);
+*   array_read_file(text, "input.csv");
+*
+*   struct iovec parts[] = { array_iov(header), array_iov(rows) };
+*   array_writev(fd, parts, 2);
+*
+*   Needs pread, define _POSIX_C_SOURCE 200809L when building with -std=c11.
+*/
+
+/* Entries passed to one writev, below every IOV_MAX */
+#if defined(IOV_MAX) && IOV_MAX < 64
+#define ARRAY__IOV_BATCH IOV_MAX
+#else
+#define ARRAY__IOV_BATCH 64
+#endif
+
+/**
+*   Writes all n bytes, retrying partial and interrupted writes
+*   @return ARRAY_OK_ERROR or ARRAY_IO_ERROR
+*/
+static inline array_error array__write_all(int fd, const void* bytes, uint64_t n) {
+    const unsigned char* p = bytes;
+    while(n > 0) {
+        ssize_t done = write(fd, p, n);
+        if(done < 0 && errno == EINTR) {
+            continue;
+        }
+        if(done <= 0) {
+            return ARRAY_IO_ERROR;
+        }
+        p += done;
+        n -= (uint64_t)done;
+    }
+    return ARRAY_OK_ERROR;
+}
+
+/**
+*   Writes several buffers in order with as few writev calls as possible
+*   @param fd File descriptor to write to
+*   @param iov Buffers to write, array_iov makes one from an array, left unchanged
+*   @param count Number of buffers
+*   @return ARRAY_OK_ERROR or ARRAY_IO_ERROR
+*   @note Partial and interrupted writes are resumed where they stopped
+*   @example array_writev(fd, parts, 3);
+*/
+static inline array_error array_writev(int fd, const struct iovec* iov, uint64_t count) {
+    struct iovec batch[ARRAY__IOV_BATCH];
+    uint64_t skip = 0;
+    for(uint64_t i = 0; i < count; ) {
+        int n = 0;
+        for(; n < ARRAY__IOV_BATCH && i + n < count; ++n) {
+            batch[n] = iov[i + n];
+        }
+        batch[0].iov_base = (unsigned char*)batch[0].iov_base + skip;
+        batch[0].iov_len -= skip;
+        ssize_t done = writev(fd, batch, n);
+        if(done < 0 && errno == EINTR) {
+            continue;
+        }
+        if(done < 0) {
+            return ARRAY_IO_ERROR;
+        }
+        /* Step over the buffers written in full, remembering how far into the next one the write got */
+        uint64_t left = (uint64_t)done + skip;
+        for(; i < count && left >= iov[i].iov_len; ++i) {
+            left -= iov[i].iov_len;
+        }
+        skip = left;
+        if(done == 0 && i < count) {
+            return ARRAY_IO_ERROR;
+        }
+    }
+    return ARRAY_OK_ERROR;
+}
+
+/**
+*   Describes the values of an array as a buffer for array_writev
+*   @param array_struct Array struct to write
+*   @return struct iovec over the size values of the array
+*   @example struct iovec parts[] = { array_iov(a), array_iov(b) };
+*/
+#define array_iov(array_struct) ((struct iovec){ (void*)array_struct.buf, sizeof(*array_struct.buf) * array_struct.size })
+
+/**
+*   Reads up to max bytes into the spare capacity of an array, from offset when it is not negative
+*   @return ARRAY_OK_ERROR, ARRAY_OUT_OF_MEM, ARRAY_IO_ERROR or ARRAY_SIZE_MISMATCH when the data ended
+*   inside an element, size and capacity are updated in every case
+*/
+static inline array_error array__read_fd(int fd, int64_t offset, uint64_t max, array_allocator* alloc, void** buf,
+        uint64_t* capacity, uint64_t* size, uint64_t es) {
+    uint64_t start = *size * es;
+    uint64_t filled = start;
+    uint64_t end = max < UINT64_MAX - filled ? filled + max : UINT64_MAX;
+    struct stat st;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        int64_t at = offset >= 0 ? offset : (int64_t)lseek(fd, 0, SEEK_CUR);
+        uint64_t left = at >= 0 && st.st_size > at ? (uint64_t)(st.st_size - at) : 0;
+        uint64_t want = filled + left < end ? filled + left : end;
+        uint64_t need = want / es + (want % es != 0);
+        if(need > *capacity) {
+            /* On failure the loop below still grows the buffer step by step */
+            void* temp = array__realloc(alloc, *buf, es * *capacity, es * need);
+            if(temp) {
+                *buf = temp;
+                *capacity = need;
+            }
+        }
+    }
+    array_error error = ARRAY_OK_ERROR;
+    while(filled < end) {
+        uint64_t room = *capacity * es - filled;
+        unsigned char probe[64];
+        /* With no room left, try a small read before growing, the file is most often at its end */
+        unsigned char* dst = room > 0 ? (unsigned char*)*buf + filled : probe;
+        uint64_t want = room > 0 ? room : sizeof(probe);
+        want = want < end - filled ? want : end - filled;
+        ssize_t got = offset >= 0 ? pread(fd, dst, want, (off_t)(offset + filled - start)) : read(fd, dst, want);
+        if(got < 0 && errno == EINTR) {
+            continue;
+        }
+        if(got <= 0) {
+            error = got < 0 ? ARRAY_IO_ERROR : ARRAY_OK_ERROR;
+            break;
+        }
+        if(dst == probe) {
+            void* temp = array__grow(alloc, *buf, es, capacity, (filled + (uint64_t)got) / es + 1);
+            if(!temp) {
+                error = ARRAY_OUT_OF_MEM;
+                break;
+            }
+            *buf = temp;
+            memcpy((unsigned char*)*buf + filled, probe, (uint64_t)got);
+        }
+        filled += (uint64_t)got;
+    }
+    *size = filled / es;
+    return error == ARRAY_OK_ERROR && filled % es != 0 ? ARRAY_SIZE_MISMATCH : error;
+}
+
+/**
+*   Appends data read from a file descriptor to an array, without copying it through another buffer
+*   @param array_struct Array struct to append to, the bytes are read as its values
+*   @param fd File descriptor to read from, at its current position
+*   @param max Most bytes to read, UINT64_MAX to read until the end of the data
+*   @note Regular files are sized with fstat and read into exactly enough capacity, pipes and sockets
+*   grow the capacity by doubling
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM, ARRAY_IO_ERROR, or ARRAY_SIZE_MISMATCH when the data
+*   ends inside a value, the values read in full are kept in every case
+*   @example array_read_fd(a, STDIN_FILENO, UINT64_MAX);
+*/
+#define array_read_fd(array_struct, fd, max) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            uint64_t array__old = array_struct.size; \
+            void* array__buf = array_struct.buf; \
+            array_struct.error = array__read_fd((fd), -1, (max), array_struct.alloc, &array__buf, &array_struct.capacity, \
+                &array_struct.size, sizeof(*array_struct.buf)); \
+            array_struct.buf = array__buf; \
+            array__after(array_struct, array__old, array_struct.size); \
+        } \
+    } while(0)
+
+/**
+*   Appends the contents of a file to an array
+*   @param array_struct Array struct to append to, the bytes are read as its values
+*   @param path Path of the file
+*   @note The capacity is grown once to fit the file, which is read with pread
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM, ARRAY_IO_ERROR, or ARRAY_SIZE_MISMATCH when the file
+*   ends inside a value
+*   @example array_read_file(text, "input.csv");
+*/
+#define array_read_file(array_struct, path) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            int array__fd = open((path), O_RDONLY); \
+            if(array__fd < 0) { \
+                array_struct.error = ARRAY_IO_ERROR; \
+                break; \
+            } \
+            uint64_t array__old = array_struct.size; \
+            void* array__buf = array_struct.buf; \
+            array_struct.error = array__read_fd(array__fd, 0, UINT64_MAX, array_struct.alloc, &array__buf, \
+                &array_struct.capacity, &array_struct.size, sizeof(*array_struct.buf)); \
+            array_struct.buf = array__buf; \
+            close(array__fd); \
+            array__after(array_struct, array__old, array_struct.size); \
+        } \
+    } while(0)
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef ARRAY_JOIN_H
+#define ARRAY_JOIN_H
+
+#include "array_partition.h"
+#include "array_groupby.h"
+
+/*
+*   An equi-join pairs every record of one array with every record of another that has the same key.
+*   A chained hash table is built over the keys of the smaller array and probed with the larger one.
+*   When the table would not fit in ARRAY_JOIN_CACHE_BYTES both sides are first radix partitioned on
+*   the top bits of the key hash with array_partition, then each pair of partitions is joined on its
+*   own, in parallel above ARRAY_PARALLEL_THRESHOLD bytes.
+*
+*   array_struct(uint64_t) req_idx, resp_idx;
+*   array_join(requests, request_id_of, responses, response_id_of, req_idx, resp_idx);
+*   // requests.buf[req_idx.buf[i]] and responses.buf[resp_idx.buf[i]] have the same key
+*/
+
+/**
+*   Size of the build side above which a join partitions its inputs first, should be about the size of the L2 cache
+*   @note Define before including array_join.h to override
+*/
+#ifndef ARRAY_JOIN_CACHE_BYTES
+#define ARRAY_JOIN_CACHE_BYTES (1ull << 20)
+#endif
+
+typedef struct {
+    uint64_t key;
+    uint64_t index;
+} array__join_row;
+
+typedef array_struct(array__join_row) array__join_rows;
+typedef array_struct(uint64_t) array__index_array;
+
+typedef struct {
+    array__join_rows* build;
+    array__join_rows* probe;
+    array__index_array* out_l;
+    array__index_array* out_r;
+    int build_is_left;
+} array__join_job;
+
+static inline uint64_t array__join_part_of(const void* row, void* ctx) {
+    return array__mix64(((const array__join_row*)row)->key) >> *(unsigned*)ctx;
+}
+
+/**
+*   Joins build rows with probe rows through a chained hash table, chains list rows in ascending order
+*   @note Matches are added to out_l and out_r as (left index, right index) whichever side was built
+*/
+static inline void array__join_rows_into(const array__join_row* build, uint64_t nb, const array__join_row* probe, uint64_t np,
+        int build_is_left, array__index_array* out_l, array__index_array* out_r) {
+    if(nb == 0 || np == 0) {
+        return;
+    }
+    uint64_t mask = 1;
+    while(mask < nb) {
+        mask *= 2;
+    }
+    mask = mask * 2 - 1;
+    /* heads and next hold row + 1 so that 0 ends a chain */
+    uint64_t* heads = calloc(mask + 1, sizeof(uint64_t));
+    uint64_t* next = malloc(sizeof(uint64_t) * nb);
+    if(!heads || !next) {
+        free(heads);
+        free(next);
+        out_l->error = ARRAY_OUT_OF_MEM;
+        return;
+    }
+    for(uint64_t i = nb; i-- > 0; ) {
+        uint64_t h = array__mix64(build[i].key) & mask;
+        next[i] = heads[h];
+        heads[h] = i + 1;
+    }
+    for(uint64_t j = 0; j < np; ++j) {
+        uint64_t key = probe[j].key;
+        for(uint64_t e = heads[array__mix64(key) & mask]; e; e = next[e - 1]) {
+            if(build[e - 1].key == key) {
+                array_add(uint64_t, (*out_l), build_is_left ? build[e - 1].index : probe[j].index);
+                array_add(uint64_t, (*out_r), build_is_left ? probe[j].index : build[e - 1].index);
+            }
+        }
+    }
+    if(out_r->error != ARRAY_OK_ERROR) {
+        out_l->error = out_r->error;
+    }
+    free(heads);
+    free(next);
+}
+
+static inline void array__join_task(void* ctx, uint64_t begin, uint64_t end) {
+    array__join_job* job = ctx;
+    for(uint64_t p = begin; p < end; ++p) {
+        array__join_rows_into(job->build[p].buf, job->build[p].size, job->probe[p].buf, job->probe[p].size,
+            job->build_is_left, job->out_l + p, job->out_r + p);
+    }
+}
+
+static inline array_error array__join_keys(const unsigned char* src, uint64_t es, uint64_t n, array_key_fn key,
+        array__join_rows* rows) {
+    array_init(array__join_row, (*rows), n > 0 ? n : 1);
+    if(rows->error == ARRAY_OK_ERROR) {
+        for(uint64_t i = 0; i < n; ++i) {
+            rows->buf[i].key = key(src + es * i);
+            rows->buf[i].index = i;
+        }
+        rows->size = n;
+    }
+    return rows->error;
+}
+
+/**
+*   Joins two record arrays on their keys into out_l and out_r, which must be initialized and empty
+*   @note The partitions are allocated like out_l, the per thread outputs always on the heap
+*   @return ARRAY_OK_ERROR or ARRAY_OUT_OF_MEM
+*/
+static inline array_error array__hash_join(const void* left, uint64_t left_es, uint64_t left_n, array_key_fn left_key,
+        const void* right, uint64_t right_es, uint64_t right_n, array_key_fn right_key,
+        array__index_array* out_l, array__index_array* out_r) {
+    array__join_rows rows[2];
+    array_error error = array__join_keys(left, left_es, left_n, left_key, rows);
+    if(error != ARRAY_OK_ERROR) {
+        return error;
+    }
+    error = array__join_keys(right, right_es, right_n, right_key, rows + 1);
+    if(error != ARRAY_OK_ERROR) {
+        array_free(rows[0]);
+        return error;
+    }
+    int build_is_left = left_n <= right_n;
+    array__join_rows* build = rows + !build_is_left;
+    array__join_rows* probe = rows + build_is_left;
+    if(sizeof(array__join_row) * build->size <= ARRAY_JOIN_CACHE_BYTES) {
+        array__join_rows_into(build->buf, build->size, probe->buf, probe->size, build_is_left, out_l, out_r);
+        array_free(rows[0]);
+        array_free(rows[1]);
+        return out_l->error;
+    }
+    unsigned bits = 1;
+    while(bits < 12 && (sizeof(array__join_row) * build->size >> bits) > ARRAY_JOIN_CACHE_BYTES / 2) {
+        ++bits;
+    }
+    unsigned shift = 64 - bits;
+    uint64_t parts = 1ull << bits;
+    array__join_rows* split = malloc(sizeof(array__join_rows) * 2 * parts);
+    array__index_array* outs = malloc(sizeof(array__index_array) * 2 * parts);
+    uint64_t ready = 0;
+    for(; split && outs && ready < 2 * parts; ++ready) {
+        array_init(array__join_row, split[ready], 1);
+        array_init(uint64_t, outs[ready], 1);
+        if(out_l->alloc) {
+            array_set_allocator(split[ready], out_l->alloc);
+        }
+    }
+    if(!split || !outs) {
+        error = ARRAY_OUT_OF_MEM;
+    }
+    for(uint64_t p = 0; p < ready; ++p) {
+        error = split[p].error != ARRAY_OK_ERROR || outs[p].error != ARRAY_OK_ERROR ? ARRAY_OUT_OF_MEM : error;
+    }
+    if(error == ARRAY_OK_ERROR) {
+        array_partition(array__join_row, (*build), split, parts, array__join_part_of, &shift);
+        array_partition(array__join_row, (*probe), split + parts, parts, array__join_part_of, &shift);
+        error = build->error != ARRAY_OK_ERROR ? build->error : probe->error;
+        for(uint64_t p = 0; p < 2 * parts && error == ARRAY_OK_ERROR; ++p) {
+            error = split[p].error;
+        }
+    }
+    array_free(rows[0]);
+    array_free(rows[1]);
+    if(error == ARRAY_OK_ERROR) {
+        array__join_job job = { split, split + parts, outs, outs + parts, build_is_left };
+        array__parallel_for(parts, 1, sizeof(array__join_row) * (left_n + right_n), array__join_task, &job);
+        uint64_t total = 0;
+        for(uint64_t p = 0; p < parts; ++p) {
+            error = outs[p].error != ARRAY_OK_ERROR ? outs[p].error : error;
+            total += outs[p].size;
+        }
+        array_reserve(uint64_t, (*out_l), total);
+        array_reserve(uint64_t, (*out_r), total);
+        if(error == ARRAY_OK_ERROR && out_l->error == ARRAY_OK_ERROR && out_r->error == ARRAY_OK_ERROR) {
+            for(uint64_t p = 0; p < parts; ++p) {
+                memcpy(out_l->buf + out_l->size, outs[p].buf, sizeof(uint64_t) * outs[p].size);
+                memcpy(out_r->buf + out_r->size, outs[parts + p].buf, sizeof(uint64_t) * outs[p].size);
+                out_l->size += outs[p].size;
+                out_r->size += outs[p].size;
+            }
+        }
+        error = error != ARRAY_OK_ERROR ? error : out_l->error != ARRAY_OK_ERROR ? out_l->error : out_r->error;
+    }
+    for(uint64_t p = 0; p < ready; ++p) {
+        array_free(split[p]);
+        array_free(outs[p]);
+    }
+    free(split);
+    free(outs);
+    return error;
+}
+
+/**
+*   Finds every pair of records of two arrays with equal keys
+*   @param left_struct First array struct of records
+*   @param left_key array_key_fn returning the key of a record of left_struct
+*   @param right_struct Second array struct of records
+*   @param right_key array_key_fn returning the key of a record of right_struct
+*   @param left_out array_struct(uint64_t) replaced by the left index of every matching pair
+*   @param right_out array_struct(uint64_t) replaced by the right index of every matching pair
+*   @note The order of the pairs is unspecified, a key occurring a times on the left and b times on the right gives a * b pairs
+*   @note Each key function is called once per record
+*   @note The pairs and partitions built along the way come from the allocator of left_out when it has one
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of left_out and right_out to ARRAY_OUT_OF_MEM, the inputs are never modified
+*   @example array_join(requests, request_id_of, responses, response_id_of, req_idx, resp_idx);
+*/
+#define array_join(left_struct, left_key, right_struct, right_key, left_out, right_out) do { \
+        if(left_struct.error != ARRAY_OK_ERROR || right_struct.error != ARRAY_OK_ERROR || \
+                left_out.error != ARRAY_OK_ERROR || right_out.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        array__index_array array__join_l; \
+        array__index_array array__join_r; \
+        array_init(uint64_t, array__join_l, 16); \
+        array_init(uint64_t, array__join_r, 16); \
+        if(left_out.alloc) { \
+            array_set_allocator(array__join_l, left_out.alloc); \
+            array_set_allocator(array__join_r, left_out.alloc); \
+        } \
+        array_error array__error = array__join_l.error != ARRAY_OK_ERROR ? array__join_l.error : array__join_r.error; \
+        if(array__error == ARRAY_OK_ERROR) { \
+            array__error = array__hash_join(left_struct.buf, sizeof(*left_struct.buf), left_struct.size, left_key, \
+                right_struct.buf, sizeof(*right_struct.buf), right_struct.size, right_key, &array__join_l, &array__join_r); \
+        } \
+        if(array__error != ARRAY_OK_ERROR) { \
+            left_out.error = array__error; \
+            right_out.error = array__error; \
+        } \
+        else { \
+            array_reserve(uint64_t, left_out, array__join_l.size); \
+            array_reserve(uint64_t, right_out, array__join_r.size); \
+        } \
+        if(array__error == ARRAY_OK_ERROR && left_out.error == ARRAY_OK_ERROR && right_out.error == ARRAY_OK_ERROR) { \
+            array__before(left_out, 0, left_out.size); \
+            memcpy(left_out.buf, array__join_l.buf, sizeof(uint64_t) * array__join_l.size); \
+            left_out.size = array__join_l.size; \
+            array__after(left_out, 0, left_out.size); \
+            array__before(right_out, 0, right_out.size); \
+            memcpy(right_out.buf, array__join_r.buf, sizeof(uint64_t) * array__join_r.size); \
+            right_out.size = array__join_r.size; \
+            array__after(right_out, 0, right_out.size); \
+        } \
+        array_free(array__join_l); \
+        array_free(array__join_r); \
+    } while(0)
+
+#endif
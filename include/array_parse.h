@@ -0,0 +1,423 @@
+#ifndef ARRAY_PARSE_H
+#define ARRAY_PARSE_H
+
+#include <stdlib.h>
+#include "array_simd.h"
+
+/*
+*   Parsers for delimited numeric text held in a char array, such as CSV files of integers or floats.
+*   The text is scanned 64 bytes at a time, comparing every byte against the delimiter and newline at
+*   once with AVX2 where available, which gives a bit mask of the field ends in each block. Fields are
+*   converted by hand without locale or allocation, doubles take an exact fast path whenever the digits
+*   fit in 53 bits and the exponent is small, and only fall back to strtod otherwise.
+*
+*   Above ARRAY_PARALLEL_THRESHOLD bytes the text is cut into one chunk per thread at line boundaries.
+*   A first pass counts the fields of every chunk, so each chunk then converts straight into its own
+*   slice of the output.
+*
+*   Fields end at the delimiter or at a newline, lines holding nothing but spaces, tabs and carriage
+*   returns are skipped and the same characters around a number are ignored. Values are stored row after row in a flat array.
+*
+*   array_struct(double) values;
+*   array_read_file(text, "points.csv");
+*   array_parse_double(text, ',', values);
+*/
+
+enum {
+    ARRAY__PARSE_COUNT,
+    ARRAY__PARSE_OFFSETS,
+    ARRAY__PARSE_INT64,
+    ARRAY__PARSE_DOUBLE
+};
+
+typedef struct {
+    const char* text;
+    uint64_t n;
+    char delim;
+    int mode;
+    void* out;
+    uint64_t chunks;
+    uint64_t bounds[ARRAY_MAX_THREADS + 1];
+    uint64_t counts[ARRAY_MAX_THREADS];
+    uint64_t filled[ARRAY_MAX_THREADS];
+    array_error errors[ARRAY_MAX_THREADS];
+} array__parse_job;
+
+static const double array__parse_pow10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline int array__parse_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/**
+*   Converts the characters from s to e to an int64_t
+*   @return 1 on success, 0 if they are not one integer in range
+*/
+static inline int array__parse_i64(const char* s, const char* e, int64_t* out) {
+    while(s < e && array__parse_space(*s)) {
+        ++s;
+    }
+    while(e > s && array__parse_space(e[-1])) {
+        --e;
+    }
+    int neg = s < e && *s == '-';
+    s += s < e && (*s == '-' || *s == '+');
+    if(s == e) {
+        return 0;
+    }
+    while(e - s > 1 && *s == '0') {
+        ++s;
+    }
+    /* 19 digits always fit in a uint64_t */
+    if(e - s > 19) {
+        return 0;
+    }
+    uint64_t v = 0;
+    for(; s < e; ++s) {
+        unsigned d = (unsigned)(*s - '0');
+        if(d > 9) {
+            return 0;
+        }
+        v = v * 10 + d;
+    }
+    if(v > (uint64_t)INT64_MAX + neg) {
+        return 0;
+    }
+    *out = neg ? (int64_t)(0 - v) : (int64_t)v;
+    return 1;
+}
+
+/**
+*   Converts the characters from s to e to a double, correctly rounded
+*   @return 1 on success, 0 if they are not one number
+*/
+static inline int array__parse_f64(const char* s, const char* e, double* out) {
+    while(s < e && array__parse_space(*s)) {
+        ++s;
+    }
+    while(e > s && array__parse_space(e[-1])) {
+        --e;
+    }
+    const char* start = s;
+    int neg = s < e && *s == '-';
+    s += s < e && (*s == '-' || *s == '+');
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exp10 = 0;
+    int seen = 0;
+    int lossy = 0;
+    for(; s < e && (unsigned)(*s - '0') <= 9; ++s, seen = 1) {
+        if(digits < 19) {
+            mantissa = mantissa * 10 + (unsigned)(*s - '0');
+            digits += mantissa > 0;
+        }
+        else {
+            lossy |= *s != '0';
+            ++exp10;
+        }
+    }
+    if(s < e && *s == '.') {
+        for(++s; s < e && (unsigned)(*s - '0') <= 9; ++s, seen = 1) {
+            if(digits < 19) {
+                mantissa = mantissa * 10 + (unsigned)(*s - '0');
+                digits += mantissa > 0;
+                --exp10;
+            }
+            else {
+                lossy |= *s != '0';
+            }
+        }
+    }
+    if(seen && s < e && (*s == 'e' || *s == 'E')) {
+        const char* mark = s++;
+        int eneg = s < e && *s == '-';
+        s += s < e && (*s == '-' || *s == '+');
+        int ev = 0;
+        int edigits = 0;
+        for(; s < e && (unsigned)(*s - '0') <= 9; ++s, ++edigits) {
+            ev = ev < 10000 ? ev * 10 + (*s - '0') : ev;
+        }
+        s = edigits ? s : mark;
+        exp10 += eneg ? -ev : ev;
+    }
+    /* Exact when the digits and the power of ten are both exact doubles, like strtod would round it */
+    if(seen && s == e && !lossy && mantissa <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+        double v = (double)mantissa;
+        v = exp10 < 0 ? v / array__parse_pow10[-exp10] : v * array__parse_pow10[exp10];
+        *out = neg ? -v : v;
+        return 1;
+    }
+    /* Short fields are copied to the stack, only fields this long allocate */
+    char small[128];
+    uint64_t len = (uint64_t)(e - start);
+    char* temp = len < sizeof(small) ? small : malloc(len + 1);
+    if(len == 0 || !temp) {
+        return 0;
+    }
+    memcpy(temp, start, len);
+    temp[len] = '\0';
+    char* stop;
+    *out = strtod(temp, &stop);
+    int ok = stop == temp + len;
+    if(temp != small) {
+        free(temp);
+    }
+    return ok;
+}
+
+/* Sets a bit in d for every delimiter and in l for every newline among 64 bytes */
+static inline void array__parse_masks_scalar(const char* p, char delim, uint64_t* d, uint64_t* l) {
+    uint64_t dm = 0;
+    uint64_t lm = 0;
+    for(unsigned k = 0; k < 64; ++k) {
+        dm |= (uint64_t)(p[k] == delim) << k;
+        lm |= (uint64_t)(p[k] == '\n') << k;
+    }
+    *d = dm;
+    *l = lm;
+}
+
+#if defined(ARRAY_HAS_X86_SIMD)
+static inline ARRAY_TARGET("avx2") void array__parse_masks_avx2(const char* p, char delim, uint64_t* d, uint64_t* l) {
+    const __m256i vd = _mm256_set1_epi8(delim);
+    const __m256i vl = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256((const __m256i*)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(p + 32));
+    *d = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vd)) |
+        (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vd)) << 32;
+    *l = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vl)) |
+        (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vl)) << 32;
+}
+#endif
+
+static inline int array__parse_blank(const char* s, const char* e) {
+    while(s < e && array__parse_space(*s)) {
+        ++s;
+    }
+    return s == e;
+}
+
+/**
+*   Handles the field ending at end, which started at start
+*   @return 0 if the field is not a valid number
+*/
+static inline int array__parse_emit(array__parse_job* job, uint64_t* at, uint64_t start, uint64_t end) {
+    switch(job->mode) {
+    case ARRAY__PARSE_OFFSETS:
+        ((uint64_t*)job->out)[(*at)++] = end;
+        return 1;
+    case ARRAY__PARSE_INT64:
+        return array__parse_i64(job->text + start, job->text + end, (int64_t*)job->out + (*at)++);
+    case ARRAY__PARSE_DOUBLE:
+        return array__parse_f64(job->text + start, job->text + end, (double*)job->out + (*at)++);
+    }
+    ++*at;
+    return 1;
+}
+
+/**
+*   Counts or converts the fields of one chunk, which starts at the beginning of a line
+*   @note A newline right after another one, or at the start of the chunk, is an empty line and ends no field,
+*   so counting stays a popcount. Lines of only spaces, tabs or carriage returns are still counted as one field
+*   and skipped when converting, the chunk then fills less than it counted.
+*/
+static inline void array__parse_chunk(array__parse_job* job, uint64_t c) {
+    const char* text = job->text;
+    uint64_t b = job->bounds[c];
+    uint64_t e = job->bounds[c + 1];
+    uint64_t at = job->counts[c];
+    uint64_t start = b;
+    uint64_t carry = 1;
+    int line_start = 1;
+    int simd = 0;
+#if defined(ARRAY_HAS_X86_SIMD)
+    simd = array_cpu_isa() != ARRAY_ISA_SCALAR;
+#endif
+    for(uint64_t base = b; base < e; base += 64) {
+        uint64_t dm;
+        uint64_t lm;
+        uint64_t valid = e - base >= 64 ? ~0ull : (1ull << (e - base)) - 1;
+        const char* p = text + base;
+        char tail[64];
+        if(e - base < 64) {
+            memcpy(tail, p, e - base);
+            p = tail;
+        }
+#if defined(ARRAY_HAS_X86_SIMD)
+        if(simd) {
+            array__parse_masks_avx2(p, job->delim, &dm, &lm);
+        }
+        else
+#endif
+        {
+            array__parse_masks_scalar(p, job->delim, &dm, &lm);
+        }
+        (void)simd;
+        dm &= valid;
+        lm &= valid;
+        uint64_t blank = lm & (lm << 1 | carry);
+        carry = lm >> 63;
+        uint64_t ends = dm | (lm & ~blank);
+        if(job->mode == ARRAY__PARSE_COUNT) {
+            at += array__popcount64(ends);
+            continue;
+        }
+        for(; ends; ends &= ends - 1) {
+            unsigned bit = array__ctz64(ends);
+            uint64_t end = base + bit;
+            int newline = (int)(lm >> bit & 1);
+            if(!(line_start && newline && array__parse_blank(text + start, text + end)) &&
+                    !array__parse_emit(job, &at, start, end)) {
+                job->errors[c] = ARRAY_INVALID_DATA;
+                return;
+            }
+            line_start = newline;
+            start = end + 1;
+        }
+    }
+    /* Only the last chunk can end without a newline, its last line is one more field */
+    if(e > b && text[e - 1] != '\n') {
+        if(job->mode == ARRAY__PARSE_COUNT) {
+            ++at;
+        }
+        else if(!(line_start && array__parse_blank(text + start, text + e)) && !array__parse_emit(job, &at, start, e)) {
+            job->errors[c] = ARRAY_INVALID_DATA;
+            return;
+        }
+    }
+    if(job->mode == ARRAY__PARSE_COUNT) {
+        job->counts[c] = at;
+    }
+    else {
+        job->filled[c] = at - job->counts[c];
+    }
+}
+
+static inline void array__parse_task(void* ctx, uint64_t begin, uint64_t end) {
+    for(uint64_t c = begin; c < end; ++c) {
+        array__parse_chunk(ctx, c);
+    }
+}
+
+/**
+*   Counts the fields of the text, cut into chunks at line boundaries
+*   @return Number of fields, job holds the chunks and where each one starts in the output
+*/
+static inline uint64_t array__parse_plan(array__parse_job* job, const char* text, uint64_t n, char delim) {
+    uint64_t chunks = n < ARRAY_PARALLEL_THRESHOLD ? 1 : array__thread_count();
+    job->chunks = chunks;
+    job->text = text;
+    job->n = n;
+    job->delim = delim;
+    job->mode = ARRAY__PARSE_COUNT;
+    job->bounds[0] = 0;
+    for(uint64_t c = 1; c < chunks; ++c) {
+        uint64_t at = n / chunks * c;
+        at = at > job->bounds[c - 1] ? at : job->bounds[c - 1];
+        const char* nl = at < n ? memchr(text + at, '\n', n - at) : NULL;
+        job->bounds[c] = nl ? (uint64_t)(nl - text) + 1 : n;
+    }
+    job->bounds[chunks] = n;
+    for(uint64_t c = 0; c < chunks; ++c) {
+        job->counts[c] = 0;
+        job->errors[c] = ARRAY_OK_ERROR;
+    }
+    array__parallel_for(chunks, 1, n, array__parse_task, job);
+    uint64_t total = 0;
+    for(uint64_t c = 0; c < chunks; ++c) {
+        uint64_t count = job->counts[c];
+        job->counts[c] = total;
+        total += count;
+    }
+    return total;
+}
+
+/**
+*   Writes the fields of the text into out, which has room for all of them
+*   @return ARRAY_OK_ERROR or ARRAY_INVALID_DATA if a field is not a number, filled is set to the number of
+*   values written
+*/
+static inline array_error array__parse_run(array__parse_job* job, int mode, void* out, uint64_t* filled) {
+    job->mode = mode;
+    job->out = out;
+    *filled = 0;
+    array__parallel_for(job->chunks, 1, job->n, array__parse_task, job);
+    for(uint64_t c = 0; c < job->chunks; ++c) {
+        if(job->errors[c] != ARRAY_OK_ERROR) {
+            return job->errors[c];
+        }
+    }
+    /* Chunks that skipped blank lines left gaps behind their values, close them up */
+    for(uint64_t c = 0; c < job->chunks; ++c) {
+        if(*filled != job->counts[c]) {
+            memmove((uint64_t*)out + *filled, (uint64_t*)out + job->counts[c], sizeof(uint64_t) * job->filled[c]);
+        }
+        *filled += job->filled[c];
+    }
+    return ARRAY_OK_ERROR;
+}
+
+/*
+*   Counts the fields of text_struct, sizes out_struct for them and fills it with mode
+*/
+#define array__parse(text_struct, delim, out_struct, mode) do { \
+        if(text_struct.error != ARRAY_OK_ERROR || out_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        array__parse_job array__job; \
+        uint64_t array__fields = array__parse_plan(&array__job, text_struct.buf, text_struct.size, (delim)); \
+        array__reserve_exact(out_struct, array__fields); \
+        if(out_struct.error == ARRAY_OK_ERROR) { \
+            uint64_t array__filled; \
+            array__before(out_struct, 0, out_struct.size); \
+            out_struct.error = array__parse_run(&array__job, mode, out_struct.buf, &array__filled); \
+            out_struct.size = out_struct.error == ARRAY_OK_ERROR ? array__filled : 0; \
+            array__after(out_struct, 0, out_struct.size); \
+        } \
+    } while(0)
+
+/**
+*   Finds where every field of delimited text ends
+*   @param text_struct array_struct(char) holding the text
+*   @param delim Character separating fields on a line, newlines separate lines
+*   @param offsets_struct array_struct(uint64_t) replaced by the index one past the end of every field
+*   @note A field starts one past the end of the previous one, surrounding whitespace included
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of offsets_struct to ARRAY_OUT_OF_MEM
+*   @example array_parse_offsets(text, ',', ends);
+*/
+#define array_parse_offsets(text_struct, delim, offsets_struct) \
+    array__parse(text_struct, delim, offsets_struct, ARRAY__PARSE_OFFSETS)
+
+/**
+*   Parses every field of delimited text as a decimal integer
+*   @param text_struct array_struct(char) holding the text
+*   @param delim Character separating fields on a line, newlines separate lines
+*   @param out_struct array_struct(int64_t) replaced by the values, row after row
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of out_struct to ARRAY_OUT_OF_MEM, or to ARRAY_INVALID_DATA if a field is not
+*   an integer in range, out_struct is then left empty
+*   @example array_parse_int64(text, ',', ids);
+*/
+#define array_parse_int64(text_struct, delim, out_struct) \
+    array__parse(text_struct, delim, out_struct, ARRAY__PARSE_INT64)
+
+/**
+*   Parses every field of delimited text as a floating point number
+*   @param text_struct array_struct(char) holding the text
+*   @param delim Character separating fields on a line, newlines separate lines
+*   @param out_struct array_struct(double) replaced by the values, row after row
+*   @note Accepts what strtod accepts in the C locale and rounds the same way, only fields with more than
+*   19 digits or large exponents go through strtod
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of out_struct to ARRAY_OUT_OF_MEM, or to ARRAY_INVALID_DATA if a field is not
+*   a number, out_struct is then left empty
+*   @example array_parse_double(text, ',', values);
+*/
+#define array_parse_double(text_struct, delim, out_struct) \
+    array__parse(text_struct, delim, out_struct, ARRAY__PARSE_DOUBLE)
+
+#endif
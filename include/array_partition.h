@@ -0,0 +1,235 @@
+#ifndef ARRAY_PARTITION_H
+#define ARRAY_PARTITION_H
+
+#include "array.h"
+
+/*
+*   Partitioning splits an array into several arrays by a partition number computed per element. A
+*   first pass counts every partition so each output is sized exactly once, a second pass scatters the
+*   elements through small per partition buffers that are written out a few cache lines at a time, so
+*   the stores to many outputs do not thrash the TLB and cache. Both passes split the array across
+*   threads above ARRAY_PARALLEL_THRESHOLD bytes, each thread writing to its own slice of every output.
+*
+*   static uint64_t by_user(const void* elem, void* ctx) { return ((const event*)elem)->user % 16; }
+*   array_struct(event) parts[16];
+*   for(int p = 0; p < 16; ++p) array_init(event, parts[p], 1);
+*   array_partition(event, events, parts, 16, by_user, NULL);
+*/
+
+/**
+*   Bytes buffered per partition before they are written to the output
+*   @note Define before including array_partition.h to override, a few cache lines works best
+*/
+#ifndef ARRAY_PARTITION_BUFFER
+#define ARRAY_PARTITION_BUFFER 256
+#endif
+
+/**
+*   Most bytes of partition buffers per thread, with many partitions each buffer shrinks to fit
+*   @note Define before including array_partition.h to override, the buffers should stay in the L1 or L2 cache
+*   @note Partitions that would get less than two elements of buffer are scattered directly to the outputs
+*/
+#ifndef ARRAY_PARTITION_BUFFER_LIMIT
+#define ARRAY_PARTITION_BUFFER_LIMIT (128 * 1024)
+#endif
+
+typedef uint64_t (*array_partition_fn)(const void* elem, void* ctx);
+
+typedef struct {
+    const unsigned char* src;
+    uint64_t es;
+    uint64_t n;
+    uint64_t parts;
+    uint64_t chunks;
+    uint64_t chunk;
+    array_partition_fn part;
+    void* ctx;
+    uint32_t* ids;
+    uint64_t* hist;
+    uint64_t* counts;
+    unsigned char** dsts;
+} array__partition_plan;
+
+static inline void array__partition_count_task(void* ctx, uint64_t begin, uint64_t end) {
+    array__partition_plan* plan = ctx;
+    for(uint64_t c = begin; c < end; ++c) {
+        /* Each chunk owns a row of parts + 1 counters, the last one counts invalid partition numbers */
+        uint64_t* row = plan->hist + c * (plan->parts + 1);
+        uint64_t hi = (c + 1) * plan->chunk < plan->n ? (c + 1) * plan->chunk : plan->n;
+        for(uint64_t i = c * plan->chunk; i < hi; ++i) {
+            uint64_t p = plan->part(plan->src + plan->es * i, plan->ctx);
+            p = p < plan->parts ? p : plan->parts;
+            plan->ids[i] = (uint32_t)p;
+            ++row[p];
+        }
+    }
+}
+
+/**
+*   Elements buffered per partition, so that all buffers of a thread fit in ARRAY_PARTITION_BUFFER_LIMIT
+*   @return Number of elements, below 2 when the elements should be scattered without buffers
+*/
+static inline uint64_t array__partition_slots(uint64_t es, uint64_t parts) {
+    uint64_t bytes = ARRAY_PARTITION_BUFFER_LIMIT / parts;
+    bytes = bytes < ARRAY_PARTITION_BUFFER ? bytes : ARRAY_PARTITION_BUFFER;
+    return bytes / es;
+}
+
+static inline void array__partition_scatter_task(void* ctx, uint64_t begin, uint64_t end) {
+    array__partition_plan* plan = ctx;
+    uint64_t es = plan->es;
+    uint64_t slots = array__partition_slots(es, plan->parts);
+    unsigned char* wc = NULL;
+    uint32_t* fill = NULL;
+    if(slots >= 2) {
+        wc = malloc(plan->parts * slots * es);
+        fill = calloc(plan->parts, sizeof(uint32_t));
+        if(!wc || !fill) {
+            free(wc);
+            free(fill);
+            wc = NULL;
+            fill = NULL;
+        }
+    }
+    for(uint64_t c = begin; c < end; ++c) {
+        uint64_t* cursor = plan->hist + c * (plan->parts + 1);
+        uint64_t hi = (c + 1) * plan->chunk < plan->n ? (c + 1) * plan->chunk : plan->n;
+        uint64_t i = c * plan->chunk;
+        if(!wc) {
+            for(; i < hi; ++i) {
+                uint64_t p = plan->ids[i];
+                memcpy(plan->dsts[p] + es * cursor[p]++, plan->src + es * i, es);
+            }
+            continue;
+        }
+        for(; i < hi; ++i) {
+            uint64_t p = plan->ids[i];
+            unsigned char* line = wc + p * slots * es;
+            memcpy(line + es * fill[p], plan->src + es * i, es);
+            if(++fill[p] == slots) {
+                memcpy(plan->dsts[p] + es * cursor[p], line, slots * es);
+                cursor[p] += slots;
+                fill[p] = 0;
+            }
+        }
+        for(uint64_t p = 0; p < plan->parts; ++p) {
+            memcpy(plan->dsts[p] + es * cursor[p], wc + p * slots * es, es * fill[p]);
+            cursor[p] += fill[p];
+            fill[p] = 0;
+        }
+    }
+    free(wc);
+    free(fill);
+}
+
+static inline void array__partition_free(array__partition_plan* plan) {
+    free(plan->ids);
+    free(plan->hist);
+    free(plan->counts);
+    free(plan->dsts);
+}
+
+/**
+*   Computes the partition of every element and how many elements each partition gets
+*   @return ARRAY_OK_ERROR, ARRAY_OUT_OF_MEM or ARRAY_OUT_OF_BOUNDS when part returned parts or more
+*/
+static inline array_error array__partition_count(array__partition_plan* plan, const void* src, uint64_t es, uint64_t n,
+        uint64_t parts, array_partition_fn part, void* ctx) {
+    if(parts == 0 || parts >= UINT32_MAX) {
+        return ARRAY_OUT_OF_BOUNDS;
+    }
+    uint64_t bytes = es * n;
+    plan->src = src;
+    plan->es = es;
+    plan->n = n;
+    plan->parts = parts;
+    plan->chunks = bytes < ARRAY_PARALLEL_THRESHOLD ? 1 : array__thread_count();
+    plan->chunk = (n + plan->chunks - 1) / plan->chunks;
+    plan->part = part;
+    plan->ctx = ctx;
+    plan->ids = malloc(sizeof(uint32_t) * (n > 0 ? n : 1));
+    plan->hist = calloc(plan->chunks * (parts + 1), sizeof(uint64_t));
+    plan->counts = calloc(parts + 1, sizeof(uint64_t));
+    plan->dsts = malloc(sizeof(unsigned char*) * (parts + 1));
+    if(!plan->ids || !plan->hist || !plan->counts || !plan->dsts) {
+        array__partition_free(plan);
+        return ARRAY_OUT_OF_MEM;
+    }
+    array__parallel_for(plan->chunks, 1, bytes, array__partition_count_task, plan);
+    /* Turn the per chunk counts into the position each chunk starts writing at in every output */
+    for(uint64_t p = 0; p <= parts; ++p) {
+        uint64_t offset = 0;
+        for(uint64_t c = 0; c < plan->chunks; ++c) {
+            uint64_t count = plan->hist[c * (parts + 1) + p];
+            plan->hist[c * (parts + 1) + p] = offset;
+            offset += count;
+        }
+        plan->counts[p] = offset;
+    }
+    if(plan->counts[parts] > 0) {
+        array__partition_free(plan);
+        return ARRAY_OUT_OF_BOUNDS;
+    }
+    return ARRAY_OK_ERROR;
+}
+
+static inline void array__partition_scatter(array__partition_plan* plan) {
+    array__parallel_for(plan->chunks, 1, plan->es * plan->n, array__partition_scatter_task, plan);
+}
+
+/**
+*   Replaces the contents of parts output arrays with the elements of the array, split by partition number
+*   @param T Type stored in array struct
+*   @param array_struct Array struct to partition
+*   @param outs C array of parts initialized array structs of the same type
+*   @param parts Number of partitions, below 2^32 - 1
+*   @param part_fn array_partition_fn returning the partition of an element, from 0 to parts - 1
+*   @param ctx Pointer passed to every call of part_fn
+*   @note Elements keep their relative order within each output, every output grows to exactly its size
+*   @note part_fn is called once per element, from several threads above ARRAY_PARALLEL_THRESHOLD bytes
+*   @note Will not execute if the error state of array_struct or any output is not ARRAY_OK_ERROR
+*   @note Can modify error state of every output to ARRAY_OUT_OF_MEM or to ARRAY_OUT_OF_BOUNDS when part_fn
+*   returns parts or more, and of one output to ARRAY_OUT_OF_MEM when it cannot grow, the outputs are then
+*   left unchanged and array_struct is never modified
+*   @example array_partition(event, events, parts, 16, by_user, NULL);
+*/
+#define array_partition(T, array_struct, outs, parts, part_fn, ctx) do { \
+        if(array_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        uint64_t array__parts = (parts); \
+        int array__ready = 1; \
+        for(uint64_t array__p = 0; array__p < array__parts; ++array__p) { \
+            array__ready &= (outs)[array__p].error == ARRAY_OK_ERROR; \
+        } \
+        if(!array__ready) { \
+            break; \
+        } \
+        array__partition_plan array__plan; \
+        array_error array__error = array__partition_count(&array__plan, array_struct.buf, sizeof(T), array_struct.size, \
+            array__parts, part_fn, ctx); \
+        if(array__error != ARRAY_OK_ERROR) { \
+            for(uint64_t array__p = 0; array__p < array__parts; ++array__p) { \
+                (outs)[array__p].error = array__error; \
+            } \
+            break; \
+        } \
+        for(uint64_t array__p = 0; array__p < array__parts && array__ready; ++array__p) { \
+            array_reserve(T, (outs)[array__p], array__plan.counts[array__p]); \
+            array__ready = (outs)[array__p].error == ARRAY_OK_ERROR; \
+            array__plan.dsts[array__p] = (unsigned char*)(outs)[array__p].buf; \
+        } \
+        if(array__ready) { \
+            for(uint64_t array__p = 0; array__p < array__parts; ++array__p) { \
+                array__before((outs)[array__p], 0, (outs)[array__p].size); \
+            } \
+            array__partition_scatter(&array__plan); \
+            for(uint64_t array__p = 0; array__p < array__parts; ++array__p) { \
+                (outs)[array__p].size = array__plan.counts[array__p]; \
+                array__after((outs)[array__p], 0, (outs)[array__p].size); \
+            } \
+        } \
+        array__partition_free(&array__plan); \
+    } while(0)
+
+#endif
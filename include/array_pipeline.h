@@ -0,0 +1,176 @@
+#ifndef ARRAY_PIPELINE_H
+#define ARRAY_PIPELINE_H
+
+#include "array.h"
+
+/*
+*   Fused pipelines run a chain of stages over every value in a single loop, without building an
+*   intermediate array per stage. Stages are written one after another without commas, filters skip
+*   the rest of the chain for the current value and sinks accumulate into variables declared by the
+*   caller. Every stage but array_pipe_let is a braced block, so a stage can be the body of an if or
+*   else, a let declares its name for the rest of the chain and has to stay at its top level.
+*
+*   double total = 0;
+*   array_pipe(event, e, events,
+*       array_pipe_filter(e.kind == 2)
+*       array_pipe_let(double, ms, e.duration * 1e-3)
+*       array_pipe_sum(total, ms));
+*/
+
+#define ARRAY__PRAGMA(x) _Pragma(#x)
+
+/**
+*   Runs a chain of stages over every value in the array in one loop
+*   @param T Type stored in array struct
+*   @param var Name of the variable holding a copy of the current value
+*   @param array_struct Array struct to read from
+*   @param stages Stage macros written one after another
+*   @warning The buf and size are read once, stages must not add or remove values of array_struct
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @example array_pipe(int, x, a, array_pipe_filter(x > 0) array_pipe_count(positive));
+*/
+#define array_pipe(T, var, array_struct, stages) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            T* array__pipe_buf = array_struct.buf; \
+            uint64_t array__pipe_size = array_struct.size; \
+            for(uint64_t array__pipe_i = 0; array__pipe_i < array__pipe_size; ++array__pipe_i) { \
+                T var = array__pipe_buf[array__pipe_i]; \
+                (void)var; \
+                stages \
+            } \
+        } \
+    } while(0)
+
+/**
+*   Runs a chain of reduction stages over the array with the loop split across OpenMP threads
+*   @param T Type stored in array struct
+*   @param var Name of the variable holding a copy of the current value
+*   @param array_struct Array struct to read from
+*   @param clause OpenMP reduction clause naming the accumulators, such as +:total or max:peak
+*   @param stages Stage macros written one after another
+*   @warning Only array_pipe_sum, array_pipe_count, array_pipe_min and array_pipe_max are safe sinks
+*   @note Runs serially like array_pipe when not compiled with OpenMP, the CMake target enables it with ARRAY_OPENMP=ON
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @example array_pipe_parallel(double, x, a, +:total, array_pipe_filter(x > 0) array_pipe_sum(total, x));
+*/
+#if defined(_OPENMP)
+#define array_pipe_parallel(T, var, array_struct, clause, stages) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            T* array__pipe_buf = array_struct.buf; \
+            int64_t array__pipe_size = (int64_t)array_struct.size; \
+            ARRAY__PRAGMA(omp parallel for schedule(static) reduction(clause)) \
+            for(int64_t array__pipe_i = 0; array__pipe_i < array__pipe_size; ++array__pipe_i) { \
+                T var = array__pipe_buf[array__pipe_i]; \
+                (void)var; \
+                stages \
+            } \
+        } \
+    } while(0)
+#else
+#define array_pipe_parallel(T, var, array_struct, clause, stages) array_pipe(T, var, array_struct, stages)
+#endif
+
+/**
+*   Runs a chain of stages over the array one chunk of values at a time, with a statement after every chunk
+*   @param T Type stored in array struct
+*   @param var Name of the variable holding a copy of the current value
+*   @param array_struct Array struct to read from
+*   @param chunk Number of values per chunk, the values collected from one chunk should fit in the L1 or L2 cache
+*   @param stages Stage macros written one after another
+*   @param after Statement run after every chunk, typically consuming and emptying what the stages collected
+*   @warning The buf and size are read once, stages must not add or remove values of array_struct
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @example array_pipe_chunked(int, x, a, 4096, array_pipe_filter(x > 0) array_pipe_collect(int, block, x),
+*       { consume(block.buf, block.size); block.size = 0; });
+*/
+#define array_pipe_chunked(T, var, array_struct, chunk, stages, after) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            T* array__pipe_buf = array_struct.buf; \
+            uint64_t array__pipe_size = array_struct.size; \
+            uint64_t array__pipe_chunk = (chunk) > 0 ? (uint64_t)(chunk) : 1; \
+            for(uint64_t array__pipe_begin = 0; array__pipe_begin < array__pipe_size; array__pipe_begin += array__pipe_chunk) { \
+                uint64_t array__pipe_end = array__pipe_size - array__pipe_begin < array__pipe_chunk ? \
+                    array__pipe_size : array__pipe_begin + array__pipe_chunk; \
+                for(uint64_t array__pipe_i = array__pipe_begin; array__pipe_i < array__pipe_end; ++array__pipe_i) { \
+                    T var = array__pipe_buf[array__pipe_i]; \
+                    (void)var; \
+                    stages \
+                } \
+                after \
+            } \
+        } \
+    } while(0)
+
+/**
+*   Stage that skips the rest of the chain for values where cond is false
+*   @param cond Condition on the current value or any earlier let
+*   @example array_pipe_filter(x % 2 == 0)
+*/
+#define array_pipe_filter(cond) { if(!(cond)) { continue; } }
+
+/**
+*   Stage that replaces the current value
+*   @param var Name of the current value or of an earlier let
+*   @param expr New value, of the same type as var
+*   @example array_pipe_map(x, x * x)
+*/
+#define array_pipe_map(var, expr) { var = (expr); }
+
+/**
+*   Stage that names a derived value, which may have a different type, for the rest of the chain
+*   @param U Type of the derived value
+*   @param name Name of the derived value
+*   @param expr Derived value
+*   @example array_pipe_let(double, price, r.cents / 100.0)
+*/
+#define array_pipe_let(U, name, expr) U name = (expr);
+
+/**
+*   Stage that runs a statement for every value reaching it
+*   @param stmt Statement to run
+*   @example array_pipe_do(printf("%d\n", x))
+*/
+#define array_pipe_do(stmt) { stmt; }
+
+/**
+*   Sink that adds every value reaching it to an accumulator
+*   @param acc Accumulator declared and initialized by the caller
+*   @param expr Value to add
+*   @example array_pipe_sum(total, x)
+*/
+#define array_pipe_sum(acc, expr) { acc += (expr); }
+
+/**
+*   Sink that counts the values reaching it
+*   @param acc Counter declared and initialized by the caller
+*   @example array_pipe_count(matches)
+*/
+#define array_pipe_count(acc) { ++acc; }
+
+/**
+*   Sink that keeps the smallest value reaching it
+*   @param acc Accumulator declared and initialized by the caller
+*   @param expr Value to compare, evaluated twice when it is smaller
+*   @example array_pipe_min(lowest, x)
+*/
+#define array_pipe_min(acc, expr) { if((expr) < acc) { acc = (expr); } }
+
+/**
+*   Sink that keeps the largest value reaching it
+*   @param acc Accumulator declared and initialized by the caller
+*   @param expr Value to compare, evaluated twice when it is larger
+*   @example array_pipe_max(highest, x)
+*/
+#define array_pipe_max(acc, expr) { if(acc < (expr)) { acc = (expr); } }
+
+/**
+*   Sink that adds every value reaching it to the tail of another array
+*   @param U Type stored in the output array struct
+*   @param out_struct Initialized array struct to add to
+*   @param expr Value to add
+*   @note Can modify error state of out_struct to ARRAY_OUT_OF_MEM
+*   @example array_pipe_collect(double, prices, price)
+*/
+#define array_pipe_collect(U, out_struct, expr) { array_add(U, out_struct, expr); }
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef ARRAY_PROFILE_H
+#define ARRAY_PROFILE_H
+
+#include <stdio.h>
+#include "array.h"
+
+/*
+*   Call site profiling picks the initial capacity of arrays from how big the arrays made at the same
+*   array_init_auto call used to get, instead of a guess written next to the call.
+*
+*   Built with ARRAY_PROFILE defined, every array_init_auto starts at its fallback capacity and records
+*   the peak capacity each of its arrays reached by the time it is freed, bucketed by powers of two.
+*   array_profile_dump then writes a header with the distribution of every call site and the capacity
+*   covering ARRAY_PROFILE_QUANTILE percent of its arrays. Built without ARRAY_PROFILE and with that header
+*   included before this one, array_init_auto starts each array at the learned capacity of its call site.
+*
+*   array_struct(edge) edges;
+*   array_init_auto(edge, edges, 16);
+*   ...
+*   array_profile_dump(out);  // profiling build, before exit, out opened on array_capacities.h
+*
+*   // production build
+*   #include "array_capacities.h"
+*   #include "array_profile.h"
+*/
+
+/**
+*   Percentage of the arrays of a call site whose peak fits in the learned initial capacity
+*   @note Define before including array_profile.h to override
+*/
+#ifndef ARRAY_PROFILE_QUANTILE
+#define ARRAY_PROFILE_QUANTILE 90
+#endif
+
+/**
+*   Bytes in front of every buffer of a profiled array, they hold its peak capacity and keep max alignment
+*/
+#define ARRAY_PROFILE_HEADER 16
+
+typedef struct array_site array_site;
+
+/* One per array_init_auto call site, also the allocator of the arrays it makes when profiling */
+struct array_site {
+    array_allocator alloc;
+    const char* file;
+    int line;
+    int prepared;
+    uint64_t elem_size;
+    uint64_t learned;
+    uint64_t hist[65];
+    array_site* next;
+};
+
+typedef struct {
+    const char* file;
+    int line;
+    uint64_t capacity;
+    uint64_t samples;
+} array__profile_entry;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ARRAY__PROFILE_SHARED __attribute__((weak))
+#define array__profile_ready(site) __atomic_load_n(&(site)->prepared, __ATOMIC_ACQUIRE)
+#define array__profile_mark(site) __atomic_store_n(&(site)->prepared, 1, __ATOMIC_RELEASE)
+#else
+#define ARRAY__PROFILE_SHARED static
+#define array__profile_ready(site) ((site)->prepared)
+#define array__profile_mark(site) ((site)->prepared = 1)
+#endif
+
+/* Weak so that every translation unit registers its call sites in the same list */
+ARRAY__PROFILE_SHARED array_site* array__profile_sites = NULL;
+#if defined(ARRAY_HAS_THREADS)
+ARRAY__PROFILE_SHARED pthread_mutex_t array__profile_lock = PTHREAD_MUTEX_INITIALIZER;
+#define array__profile_acquire() pthread_mutex_lock(&array__profile_lock)
+#define array__profile_release() pthread_mutex_unlock(&array__profile_lock)
+#else
+#define array__profile_acquire() ((void)0)
+#define array__profile_release() ((void)0)
+#endif
+
+#if defined(ARRAY_PROFILE_ENTRIES)
+static const array__profile_entry array__profile_table[] = { ARRAY_PROFILE_ENTRIES { NULL, 0, 0, 0 } };
+#else
+static const array__profile_entry array__profile_table[] = { { NULL, 0, 0, 0 } };
+#endif
+
+static inline void* array__site_resize(array_allocator* alloc, void* buf, uint64_t old_bytes, uint64_t new_bytes) {
+    (void)alloc;
+    (void)old_bytes;
+    unsigned char* base = buf ? (unsigned char*)buf - ARRAY_PROFILE_HEADER : NULL;
+    uint64_t peak = 0;
+    if(base) {
+        memcpy(&peak, base, sizeof(uint64_t));
+    }
+    base = realloc(base, ARRAY_PROFILE_HEADER + new_bytes);
+    if(!base) {
+        return NULL;
+    }
+    peak = new_bytes > peak ? new_bytes : peak;
+    memcpy(base, &peak, sizeof(uint64_t));
+    return base + ARRAY_PROFILE_HEADER;
+}
+
+static inline void array__site_release(array_allocator* alloc, void* buf, uint64_t bytes) {
+    array_site* site = (array_site*)alloc;
+    unsigned char* base = (unsigned char*)buf - ARRAY_PROFILE_HEADER;
+    uint64_t peak;
+    memcpy(&peak, base, sizeof(uint64_t));
+    peak = bytes > peak ? bytes : peak;
+    uint64_t elems = peak / site->elem_size;
+    unsigned bucket = 0;
+    while(bucket < 64 && (1ull << bucket) < elems) {
+        ++bucket;
+    }
+    array__profile_acquire();
+    ++site->hist[bucket];
+    array__profile_release();
+    free(base);
+}
+
+/**
+*   Registers a call site on its first use and looks up its learned capacity
+*/
+static inline void array__site_prepare(array_site* site, uint64_t elem_size) {
+    array__profile_acquire();
+    if(!site->prepared) {
+        site->elem_size = elem_size;
+        for(const array__profile_entry* e = array__profile_table; e->file; ++e) {
+            /* Capacities whose bytes would not fit are ignored, array_init_auto then starts at the fallback */
+            if(e->line == site->line && strcmp(e->file, site->file) == 0 && e->capacity <= UINT64_MAX / 2 / elem_size) {
+                site->learned = e->capacity;
+            }
+        }
+        site->next = array__profile_sites;
+        array__profile_sites = site;
+        array__profile_mark(site);
+    }
+    array__profile_release();
+}
+
+/**
+*   Gets the smallest power of two bucket holding at least percent of the samples of a site
+*/
+static inline uint64_t array__site_quantile(const array_site* site, uint64_t samples, unsigned percent) {
+    uint64_t seen = 0;
+    for(unsigned b = 0; b < 65; ++b) {
+        seen += site->hist[b];
+        if(seen * 100 >= samples * percent) {
+            return 1ull << (b < 63 ? b : 63);
+        }
+    }
+    return 1;
+}
+
+/**
+*   Initializes an array with the initial capacity learned for this call site
+*   @param T Type stored in array struct
+*   @param array_struct Array struct to initialize
+*   @param fallback_capacity Initial capacity while profiling and for call sites without a learned capacity
+*   @warning fallback_capacity must be >= 1
+*   @warning The buf needs to be released by array_free, peaks are only recorded for freed arrays
+*   @note The learned capacity is also the minimum capacity of the array, when it cannot be allocated the
+*   array starts at fallback_capacity instead
+*   @note Can modify error state to ARRAY_OUT_OF_MEM
+*   @example array_init_auto(edge, edges, 16);
+*/
+#if defined(ARRAY_PROFILE)
+#define array_init_auto(T, array_struct, fallback_capacity) do { \
+        static array_site array__site = { { array__site_resize, array__site_release }, __FILE__, __LINE__, 0, 0, 0, { 0 }, NULL }; \
+        array__site_prepare(&array__site, sizeof(T)); \
+        array_init(T, array_struct, (fallback_capacity)); \
+        array_set_allocator(array_struct, &array__site.alloc); \
+    } while(0)
+#else
+#define array_init_auto(T, array_struct, fallback_capacity) do { \
+        static array_site array__site = { { array__site_resize, array__site_release }, __FILE__, __LINE__, 0, 0, 0, { 0 }, NULL }; \
+        if(!array__profile_ready(&array__site)) { \
+            array__site_prepare(&array__site, sizeof(T)); \
+        } \
+        uint64_t array__capacity = array__site.learned ? array__site.learned : (fallback_capacity); \
+        array_init(T, array_struct, array__capacity); \
+        if(array_struct.error == ARRAY_OUT_OF_MEM && array__capacity != (fallback_capacity)) { \
+            array_init(T, array_struct, (fallback_capacity)); \
+        } \
+    } while(0)
+#endif
+
+/**
+*   Writes the learned initial capacities of every profiled call site as a header to include in later builds
+*   @param out Stream to write to
+*   @return Number of call sites written, -1 if out is NULL or writing failed
+*   @note Every entry is preceded by the peak capacity distribution of its call site as a comment
+*   @note Call sites are matched by __FILE__ and __LINE__, so the header only fits builds from the same paths
+*   @example array_profile_dump(out);
+*/
+static inline int array_profile_dump(FILE* out) {
+    if(!out) {
+        return -1;
+    }
+    int written = 0;
+    fprintf(out, "/* Initial capacities learned by array_profile_dump, include before array_profile.h */\n");
+    fprintf(out, "#define ARRAY_PROFILE_ENTRIES \\\n");
+    array__profile_acquire();
+    for(array_site* site = array__profile_sites; site; site = site->next) {
+        uint64_t samples = 0;
+        for(unsigned b = 0; b < 65; ++b) {
+            samples += site->hist[b];
+        }
+        if(samples == 0) {
+            continue;
+        }
+        fprintf(out, "    /* %llu arrays, peak p50 %llu p90 %llu max %llu */ \\\n", (unsigned long long)samples,
+            (unsigned long long)array__site_quantile(site, samples, 50),
+            (unsigned long long)array__site_quantile(site, samples, 90),
+            (unsigned long long)array__site_quantile(site, samples, 100));
+        fprintf(out, "    { \"");
+        for(const char* c = site->file; *c; ++c) {
+            fprintf(out, *c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+        }
+        fprintf(out, "\", %d, %llu, %llu }, \\\n", site->line,
+            (unsigned long long)array__site_quantile(site, samples, ARRAY_PROFILE_QUANTILE), (unsigned long long)samples);
+        ++written;
+    }
+    array__profile_release();
+    fprintf(out, "\n");
+    return fflush(out) == 0 && !ferror(out) ? written : -1;
+}
+
+#endif
@@ -0,0 +1,447 @@
+#ifndef ARRAY_QUERY_H
+#define ARRAY_QUERY_H
+
+#include "array_simd.h"
+#include "array_groupby.h"
+
+/*
+*   A query scans parallel numeric columns, keeps the rows matching a predicate and aggregates or
+*   returns them. Rows are processed in batches of ARRAY_QUERY_BATCH, so the columns a predicate reads
+*   stay in cache while it runs: each comparison fills a byte mask for the whole batch, AND, OR and NOT
+*   combine masks, and the final mask is turned into a selection vector of matching offsets that the
+*   aggregates read. Batches are split across threads above ARRAY_PARALLEL_THRESHOLD bytes.
+*
+*   Predicates are written in postfix order, price < 10 and (qty > 100 or vip == 1) is
+*
+*   array_column cols[] = { array_column_of(price), array_column_of(qty), array_column_of(vip) };
+*   array_query_pred where[] = {
+*       array_query_cmp(0, ARRAY_CMP_LT, 10), array_query_cmp(1, ARRAY_CMP_GT, 100),
+*       array_query_cmp(2, ARRAY_CMP_EQ, 1), array_query_or(), array_query_and()
+*   };
+*   array_query q = { cols, 3, where, 5 };
+*   array_query_agg aggs[] = { { ARRAY_AGG_COUNT, 0 }, { ARRAY_AGG_SUM, 1 } };
+*   double results[2];
+*   array_query_aggregate(&q, aggs, 2, results);
+*/
+
+/**
+*   Rows evaluated together, the masks and selection vector of a batch should stay in the L1 cache
+*   @note Define before including array_query.h to override, at most 65536
+*/
+#ifndef ARRAY_QUERY_BATCH
+#define ARRAY_QUERY_BATCH 1024
+#endif
+
+/**
+*   Deepest nesting of AND and OR a predicate may use
+*   @note Define before including array_query.h to override
+*/
+#ifndef ARRAY_QUERY_MAX_DEPTH
+#define ARRAY_QUERY_MAX_DEPTH 8
+#endif
+
+typedef enum {
+    ARRAY_COL_I32,
+    ARRAY_COL_I64,
+    ARRAY_COL_F32,
+    ARRAY_COL_F64
+} array_col_type;
+
+typedef struct {
+    const void* buf;
+    uint64_t size;
+    array_col_type type;
+} array_column;
+
+typedef enum {
+    ARRAY_QUERY_CMP,
+    ARRAY_QUERY_AND,
+    ARRAY_QUERY_OR,
+    ARRAY_QUERY_NOT
+} array_query_op;
+
+typedef struct {
+    array_query_op op;
+    unsigned col;
+    array_cmp cmp;
+    double value;
+} array_query_pred;
+
+typedef struct {
+    array_agg_op op;
+    unsigned col;
+} array_query_agg;
+
+typedef struct {
+    const array_column* cols;
+    unsigned ncols;
+    const array_query_pred* where;
+    unsigned nwhere;
+} array_query;
+
+/**
+*   Describes an array of int32_t, int64_t, float or double as a query column
+*   @param array_struct Array struct to read, must outlive the queries using the column
+*   @example array_column cols[] = { array_column_of(price), array_column_of(qty) };
+*/
+#define array_column_of(array_struct) ((array_column){ array_struct.buf, array_struct.size, _Generic(array_struct.buf, \
+        int32_t*: ARRAY_COL_I32, int64_t*: ARRAY_COL_I64, float*: ARRAY_COL_F32, double*: ARRAY_COL_F64) })
+
+/**
+*   Predicate comparing a column to a constant, float columns compare against the constant rounded to float
+*   @example array_query_cmp(0, ARRAY_CMP_GE, 18)
+*/
+#define array_query_cmp(col, pred, value) ((array_query_pred){ ARRAY_QUERY_CMP, col, pred, value })
+
+/**
+*   Predicate true when both of the two previous predicates are
+*/
+#define array_query_and() ((array_query_pred){ ARRAY_QUERY_AND, 0, ARRAY_CMP_EQ, 0 })
+
+/**
+*   Predicate true when either of the two previous predicates is
+*/
+#define array_query_or() ((array_query_pred){ ARRAY_QUERY_OR, 0, ARRAY_CMP_EQ, 0 })
+
+/**
+*   Predicate true when the previous predicate is false
+*/
+#define array_query_not() ((array_query_pred){ ARRAY_QUERY_NOT, 0, ARRAY_CMP_EQ, 0 })
+
+/* Integer columns are compared as doubles, exact for every int32_t and for int64_t up to 2^53 */
+#define ARRAY__QUERY_ICMP(T, sfx) \
+    static inline void array__query_cmp_##sfx(uint8_t* m, const T* a, uint64_t n, array_cmp pred, double v) { \
+        switch(pred) { \
+        case ARRAY_CMP_EQ: for(uint64_t i = 0; i < n; ++i) m[i] = (double)a[i] == v; break; \
+        case ARRAY_CMP_NE: for(uint64_t i = 0; i < n; ++i) m[i] = (double)a[i] != v; break; \
+        case ARRAY_CMP_LT: for(uint64_t i = 0; i < n; ++i) m[i] = (double)a[i] < v; break; \
+        case ARRAY_CMP_LE: for(uint64_t i = 0; i < n; ++i) m[i] = (double)a[i] <= v; break; \
+        case ARRAY_CMP_GT: for(uint64_t i = 0; i < n; ++i) m[i] = (double)a[i] > v; break; \
+        case ARRAY_CMP_GE: for(uint64_t i = 0; i < n; ++i) m[i] = (double)a[i] >= v; break; \
+        } \
+    }
+
+ARRAY__QUERY_ICMP(int32_t, i32)
+ARRAY__QUERY_ICMP(int64_t, i64)
+
+/* Folds the selected values of a batch, reading the column densely when every row was selected */
+#define ARRAY__QUERY_FOLD(T, sfx) \
+    static inline void array__query_fold_##sfx(const T* a, const uint16_t* sel, uint64_t nsel, uint64_t n, \
+            array_agg_op op, double* acc) { \
+        double r = *acc; \
+        switch(op) { \
+        case ARRAY_AGG_COUNT: \
+            r += (double)nsel; \
+            break; \
+        case ARRAY_AGG_SUM: \
+            if(nsel == n) { for(uint64_t i = 0; i < n; ++i) r += a[i]; } \
+            else { for(uint64_t i = 0; i < nsel; ++i) r += a[sel[i]]; } \
+            break; \
+        case ARRAY_AGG_MIN: \
+            for(uint64_t i = 0; i < nsel; ++i) { double x = a[sel[i]]; r = x < r ? x : r; } \
+            break; \
+        case ARRAY_AGG_MAX: \
+            for(uint64_t i = 0; i < nsel; ++i) { double x = a[sel[i]]; r = x > r ? x : r; } \
+            break; \
+        } \
+        *acc = r; \
+    }
+
+ARRAY__QUERY_FOLD(int32_t, i32)
+ARRAY__QUERY_FOLD(int64_t, i64)
+ARRAY__QUERY_FOLD(float, f32)
+ARRAY__QUERY_FOLD(double, f64)
+
+static inline void array__query_cmp(const array_column* col, uint64_t begin, uint64_t n, array_cmp pred, double v, uint8_t* m) {
+    switch(col->type) {
+    case ARRAY_COL_I32: array__query_cmp_i32(m, (const int32_t*)col->buf + begin, n, pred, v); break;
+    case ARRAY_COL_I64: array__query_cmp_i64(m, (const int64_t*)col->buf + begin, n, pred, v); break;
+    case ARRAY_COL_F32: array__vcmp_f32(pred, m, (const float*)col->buf + begin, NULL, (float)v, n); break;
+    case ARRAY_COL_F64: array__vcmp_f64(pred, m, (const double*)col->buf + begin, NULL, v, n); break;
+    }
+}
+
+static inline void array__query_fold(const array_column* col, uint64_t begin, const uint16_t* sel, uint64_t nsel, uint64_t n,
+        array_agg_op op, double* acc) {
+    switch(col->type) {
+    case ARRAY_COL_I32: array__query_fold_i32((const int32_t*)col->buf + begin, sel, nsel, n, op, acc); break;
+    case ARRAY_COL_I64: array__query_fold_i64((const int64_t*)col->buf + begin, sel, nsel, n, op, acc); break;
+    case ARRAY_COL_F32: array__query_fold_f32((const float*)col->buf + begin, sel, nsel, n, op, acc); break;
+    case ARRAY_COL_F64: array__query_fold_f64((const double*)col->buf + begin, sel, nsel, n, op, acc); break;
+    }
+}
+
+/**
+*   Checks that the columns have one size and the predicate is well formed
+*   @return ARRAY_OK_ERROR, ARRAY_SIZE_MISMATCH, ARRAY_OUT_OF_BOUNDS for a bad column number or ARRAY_INVALID_DATA
+*/
+static inline array_error array__query_check(const array_query* q, const array_query_agg* aggs, unsigned naggs) {
+    if(q->ncols == 0) {
+        return ARRAY_OUT_OF_BOUNDS;
+    }
+    for(unsigned c = 1; c < q->ncols; ++c) {
+        if(q->cols[c].size != q->cols[0].size) {
+            return ARRAY_SIZE_MISMATCH;
+        }
+    }
+    unsigned depth = 0;
+    for(unsigned i = 0; i < q->nwhere; ++i) {
+        const array_query_pred* p = q->where + i;
+        if(p->op == ARRAY_QUERY_CMP) {
+            if(p->col >= q->ncols) {
+                return ARRAY_OUT_OF_BOUNDS;
+            }
+            if(++depth > ARRAY_QUERY_MAX_DEPTH) {
+                return ARRAY_INVALID_DATA;
+            }
+        }
+        else if(p->op == ARRAY_QUERY_NOT ? depth < 1 : depth-- < 2) {
+            return ARRAY_INVALID_DATA;
+        }
+    }
+    if(q->nwhere > 0 && depth != 1) {
+        return ARRAY_INVALID_DATA;
+    }
+    for(unsigned a = 0; a < naggs; ++a) {
+        if(aggs[a].op != ARRAY_AGG_COUNT && aggs[a].col >= q->ncols) {
+            return ARRAY_OUT_OF_BOUNDS;
+        }
+    }
+    return ARRAY_OK_ERROR;
+}
+
+/**
+*   Evaluates the predicate over rows [begin, begin + n) of a batch
+*   @return Number of matching rows, whose offsets from begin are stored in ascending order in sel
+*/
+static inline uint64_t array__query_filter(const array_query* q, uint64_t begin, uint64_t n,
+        uint8_t (*masks)[ARRAY_QUERY_BATCH], uint16_t* sel) {
+    if(q->nwhere == 0) {
+        for(uint64_t i = 0; i < n; ++i) {
+            sel[i] = (uint16_t)i;
+        }
+        return n;
+    }
+    unsigned depth = 0;
+    for(unsigned w = 0; w < q->nwhere; ++w) {
+        const array_query_pred* p = q->where + w;
+        uint8_t* top = masks[depth - (depth > 0)];
+        switch(p->op) {
+        case ARRAY_QUERY_CMP:
+            array__query_cmp(q->cols + p->col, begin, n, p->cmp, p->value, masks[depth++]);
+            break;
+        case ARRAY_QUERY_AND:
+            --depth;
+            for(uint64_t i = 0; i < n; ++i) masks[depth - 1][i] &= top[i];
+            break;
+        case ARRAY_QUERY_OR:
+            --depth;
+            for(uint64_t i = 0; i < n; ++i) masks[depth - 1][i] |= top[i];
+            break;
+        case ARRAY_QUERY_NOT:
+            for(uint64_t i = 0; i < n; ++i) top[i] ^= 1;
+            break;
+        }
+    }
+    /* Branch free compaction, every row is written and the cursor only moves past matches */
+    uint64_t k = 0;
+    for(uint64_t i = 0; i < n; ++i) {
+        sel[k] = (uint16_t)i;
+        k += masks[0][i];
+    }
+    return k;
+}
+
+typedef array_struct(uint64_t) array__query_rows;
+
+typedef struct {
+    const array_query* q;
+    const array_query_agg* aggs;
+    unsigned naggs;
+    uint64_t rows;
+    uint64_t chunk;
+    double* accs;
+    array__query_rows* selected;
+} array__query_job;
+
+static inline void array__query_task(void* ctx, uint64_t begin, uint64_t end) {
+    array__query_job* job = ctx;
+    uint8_t masks[ARRAY_QUERY_MAX_DEPTH][ARRAY_QUERY_BATCH];
+    uint16_t sel[ARRAY_QUERY_BATCH];
+    for(uint64_t c = begin; c < end; ++c) {
+        uint64_t hi = (c + 1) * job->chunk < job->rows ? (c + 1) * job->chunk : job->rows;
+        for(uint64_t b = c * job->chunk; b < hi; b += ARRAY_QUERY_BATCH) {
+            uint64_t n = hi - b < ARRAY_QUERY_BATCH ? hi - b : ARRAY_QUERY_BATCH;
+            uint64_t nsel = array__query_filter(job->q, b, n, masks, sel);
+            for(unsigned a = 0; a < job->naggs; ++a) {
+                const array_query_agg* agg = job->aggs + a;
+                double* acc = job->accs + c * job->naggs + a;
+                if(agg->op == ARRAY_AGG_COUNT) {
+                    *acc += (double)nsel;
+                }
+                else {
+                    array__query_fold(job->q->cols + agg->col, b, sel, nsel, n, agg->op, acc);
+                }
+            }
+            if(job->selected) {
+                array__query_rows* rows = job->selected + c;
+                array_reserve(uint64_t, (*rows), rows->size + nsel);
+                if(rows->error == ARRAY_OK_ERROR) {
+                    for(uint64_t i = 0; i < nsel; ++i) {
+                        rows->buf[rows->size + i] = b + sel[i];
+                    }
+                    rows->size += nsel;
+                }
+            }
+        }
+    }
+}
+
+/**
+*   Runs a query, folding aggregates into accs and collecting matching rows into selected when not NULL
+*/
+static inline array_error array__query_run(const array_query* q, const array_query_agg* aggs, unsigned naggs, double* results,
+        array__query_rows* out) {
+    array_error error = array__query_check(q, aggs, naggs);
+    if(error != ARRAY_OK_ERROR) {
+        return error;
+    }
+    uint64_t rows = q->cols[0].size;
+    uint64_t bytes = rows * 8 * q->ncols;
+    uint64_t chunks = bytes < ARRAY_PARALLEL_THRESHOLD ? 1 : array__thread_count();
+    uint64_t chunk = (rows + chunks - 1) / chunks;
+    chunk = (chunk + ARRAY_QUERY_BATCH - 1) / ARRAY_QUERY_BATCH * ARRAY_QUERY_BATCH;
+    chunks = chunk > 0 ? (rows + chunk - 1) / chunk : 1;
+    double* accs = malloc(sizeof(double) * (chunks * naggs > 0 ? chunks * naggs : 1));
+    array__query_rows* selected = out ? malloc(sizeof(array__query_rows) * chunks) : NULL;
+    if(!accs || (out && !selected)) {
+        free(accs);
+        free(selected);
+        return ARRAY_OUT_OF_MEM;
+    }
+    for(uint64_t c = 0; c < chunks; ++c) {
+        for(unsigned a = 0; a < naggs; ++a) {
+            accs[c * naggs + a] = aggs[a].op == ARRAY_AGG_MIN ? INFINITY : aggs[a].op == ARRAY_AGG_MAX ? -INFINITY : 0;
+        }
+        if(selected) {
+            array_init(uint64_t, selected[c], 1);
+            error = selected[c].error != ARRAY_OK_ERROR ? selected[c].error : error;
+        }
+    }
+    if(error == ARRAY_OK_ERROR) {
+        array__query_job job = { q, aggs, naggs, rows, chunk, accs, selected };
+        array__parallel_for(chunks, 1, bytes, array__query_task, &job);
+    }
+    for(unsigned a = 0; a < naggs && results; ++a) {
+        double r = accs[a];
+        for(uint64_t c = 1; c < chunks; ++c) {
+            double x = accs[c * naggs + a];
+            r = aggs[a].op == ARRAY_AGG_MIN ? (x < r ? x : r) : aggs[a].op == ARRAY_AGG_MAX ? (x > r ? x : r) : r + x;
+        }
+        results[a] = r;
+    }
+    if(selected) {
+        uint64_t total = 0;
+        for(uint64_t c = 0; c < chunks; ++c) {
+            error = selected[c].error != ARRAY_OK_ERROR ? selected[c].error : error;
+            total += selected[c].size;
+        }
+        if(error == ARRAY_OK_ERROR) {
+            array_reserve(uint64_t, (*out), total);
+            error = out->error;
+        }
+        for(uint64_t c = 0; c < chunks; ++c) {
+            if(error == ARRAY_OK_ERROR) {
+                memcpy(out->buf + out->size, selected[c].buf, sizeof(uint64_t) * selected[c].size);
+                out->size += selected[c].size;
+            }
+            array_free(selected[c]);
+        }
+    }
+    free(accs);
+    free(selected);
+    return error;
+}
+
+/**
+*   Computes aggregates over the rows matching the predicate of a query
+*   @param q Pointer to the query, a query without predicates matches every row
+*   @param aggs C array of aggregates, each an array_agg_op and the column it reads, COUNT ignores the column
+*   @param naggs Number of aggregates
+*   @param results C array of naggs doubles receiving the aggregates
+*   @return ARRAY_OK_ERROR, ARRAY_OUT_OF_MEM, ARRAY_SIZE_MISMATCH when the columns differ in size,
+*   ARRAY_OUT_OF_BOUNDS for a bad column number or ARRAY_INVALID_DATA for a malformed predicate
+*   @note Min and max of no rows are INFINITY and -INFINITY, sums of integer columns are exact up to 2^53
+*   @example array_error e = array_query_aggregate(&q, aggs, 2, results);
+*/
+static inline array_error array_query_aggregate(const array_query* q, const array_query_agg* aggs, unsigned naggs, double* results) {
+    return array__query_run(q, aggs, naggs, results, NULL);
+}
+
+/**
+*   Replaces the contents of an array with the numbers of the rows matching the predicate of a query
+*   @param q Pointer to the query
+*   @param rows_struct array_struct(uint64_t) receiving the row numbers in ascending order
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of rows_struct to any error of array_query_aggregate
+*   @example array_query_select(&q, rows);
+*/
+#define array_query_select(q, rows_struct) do { \
+        if(rows_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        array__query_rows array__rows; \
+        array_init(uint64_t, array__rows, 16); \
+        rows_struct.error = array__rows.error; \
+        if(rows_struct.error == ARRAY_OK_ERROR) { \
+            rows_struct.error = array__query_run(q, NULL, 0, NULL, &array__rows); \
+        } \
+        if(rows_struct.error == ARRAY_OK_ERROR) { \
+            array_reserve(uint64_t, rows_struct, array__rows.size); \
+        } \
+        if(rows_struct.error == ARRAY_OK_ERROR) { \
+            array__before(rows_struct, 0, rows_struct.size); \
+            memcpy(rows_struct.buf, array__rows.buf, sizeof(uint64_t) * array__rows.size); \
+            rows_struct.size = array__rows.size; \
+            array__after(rows_struct, 0, rows_struct.size); \
+        } \
+        array_free(array__rows); \
+    } while(0)
+
+/**
+*   Replaces the contents of a double array with the values of a column at the given rows
+*   @param column array_column to read
+*   @param rows_struct array_struct(uint64_t) of row numbers, such as from array_query_select
+*   @param out_struct array_struct(double) receiving one value per row
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of out_struct to ARRAY_OUT_OF_MEM or ARRAY_OUT_OF_BOUNDS when a row is past the column
+*   @example array_query_project(cols[1], rows, qty_out);
+*/
+#define array_query_project(column, rows_struct, out_struct) do { \
+        if(rows_struct.error != ARRAY_OK_ERROR || out_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        array_column array__col = (column); \
+        if(array__first_invalid(rows_struct.buf, rows_struct.size, array__col.size) != rows_struct.size) { \
+            out_struct.error = ARRAY_OUT_OF_BOUNDS; \
+            break; \
+        } \
+        array_reserve(double, out_struct, rows_struct.size); \
+        if(out_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        array__before(out_struct, 0, out_struct.size); \
+        for(uint64_t array__i = 0; array__i < rows_struct.size; ++array__i) { \
+            uint64_t array__r = rows_struct.buf[array__i]; \
+            switch(array__col.type) { \
+            case ARRAY_COL_I32: out_struct.buf[array__i] = ((const int32_t*)array__col.buf)[array__r]; break; \
+            case ARRAY_COL_I64: out_struct.buf[array__i] = (double)((const int64_t*)array__col.buf)[array__r]; break; \
+            case ARRAY_COL_F32: out_struct.buf[array__i] = ((const float*)array__col.buf)[array__r]; break; \
+            case ARRAY_COL_F64: out_struct.buf[array__i] = ((const double*)array__col.buf)[array__r]; break; \
+            } \
+        } \
+        out_struct.size = rows_struct.size; \
+        array__after(out_struct, 0, out_struct.size); \
+    } while(0)
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef ARRAY_RANGE_H
+#define ARRAY_RANGE_H
+
+#include "array_aggregate.h"
+
+/*
+*   A range index answers sum, min and max queries over any [l, r) of an array_struct(int64_t) in
+*   O(log n). Sums come from a Fenwick tree, min and max from the segment tree of array_aggregate.h
+*   ordering its words as int64_t, so a query touches two short runs of parents. Both are built in
+*   O(n) and follow the array through array_hook, a changed element costs O(log n) and bulk changes
+*   rebuild in O(n).
+*
+*   array_range_index idx;
+*   array_range_build(a, &idx);
+*   int64_t total = array_range_sum(&idx, 10, 20);
+*/
+
+typedef struct {
+    array_hook hook;
+    int64_t* fenwick;
+    uint64_t fenwick_capacity;
+    uint64_t n;
+    array__tree tree;
+    int stale;
+    array_error error;
+} array_range_index;
+
+/* Changes this large relative to the array are cheaper to rebuild than to apply one by one */
+static inline int array__range_bulk(uint64_t n, uint64_t count) {
+    return count > 64 && count >= n / 16;
+}
+
+static inline void array__range_fenwick_add(array_range_index* idx, uint64_t i, int64_t delta) {
+    for(++i; i <= idx->n; i += i & (0 - i)) {
+        idx->fenwick[i] += delta;
+    }
+}
+
+static inline int64_t array__range_prefix(const array_range_index* idx, uint64_t i) {
+    int64_t s = 0;
+    for(; i > 0; i -= i & (0 - i)) {
+        s += idx->fenwick[i];
+    }
+    return s;
+}
+
+static inline int array__range_fenwick_reserve(array_range_index* idx, uint64_t n) {
+    if(n + 1 > idx->fenwick_capacity) {
+        uint64_t capacity = idx->fenwick_capacity * 2 > n + 1 ? idx->fenwick_capacity * 2 : n + 1;
+        int64_t* fenwick = realloc(idx->fenwick, sizeof(int64_t) * capacity);
+        if(!fenwick) {
+            idx->error = ARRAY_OUT_OF_MEM;
+            return 0;
+        }
+        idx->fenwick = fenwick;
+        idx->fenwick_capacity = capacity;
+    }
+    return 1;
+}
+
+static inline uint64_t array__range_min_i64(uint64_t a, uint64_t b) {
+    return (int64_t)a < (int64_t)b ? a : b;
+}
+
+static inline uint64_t array__range_max_i64(uint64_t a, uint64_t b) {
+    return (int64_t)a > (int64_t)b ? a : b;
+}
+
+static inline void array__range_set_leaf(array_range_index* idx, uint64_t i, const int64_t* buf, uint64_t size) {
+    if(i < size) {
+        array__tree_set(&idx->tree, i, (uint64_t)buf[i]);
+    }
+    else {
+        array__tree_clear(&idx->tree, i);
+    }
+}
+
+static inline void array__range_rebuild(array_range_index* idx, const int64_t* buf, uint64_t size) {
+    if(!array__range_fenwick_reserve(idx, size)) {
+        return;
+    }
+    idx->n = size;
+    idx->fenwick[0] = 0;
+    memcpy(idx->fenwick + 1, buf, sizeof(int64_t) * size);
+    for(uint64_t i = 1; i <= size; ++i) {
+        uint64_t parent = i + (i & (0 - i));
+        if(parent <= size) {
+            idx->fenwick[parent] += idx->fenwick[i];
+        }
+    }
+    if(!array__tree_reserve(&idx->tree, size)) {
+        idx->error = ARRAY_OUT_OF_MEM;
+        return;
+    }
+    for(uint64_t i = 0; i < idx->tree.leaves; ++i) {
+        array__range_set_leaf(idx, i, buf, size);
+    }
+    array__tree_build(&idx->tree);
+}
+
+static inline void array__range_before(array_hook* hook, const void* buf, uint64_t begin, uint64_t end) {
+    array_range_index* idx = (array_range_index*)hook;
+    const int64_t* values = buf;
+    if(idx->error != ARRAY_OK_ERROR || idx->stale) {
+        return;
+    }
+    if(array__range_bulk(idx->n, end - begin)) {
+        idx->stale = 1;
+        return;
+    }
+    for(uint64_t i = begin; i < end && i < idx->n; ++i) {
+        array__range_fenwick_add(idx, i, -values[i]);
+    }
+}
+
+static inline void array__range_after(array_hook* hook, const void* buf, uint64_t begin, uint64_t end, uint64_t size) {
+    array_range_index* idx = (array_range_index*)hook;
+    const int64_t* values = buf;
+    if(idx->error != ARRAY_OK_ERROR) {
+        return;
+    }
+    if(idx->stale || array__range_bulk(idx->n, end - begin) || size > idx->tree.leaves) {
+        idx->stale = 0;
+        array__range_rebuild(idx, values, size);
+        return;
+    }
+    uint64_t old_size = idx->n;
+    if(size < idx->n) {
+        idx->n = size;
+    }
+    for(uint64_t i = begin; i < end; ++i) {
+        if(i < idx->n) {
+            array__range_fenwick_add(idx, i, values[i]);
+        }
+        else {
+            /* An appended node covers the values after the prefix its lowest bit skips */
+            if(!array__range_fenwick_reserve(idx, i + 1)) {
+                return;
+            }
+            uint64_t node = i + 1;
+            idx->fenwick[node] = values[i] + array__range_prefix(idx, i) - array__range_prefix(idx, node - (node & (0 - node)));
+            idx->n = node;
+        }
+    }
+    uint64_t hi = old_size > size && old_size > end ? old_size : end;
+    for(uint64_t i = begin; i < hi; ++i) {
+        array__range_set_leaf(idx, i, values, size);
+    }
+    array__tree_repair(&idx->tree, begin, hi);
+}
+
+/**
+*   Builds a range index over an array in O(n) and keeps it in sync with later changes
+*   @param array_struct array_struct(int64_t) to index
+*   @param idx Pointer to an array_range_index that stays valid until array_range_free
+*   @note Changes through buf or array_foreach_ptr are not seen, call array_range_rebuild after them
+*   @note Can modify error state of idx to ARRAY_OUT_OF_MEM, queries are then meaningless
+*   @example array_range_build(prices, &idx);
+*/
+#define array_range_build(array_struct, idx) do { \
+        array_range_index* array__idx = (idx); \
+        const int64_t* array__values = array_struct.buf; \
+        array__idx->hook.before = array__range_before; \
+        array__idx->hook.after = array__range_after; \
+        array__idx->fenwick = NULL; \
+        array__idx->fenwick_capacity = 0; \
+        array__idx->n = 0; \
+        array__tree_init(&array__idx->tree, array__range_min_i64, array__range_max_i64, \
+            (uint64_t)INT64_MAX, (uint64_t)INT64_MIN); \
+        array__idx->stale = 0; \
+        array__idx->error = ARRAY_OK_ERROR; \
+        array__range_rebuild(array__idx, array__values, array_struct.size); \
+        array_attach_hook(array_struct, &array__idx->hook); \
+    } while(0)
+
+/**
+*   Rebuilds a range index in O(n) after changes the hooks did not see
+*   @param array_struct array_struct(int64_t) that is indexed
+*   @param idx Pointer to the index
+*   @example array_range_rebuild(prices, &idx);
+*/
+#define array_range_rebuild(array_struct, idx) do { \
+        const int64_t* array__values = array_struct.buf; \
+        (idx)->stale = 0; \
+        array__range_rebuild(idx, array__values, array_struct.size); \
+    } while(0)
+
+/**
+*   Detaches a range index from its array and frees it
+*   @param array_struct array_struct(int64_t) that is indexed
+*   @param idx Pointer to the index
+*   @example array_range_free(prices, &idx);
+*/
+#define array_range_free(array_struct, idx) do { \
+        array_range_index* array__idx = (idx); \
+        array_detach_hook(array_struct, &array__idx->hook); \
+        free(array__idx->fenwick); \
+        array__tree_free(&array__idx->tree); \
+        array__idx->fenwick = NULL; \
+        array__idx->fenwick_capacity = 0; \
+        array__idx->n = 0; \
+    } while(0)
+
+/**
+*   Sums elements [l, r) of the indexed array in O(log n)
+*   @param idx Pointer to the index
+*   @param l First element of the range
+*   @param r One past the last element of the range, clipped to the size
+*   @return Sum of the range, 0 when it is empty
+*   @example int64_t s = array_range_sum(&idx, 10, 20);
+*/
+static inline int64_t array_range_sum(const array_range_index* idx, uint64_t l, uint64_t r) {
+    r = r < idx->n ? r : idx->n;
+    return l < r ? array__range_prefix(idx, r) - array__range_prefix(idx, l) : 0;
+}
+
+static inline void array__range_minmax(const array_range_index* idx, uint64_t l, uint64_t r, int64_t* lo, int64_t* hi) {
+    uint64_t min;
+    uint64_t max;
+    r = r < idx->n ? r : idx->n;
+    array__tree_query(&idx->tree, l, l < r ? r : l, &min, &max);
+    *lo = (int64_t)min;
+    *hi = (int64_t)max;
+}
+
+/**
+*   Finds the smallest of elements [l, r) of the indexed array in O(log n)
+*   @param idx Pointer to the index
+*   @param l First element of the range
+*   @param r One past the last element of the range, clipped to the size
+*   @return Smallest value of the range, INT64_MAX when it is empty
+*   @example int64_t low = array_range_min(&idx, 0, 100);
+*/
+static inline int64_t array_range_min(const array_range_index* idx, uint64_t l, uint64_t r) {
+    int64_t lo, hi;
+    array__range_minmax(idx, l, r, &lo, &hi);
+    return lo;
+}
+
+/**
+*   Finds the largest of elements [l, r) of the indexed array in O(log n)
+*   @param idx Pointer to the index
+*   @param l First element of the range
+*   @param r One past the last element of the range, clipped to the size
+*   @return Largest value of the range, INT64_MIN when it is empty
+*   @example int64_t high = array_range_max(&idx, 0, 100);
+*/
+static inline int64_t array_range_max(const array_range_index* idx, uint64_t l, uint64_t r) {
+    int64_t lo, hi;
+    array__range_minmax(idx, l, r, &lo, &hi);
+    return hi;
+}
+
+#endif
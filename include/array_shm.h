@@ -0,0 +1,591 @@
+#ifndef ARRAY_SHM_H
+#define ARRAY_SHM_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "array.h"
+
+/*
+*   A shared array keeps its buffer in a POSIX shared memory object or an anonymous memfd instead of the
+*   heap, so several processes map the same pages. The segment starts with ARRAY_SHM_HEADER bytes holding
+*   the element size, size and capacity of the array, followed by the elements. Growing the array grows
+*   the file and maps it again, the file is never shrunk since other processes may still map its tail.
+*
+*   Every process sees appends up to the size published in the header once it calls array_shm_refresh,
+*   one writer with any number of readers needs nothing else. Several writers must hold a lock of their
+*   own around array_shm_refresh and every change that follows it.
+*
+*   // producer
+*   array_struct(int) table;
+*   array_shm_create(int, table, "/lookup", 1 << 20);
+*   // workers
+*   array_struct(int) view;
+*   array_shm_attach(int, view, "/lookup", 0);
+*
+*   A finished array can also be handed to another process without copying: the builder seals an anonymous
+*   segment so nobody can change it anymore and sends its descriptor over a Unix socket, the receiver maps
+*   it as an immutable array.
+*
+*   array_shm_seal(built);
+*   array_shm_send(built, sock);
+*   // receiver
+*   array_shm_recv(int, view, sock);
+*
+*   Needs the POSIX declarations of <unistd.h>, define _POSIX_C_SOURCE 200809L when building with -std=c11.
+*/
+
+/**
+*   Bytes before the first element of a shared segment, keeps the elements cache line aligned
+*/
+#define ARRAY_SHM_HEADER 64
+
+typedef struct {
+    char magic[8];
+    uint64_t elem_size;
+    uint64_t size;
+    uint64_t capacity;
+} array__shm_header;
+
+typedef struct {
+    array_allocator alloc;
+    array_hook hook;
+    int fd;
+    int writable;
+    unsigned char* map;
+    uint64_t map_bytes;
+} array_shm;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define array__shm_store(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELEASE)
+#define array__shm_load(field) __atomic_load_n(&(field), __ATOMIC_ACQUIRE)
+#else
+#define array__shm_store(field, value) ((field) = (value))
+#define array__shm_load(field) (field)
+#endif
+
+static inline array__shm_header* array__shm_head(array_shm* shm) {
+    return (array__shm_header*)shm->map;
+}
+
+static inline int array__shm_remap(array_shm* shm, uint64_t bytes) {
+    int prot = shm->writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* map = mmap(NULL, bytes, prot, MAP_SHARED, shm->fd, 0);
+    if(map == MAP_FAILED) {
+        return 0;
+    }
+    if(shm->map) {
+        munmap(shm->map, shm->map_bytes);
+    }
+    shm->map = map;
+    shm->map_bytes = bytes;
+    return 1;
+}
+
+/**
+*   Bytes of a segment holding capacity elements of es bytes after its header
+*   @return 0 when the segment would not fit in a file offset
+*/
+static inline uint64_t array__shm_bytes(uint64_t es, uint64_t capacity) {
+    return es == 0 || capacity > ((uint64_t)INT64_MAX - ARRAY_SHM_HEADER) / es ? 0 : ARRAY_SHM_HEADER + es * capacity;
+}
+
+static inline void* array__shm_resize(array_allocator* alloc, void* buf, uint64_t old_bytes, uint64_t new_bytes) {
+    (void)buf;
+    (void)old_bytes;
+    array_shm* shm = (array_shm*)alloc;
+    if(!shm->writable) {
+        return NULL;
+    }
+    uint64_t need = ARRAY_SHM_HEADER + new_bytes;
+    if(need > shm->map_bytes) {
+        /* Another writer may already have grown the file further, never truncate below its size */
+        struct stat st;
+        if(fstat(shm->fd, &st) != 0) {
+            return NULL;
+        }
+        if((uint64_t)st.st_size < need && ftruncate(shm->fd, (off_t)need) != 0) {
+            return NULL;
+        }
+        if(!array__shm_remap(shm, need)) {
+            return NULL;
+        }
+    }
+    array__shm_header* head = array__shm_head(shm);
+    array__shm_store(head->capacity, new_bytes / head->elem_size);
+    return shm->map + ARRAY_SHM_HEADER;
+}
+
+static inline void array__shm_release(array_allocator* alloc, void* buf, uint64_t bytes) {
+    (void)buf;
+    (void)bytes;
+    array_shm* shm = (array_shm*)alloc;
+    munmap(shm->map, shm->map_bytes);
+    close(shm->fd);
+    free(shm);
+}
+
+static inline void array__shm_after(array_hook* hook, const void* buf, uint64_t begin, uint64_t end, uint64_t size) {
+    (void)buf;
+    (void)begin;
+    (void)end;
+    array_shm* shm = (array_shm*)((unsigned char*)hook - offsetof(array_shm, hook));
+    array__shm_store(array__shm_head(shm)->size, size);
+}
+
+static inline array_error array__shm_format(array_shm* shm, uint64_t es, uint64_t capacity) {
+    uint64_t bytes = array__shm_bytes(es, capacity);
+    if(bytes == 0) {
+        return ARRAY_OUT_OF_MEM;
+    }
+    if(ftruncate(shm->fd, (off_t)bytes) != 0 || !array__shm_remap(shm, bytes)) {
+        return ARRAY_IO_ERROR;
+    }
+    array__shm_header* head = array__shm_head(shm);
+    memcpy(head->magic, "ARRSHM01", 8);
+    head->elem_size = es;
+    head->size = 0;
+    array__shm_store(head->capacity, capacity);
+    return ARRAY_OK_ERROR;
+}
+
+static inline array_error array__shm_check(array_shm* shm, uint64_t es) {
+    struct stat st;
+    if(fstat(shm->fd, &st) != 0) {
+        return ARRAY_IO_ERROR;
+    }
+    if((uint64_t)st.st_size < ARRAY_SHM_HEADER) {
+        return ARRAY_INVALID_DATA;
+    }
+    if(!array__shm_remap(shm, ARRAY_SHM_HEADER)) {
+        return ARRAY_IO_ERROR;
+    }
+    array__shm_header* head = array__shm_head(shm);
+    if(memcmp(head->magic, "ARRSHM01", 8) != 0) {
+        return ARRAY_INVALID_DATA;
+    }
+    if(head->elem_size != es) {
+        return ARRAY_SIZE_MISMATCH;
+    }
+    uint64_t bytes = array__shm_bytes(es, array__shm_load(head->capacity));
+    if(bytes == 0 || (uint64_t)st.st_size < bytes) {
+        return ARRAY_INVALID_DATA;
+    }
+    return array__shm_remap(shm, bytes) ? ARRAY_OK_ERROR : ARRAY_IO_ERROR;
+}
+
+/**
+*   Maps a shared segment, writing a fresh header when capacity is not 0 and checking the one found otherwise
+*   @return The segment, NULL with err set and fd closed on failure
+*/
+static inline array_shm* array__shm_open(int fd, uint64_t es, uint64_t capacity, int writable, array_error* err) {
+    array_shm* shm = malloc(sizeof(array_shm));
+    if(!shm) {
+        close(fd);
+        *err = ARRAY_OUT_OF_MEM;
+        return NULL;
+    }
+    shm->alloc.resize = array__shm_resize;
+    shm->alloc.release = array__shm_release;
+    shm->hook.before = NULL;
+    shm->hook.after = array__shm_after;
+    shm->hook.next = NULL;
+    shm->fd = fd;
+    shm->writable = writable;
+    shm->map = NULL;
+    shm->map_bytes = 0;
+    *err = capacity > 0 ? array__shm_format(shm, es, capacity) : array__shm_check(shm, es);
+    if(*err != ARRAY_OK_ERROR) {
+        if(shm->map) {
+            munmap(shm->map, shm->map_bytes);
+        }
+        close(fd);
+        free(shm);
+        return NULL;
+    }
+    return shm;
+}
+
+/**
+*   Opens the file behind a new segment, an anonymous one when name is NULL
+*   @return File descriptor, -1 on failure
+*/
+static inline int array__shm_create_fd(const char* name) {
+    if(name) {
+        return shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+#if defined(__linux__) && defined(MFD_ALLOW_SEALING)
+    return memfd_create("array", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    /* Without memfd an anonymous segment is a named one that is unlinked as soon as it exists */
+    static unsigned counter;
+    char temp[64];
+    for(int attempt = 0; attempt < 16; ++attempt) {
+        snprintf(temp, sizeof(temp), "/array-%ld-%u", (long)getpid(), counter++);
+        int fd = shm_open(temp, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if(fd >= 0) {
+            shm_unlink(temp);
+            return fd;
+        }
+    }
+    return -1;
+#endif
+}
+
+/**
+*   Reads the size and capacity published by other processes, mapping the segment again if it grew
+*   @return ARRAY_INVALID_DATA, leaving size and capacity alone, when the header does not describe the file
+*/
+static inline array_error array__shm_refresh(array_shm* shm, uint64_t* size, uint64_t* capacity) {
+    array__shm_header* head = array__shm_head(shm);
+    uint64_t cap = array__shm_load(head->capacity);
+    uint64_t count = array__shm_load(head->size);
+    uint64_t bytes = array__shm_bytes(head->elem_size, cap);
+    if(bytes == 0 || count > cap) {
+        return ARRAY_INVALID_DATA;
+    }
+    if(bytes > shm->map_bytes) {
+        /* Pages past the end of the file fault when touched, so a capacity the file cannot hold is refused */
+        struct stat st;
+        if(fstat(shm->fd, &st) != 0) {
+            return ARRAY_IO_ERROR;
+        }
+        if((uint64_t)st.st_size < bytes) {
+            return ARRAY_INVALID_DATA;
+        }
+        if(!array__shm_remap(shm, bytes)) {
+            return ARRAY_IO_ERROR;
+        }
+    }
+    *size = count;
+    /* A read only array has no room to grow into, so adding fails instead of faulting on the mapping */
+    *capacity = shm->writable ? cap : count;
+    return ARRAY_OK_ERROR;
+}
+
+static inline array_shm* array__shm_of(array_allocator* alloc) {
+    return alloc && alloc->resize == array__shm_resize ? (array_shm*)alloc : NULL;
+}
+
+/* Points the array at a mapped segment, readers do not publish their size back */
+#define array__shm_bind(array_struct, shm) do { \
+        array_struct.buf = (void*)((shm)->map + ARRAY_SHM_HEADER); \
+        array_struct.alloc = &(shm)->alloc; \
+        if((shm)->writable) { \
+            array_attach_hook(array_struct, &(shm)->hook); \
+        } \
+    } while(0)
+
+/**
+*   Initializes an array whose buffer lives in a new shared memory segment
+*   @param T Type stored in array struct
+*   @param array_struct Array struct to initialize
+*   @param name Name of the POSIX shared memory object, starting with '/', or NULL for an anonymous segment
+*   only reachable through array_shm_fd
+*   @param init_capacity Initial and minimum capacity of the array
+*   @warning init_capacity must be >= 1
+*   @warning The segment is unmapped by array_free, a named object stays until array_shm_unlink
+*   @note T must not hold pointers, other processes map the buffer at other addresses
+*   @note Can modify error state to ARRAY_OUT_OF_MEM or to ARRAY_IO_ERROR when the segment cannot be created,
+*   including when name already exists
+*   @example array_shm_create(int, a, "/lookup", 1024);
+*/
+#define array_shm_create(T, array_struct, name, init_capacity) do { \
+        array_struct.hooks = NULL; \
+        array_struct.alloc = NULL; \
+        array_struct.buf = NULL; \
+        array_struct.size = 0; \
+        array_struct.min_capacity = init_capacity; \
+        array_struct.capacity = init_capacity; \
+        int array__fd = array__shm_create_fd(name); \
+        if(array__fd < 0) { \
+            array_struct.error = ARRAY_IO_ERROR; \
+            break; \
+        } \
+        array_shm* array__shm = array__shm_open(array__fd, sizeof(T), array_struct.capacity, 1, &array_struct.error); \
+        if(array__shm) { \
+            array__shm_bind(array_struct, array__shm); \
+        } \
+    } while(0)
+
+/**
+*   Initializes an array over a shared segment already open as a file descriptor
+*   @param T Type stored in array struct, must have the size used by the creator
+*   @param array_struct Array struct to initialize
+*   @param fd File descriptor of the segment, owned by the array afterwards even on failure
+*   @param shared_write 0 to map read only, otherwise changes are shared with every other process
+*   @warning Writing through buf or array_set into a read only array faults, adding fails with ARRAY_OUT_OF_MEM
+*   @note Can modify error state to ARRAY_OUT_OF_MEM, ARRAY_IO_ERROR, ARRAY_INVALID_DATA if fd is not a shared
+*   array or ARRAY_SIZE_MISMATCH if it holds elements of another size
+*   @example array_shm_attach_fd(int, a, received_fd, 0);
+*/
+#define array_shm_attach_fd(T, array_struct, fd, shared_write) do { \
+        array_struct.hooks = NULL; \
+        array_struct.alloc = NULL; \
+        array_struct.buf = NULL; \
+        array_struct.size = 0; \
+        array_struct.capacity = 0; \
+        array_shm* array__shm = array__shm_open((fd), sizeof(T), 0, (shared_write) != 0, &array_struct.error); \
+        if(!array__shm) { \
+            break; \
+        } \
+        array_struct.error = array__shm_refresh(array__shm, &array_struct.size, &array_struct.capacity); \
+        array_struct.min_capacity = array__shm->writable ? 1 : array_struct.size; \
+        array__shm_bind(array_struct, array__shm); \
+    } while(0)
+
+/**
+*   Initializes an array over a named shared segment made by array_shm_create in any process
+*   @param T Type stored in array struct, must have the size used by the creator
+*   @param array_struct Array struct to initialize
+*   @param name Name passed to array_shm_create
+*   @param shared_write 0 to map read only, otherwise changes are shared with every other process
+*   @warning Writing through buf or array_set into a read only array faults, adding fails with ARRAY_OUT_OF_MEM
+*   @note Can modify error state to ARRAY_OUT_OF_MEM, ARRAY_IO_ERROR, ARRAY_INVALID_DATA if name is not a shared
+*   array or ARRAY_SIZE_MISMATCH if it holds elements of another size
+*   @example array_shm_attach(int, a, "/lookup", 0);
+*/
+#define array_shm_attach(T, array_struct, name, shared_write) do { \
+        int array__fd = shm_open(name, (shared_write) ? O_RDWR : O_RDONLY, 0); \
+        if(array__fd < 0) { \
+            array_struct.hooks = NULL; \
+            array_struct.alloc = NULL; \
+            array_struct.buf = NULL; \
+            array_struct.size = 0; \
+            array_struct.capacity = 0; \
+            array_struct.error = ARRAY_IO_ERROR; \
+            break; \
+        } \
+        array_shm_attach_fd(T, array_struct, array__fd, shared_write); \
+    } while(0)
+
+/**
+*   Picks up the size and capacity other processes published, mapping the segment again if it grew
+*   @param array_struct Array struct made by array_shm_create or array_shm_attach
+*   @note buf can move, pointers into the array are not valid afterwards
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_IO_ERROR, or ARRAY_INVALID_DATA if the array is not shared or another
+*   process published a size above the capacity or a capacity the segment cannot hold
+*   @example array_shm_refresh(view);
+*/
+#define array_shm_refresh(array_struct) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            array_shm* array__shm = array__shm_of(array_struct.alloc); \
+            if(!array__shm) { \
+                array_struct.error = ARRAY_INVALID_DATA; \
+                break; \
+            } \
+            array_struct.error = array__shm_refresh(array__shm, &array_struct.size, &array_struct.capacity); \
+            array_struct.buf = (void*)(array__shm->map + ARRAY_SHM_HEADER); \
+            if(!array__shm->writable) { \
+                array_struct.min_capacity = array_struct.size; \
+            } \
+        } \
+    } while(0)
+
+/**
+*   Gets the file descriptor of a shared array, to pass it to another process
+*   @param array_struct Array struct made by array_shm_create or array_shm_attach
+*   @return File descriptor owned by the array, -1 if the array is not shared
+*   @example int fd = array_shm_fd(a);
+*/
+#define array_shm_fd(array_struct) (array__shm_of(array_struct.alloc) ? array__shm_of(array_struct.alloc)->fd : -1)
+
+/**
+*   Removes the name of a shared segment, processes that have it mapped keep using it
+*   @param name Name passed to array_shm_create
+*   @return 0 on success, -1 otherwise
+*   @example array_shm_unlink("/lookup");
+*/
+static inline int array_shm_unlink(const char* name) {
+    return shm_unlink(name);
+}
+
+#define ARRAY__SHM_SEALS (F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
+
+/**
+*   Trims the segment to size elements, seals it and maps it again read only
+*   @note F_SEAL_WRITE is refused while a writable mapping exists, so the old one is dropped first
+*/
+static inline array_error array__shm_seal(array_shm* shm, uint64_t size) {
+#if defined(F_ADD_SEALS)
+    if(!shm->writable) {
+        return ARRAY_INVALID_DATA;
+    }
+    array__shm_header* head = array__shm_head(shm);
+    uint64_t bytes = ARRAY_SHM_HEADER + head->elem_size * size;
+    array__shm_store(head->size, size);
+    array__shm_store(head->capacity, size);
+    munmap(shm->map, shm->map_bytes);
+    shm->map = NULL;
+    shm->writable = 0;
+    if(ftruncate(shm->fd, (off_t)bytes) != 0 || fcntl(shm->fd, F_ADD_SEALS, ARRAY__SHM_SEALS) != 0) {
+        /* Keep a mapping so the array can still be read and freed */
+        array__shm_remap(shm, bytes);
+        return ARRAY_IO_ERROR;
+    }
+    return array__shm_remap(shm, bytes) ? ARRAY_OK_ERROR : ARRAY_IO_ERROR;
+#else
+    (void)shm;
+    (void)size;
+    return ARRAY_IO_ERROR;
+#endif
+}
+
+static inline array_error array__shm_send(int sock, int fd) {
+    char byte = 0;
+    struct iovec io = { &byte, 1 };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    msg.msg_iov = &io;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    return sendmsg(sock, &msg, 0) == 1 ? ARRAY_OK_ERROR : ARRAY_IO_ERROR;
+}
+
+/**
+*   Receives a descriptor sent by array__shm_send and checks that it is a sealed segment
+*   @return File descriptor, -1 with err set on failure
+*/
+static inline int array__shm_recv(int sock, array_error* err) {
+    char byte;
+    struct iovec io = { &byte, 1 };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &io;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    *err = ARRAY_IO_ERROR;
+#if defined(MSG_CMSG_CLOEXEC)
+    ssize_t got = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+#else
+    ssize_t got = recvmsg(sock, &msg, 0);
+#endif
+    if(got < 0) {
+        return -1;
+    }
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if(got != 1 || !cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+            cmsg->cmsg_len != CMSG_LEN(sizeof(int)) || (msg.msg_flags & MSG_CTRUNC)) {
+        /* Close whatever descriptors did arrive so that a malformed message does not leak them */
+        for(; cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len >= CMSG_LEN(0)) {
+                uint64_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for(uint64_t i = 0; i < count; ++i) {
+                    int extra;
+                    memcpy(&extra, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                    close(extra);
+                }
+            }
+        }
+        *err = got == 1 ? ARRAY_INVALID_DATA : ARRAY_IO_ERROR;
+        return -1;
+    }
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+#if defined(F_GET_SEALS)
+    /* Without every seal the sender could still change the pages under the receiver, descriptors that
+       cannot be sealed at all make F_GET_SEALS fail */
+    int seals = fcntl(fd, F_GET_SEALS);
+    if(seals < 0 || (seals & ARRAY__SHM_SEALS) != ARRAY__SHM_SEALS) {
+        close(fd);
+        *err = ARRAY_INVALID_DATA;
+        return -1;
+    }
+#else
+    close(fd);
+    return -1;
+#endif
+    *err = ARRAY_OK_ERROR;
+    return fd;
+}
+
+/**
+*   Freezes an anonymous shared array, after which no process can change, grow or shrink it
+*   @param array_struct Array struct made by array_shm_create with a NULL name
+*   @warning The array becomes read only, writing through buf faults and adding fails with ARRAY_OUT_OF_MEM
+*   @note The segment is trimmed to the size of the array before it is sealed
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_INVALID_DATA if the array is not shared or already read only, or
+*   to ARRAY_IO_ERROR if the segment cannot be sealed, which needs Linux memfd
+*   @example array_shm_seal(a);
+*/
+#define array_shm_seal(array_struct) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            array_shm* array__shm = array__shm_of(array_struct.alloc); \
+            if(!array__shm) { \
+                array_struct.error = ARRAY_INVALID_DATA; \
+                break; \
+            } \
+            int array__was_writable = array__shm->writable; \
+            array_struct.error = array__shm_seal(array__shm, array_struct.size); \
+            if(array__was_writable) { \
+                array_detach_hook(array_struct, &array__shm->hook); \
+                array_struct.buf = (void*)(array__shm->map + ARRAY_SHM_HEADER); \
+                array_struct.capacity = array_struct.size; \
+                array_struct.min_capacity = array_struct.size; \
+            } \
+        } \
+    } while(0)
+
+/**
+*   Sends the segment of a shared array over a Unix domain socket, the array stays usable by the sender
+*   @param array_struct Array struct made by array_shm_create or array_shm_attach, sealed for array_shm_recv
+*   @param sock Connected Unix domain socket
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_INVALID_DATA if the array is not shared or ARRAY_IO_ERROR if sending fails
+*   @example array_shm_send(a, fds[0]);
+*/
+#define array_shm_send(array_struct, sock) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            array_shm* array__shm = array__shm_of(array_struct.alloc); \
+            array_struct.error = array__shm ? array__shm_send((sock), array__shm->fd) : ARRAY_INVALID_DATA; \
+        } \
+    } while(0)
+
+/**
+*   Initializes an immutable array from a sealed segment sent with array_shm_send, without copying it
+*   @param T Type stored in array struct, must have the size used by the sender
+*   @param array_struct Array struct to initialize
+*   @param sock Connected Unix domain socket
+*   @warning Writing through buf or array_set faults, adding fails with ARRAY_OUT_OF_MEM
+*   @note Can modify error state to ARRAY_OUT_OF_MEM, ARRAY_IO_ERROR if receiving fails, ARRAY_INVALID_DATA if no
+*   sealed shared array arrived or ARRAY_SIZE_MISMATCH if it holds elements of another size
+*   @example array_shm_recv(int, a, fds[1]);
+*/
+#define array_shm_recv(T, array_struct, sock) do { \
+        array_error array__error; \
+        int array__fd = array__shm_recv((sock), &array__error); \
+        if(array__fd < 0) { \
+            array_struct.hooks = NULL; \
+            array_struct.alloc = NULL; \
+            array_struct.buf = NULL; \
+            array_struct.size = 0; \
+            array_struct.capacity = 0; \
+            array_struct.error = array__error; \
+            break; \
+        } \
+        array_shm_attach_fd(T, array_struct, array__fd, 0); \
+    } while(0)
+
+#endif
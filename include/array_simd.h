@@ -0,0 +1,821 @@
+#ifndef ARRAY_SIMD_H
+#define ARRAY_SIMD_H
+
+#include "array.h"
+#include <math.h>
+
+#if !defined(ARRAY_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ARRAY_HAS_X86_SIMD 1
+#define ARRAY_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+typedef enum {
+    ARRAY_ISA_SCALAR,
+    ARRAY_ISA_AVX2,
+    ARRAY_ISA_AVX512
+} array_isa;
+
+typedef enum {
+    ARRAY_CMP_EQ,
+    ARRAY_CMP_NE,
+    ARRAY_CMP_LT,
+    ARRAY_CMP_LE,
+    ARRAY_CMP_GT,
+    ARRAY_CMP_GE
+} array_cmp;
+
+/**
+*   Gets the widest instruction set the kernels can use on this cpu, detected once
+*   @return An enum with a value found in array_isa
+*   @note Define ARRAY_NO_SIMD before including array_simd.h to always use the scalar kernels
+*   @example if(array_cpu_isa() == ARRAY_ISA_AVX512) { ... }
+*/
+static inline array_isa array_cpu_isa(void) {
+#if defined(ARRAY_HAS_X86_SIMD)
+    /* Worker threads may ask at the same time, they all store the same answer */
+    static int isa = -1;
+    int cached = __atomic_load_n(&isa, __ATOMIC_RELAXED);
+    if(cached < 0) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("avx512f") ? ARRAY_ISA_AVX512
+            : __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? ARRAY_ISA_AVX2
+            : ARRAY_ISA_SCALAR;
+        __atomic_store_n(&isa, cached, __ATOMIC_RELAXED);
+    }
+    return (array_isa)cached;
+#else
+    return ARRAY_ISA_SCALAR;
+#endif
+}
+
+/*
+*   Grows the capacity of an array to exactly n elements if it is smaller, the type comes from buf
+*/
+#define array__reserve_exact(array_struct, n) do { \
+        if(array_struct.capacity < (n)) { \
+            void* temp = array__realloc(array_struct.alloc, array_struct.buf, \
+                sizeof(*array_struct.buf) * array_struct.capacity, sizeof(*array_struct.buf) * (n)); \
+            if(!temp) { \
+                array_struct.error = ARRAY_OUT_OF_MEM; \
+                break; \
+            } \
+            array_struct.buf = temp; \
+            array_struct.capacity = (n); \
+        } \
+    } while(0)
+
+enum {
+    ARRAY__VOP_ADD,
+    ARRAY__VOP_SUB,
+    ARRAY__VOP_MUL,
+    ARRAY__VOP_FMA,
+    ARRAY__VOP_SCALE,
+    ARRAY__VOP_ADD_SCALAR,
+    ARRAY__VOP_CLAMP,
+    ARRAY__VOP_ABS,
+    ARRAY__VOP_COUNT
+};
+
+typedef void (*array__vop_f32_fn)(float* d, const float* a, const float* b, const float* c, float s, float t, uint64_t n);
+typedef void (*array__vop_f64_fn)(double* d, const double* a, const double* b, const double* c, double s, double t, uint64_t n);
+typedef void (*array__vcmp_f32_fn)(uint8_t* d, const float* a, const float* b, float s, uint64_t n);
+typedef void (*array__vcmp_f64_fn)(uint8_t* d, const double* a, const double* b, double s, uint64_t n);
+
+#define ARRAY__SCALAR_KERNELS(T, sfx) \
+    static inline void array__vop_##sfx##_scalar(int op, T* d, const T* a, const T* b, const T* c, T s, T t, uint64_t n) { \
+        switch(op) { \
+        case ARRAY__VOP_ADD: for(uint64_t i = 0; i < n; ++i) d[i] = a[i] + b[i]; break; \
+        case ARRAY__VOP_SUB: for(uint64_t i = 0; i < n; ++i) d[i] = a[i] - b[i]; break; \
+        case ARRAY__VOP_MUL: for(uint64_t i = 0; i < n; ++i) d[i] = a[i] * b[i]; break; \
+        case ARRAY__VOP_FMA: for(uint64_t i = 0; i < n; ++i) d[i] = a[i] * b[i] + c[i]; break; \
+        case ARRAY__VOP_SCALE: for(uint64_t i = 0; i < n; ++i) d[i] = a[i] * s; break; \
+        case ARRAY__VOP_ADD_SCALAR: for(uint64_t i = 0; i < n; ++i) d[i] = a[i] + s; break; \
+        case ARRAY__VOP_CLAMP: for(uint64_t i = 0; i < n; ++i) d[i] = a[i] < s ? s : a[i] > t ? t : a[i]; break; \
+        case ARRAY__VOP_ABS: for(uint64_t i = 0; i < n; ++i) d[i] = (T)fabs(a[i]); break; \
+        } \
+    } \
+    static inline void array__vcmp_##sfx##_scalar(int pred, uint8_t* d, const T* a, const T* b, T s, uint64_t n) { \
+        for(uint64_t i = 0; i < n; ++i) { \
+            T x = a[i]; \
+            T y = b ? b[i] : s; \
+            switch(pred) { \
+            case ARRAY_CMP_EQ: d[i] = x == y; break; \
+            case ARRAY_CMP_NE: d[i] = x != y; break; \
+            case ARRAY_CMP_LT: d[i] = x < y; break; \
+            case ARRAY_CMP_LE: d[i] = x <= y; break; \
+            case ARRAY_CMP_GT: d[i] = x > y; break; \
+            case ARRAY_CMP_GE: d[i] = x >= y; break; \
+            } \
+        } \
+    }
+
+ARRAY__SCALAR_KERNELS(float, f32)
+ARRAY__SCALAR_KERNELS(double, f64)
+
+#if defined(ARRAY_HAS_X86_SIMD)
+
+/*
+*   Kernels are generated per instruction set from the intrinsic names below. Full vectors are processed in the main
+*   loop and the remaining elements with one masked load and store, so no element is handled by scalar code.
+*/
+
+#define ARRAY__MASK_PS256(r) _mm256_cmpgt_epi32(_mm256_set1_epi32((int)(r)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))
+#define ARRAY__MASK_PD256(r) _mm256_cmpgt_epi64(_mm256_set1_epi64x((long long)(r)), _mm256_setr_epi64x(0, 1, 2, 3))
+#define ARRAY__LDM_PS256(p, m) _mm256_maskload_ps(p, m)
+#define ARRAY__LDM_PD256(p, m) _mm256_maskload_pd(p, m)
+#define ARRAY__STM_PS256(p, m, v) _mm256_maskstore_ps(p, m, v)
+#define ARRAY__STM_PD256(p, m, v) _mm256_maskstore_pd(p, m, v)
+#define ARRAY__ABS_PS256(x) _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x)
+#define ARRAY__ABS_PD256(x) _mm256_andnot_pd(_mm256_set1_pd(-0.0), x)
+#define ARRAY__BITS_PS256(x, y, imm) (uint64_t)_mm256_movemask_ps(_mm256_cmp_ps(x, y, imm))
+#define ARRAY__BITS_PD256(x, y, imm) (uint64_t)_mm256_movemask_pd(_mm256_cmp_pd(x, y, imm))
+
+#define ARRAY__MASK_PS512(r) (__mmask16)((1u << (r)) - 1)
+#define ARRAY__MASK_PD512(r) (__mmask8)((1u << (r)) - 1)
+#define ARRAY__LDM_PS512(p, m) _mm512_maskz_loadu_ps(m, p)
+#define ARRAY__LDM_PD512(p, m) _mm512_maskz_loadu_pd(m, p)
+#define ARRAY__STM_PS512(p, m, v) _mm512_mask_storeu_ps(p, m, v)
+#define ARRAY__STM_PD512(p, m, v) _mm512_mask_storeu_pd(p, m, v)
+#define ARRAY__BITS_PS512(x, y, imm) (uint64_t)_mm512_cmp_ps_mask(x, y, imm)
+#define ARRAY__BITS_PD512(x, y, imm) (uint64_t)_mm512_cmp_pd_mask(x, y, imm)
+
+#define ARRAY__VKERNEL(name, attr, T, V, M, W, MASKN, LD, ST, LDM, STM, SET1, EXPR) \
+    static inline attr void name(T* d, const T* a, const T* b, const T* c, T s, T t, uint64_t n) { \
+        const V vs = SET1(s); \
+        const V vt = SET1(t); \
+        V x, y, z; \
+        uint64_t i = 0; \
+        (void)vs; (void)vt; (void)y; (void)z; \
+        for(; i + W <= n; i += W) { \
+            x = LD(a + i); \
+            y = LD(b + i); \
+            z = LD(c + i); \
+            ST(d + i, EXPR); \
+        } \
+        if(i < n) { \
+            M m = MASKN(n - i); \
+            x = LDM(a + i, m); \
+            y = LDM(b + i, m); \
+            z = LDM(c + i, m); \
+            STM(d + i, m, EXPR); \
+        } \
+    }
+
+#define ARRAY__VCMP_KERNEL(name, attr, T, V, M, W, MASKN, LD, LDM, SET1, BITS, IMM) \
+    static inline attr void name(uint8_t* d, const T* a, const T* b, T s, uint64_t n) { \
+        const V vs = SET1(s); \
+        uint64_t i = 0; \
+        for(; i + W <= n; i += W) { \
+            uint64_t bits = BITS(LD(a + i), b ? LD(b + i) : vs, IMM); \
+            for(unsigned k = 0; k < W; ++k) { \
+                d[i + k] = (bits >> k) & 1; \
+            } \
+        } \
+        if(i < n) { \
+            M m = MASKN(n - i); \
+            uint64_t bits = BITS(LDM(a + i, m), b ? LDM(b + i, m) : vs, IMM); \
+            for(unsigned k = 0; i + k < n; ++k) { \
+                d[i + k] = (bits >> k) & 1; \
+            } \
+        } \
+    }
+
+#define ARRAY__VKERNELS(isa, attr, T, sfx, V, M, W, MASKN, LD, ST, LDM, STM, SET1, ADD, SUB, MUL, FMADD, MIN, MAX, ABS, BITS) \
+    ARRAY__VKERNEL(array__vadd_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, ST, LDM, STM, SET1, ADD(x, y)) \
+    ARRAY__VKERNEL(array__vsub_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, ST, LDM, STM, SET1, SUB(x, y)) \
+    ARRAY__VKERNEL(array__vmul_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, ST, LDM, STM, SET1, MUL(x, y)) \
+    ARRAY__VKERNEL(array__vfma_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, ST, LDM, STM, SET1, FMADD(x, y, z)) \
+    ARRAY__VKERNEL(array__vscale_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, ST, LDM, STM, SET1, MUL(x, vs)) \
+    ARRAY__VKERNEL(array__vadds_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, ST, LDM, STM, SET1, ADD(x, vs)) \
+    ARRAY__VKERNEL(array__vclamp_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, ST, LDM, STM, SET1, MAX(vs, MIN(vt, x))) \
+    ARRAY__VKERNEL(array__vabs_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, ST, LDM, STM, SET1, ABS(x)) \
+    ARRAY__VCMP_KERNEL(array__vcmpeq_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, LDM, SET1, BITS, _CMP_EQ_OQ) \
+    ARRAY__VCMP_KERNEL(array__vcmpne_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, LDM, SET1, BITS, _CMP_NEQ_UQ) \
+    ARRAY__VCMP_KERNEL(array__vcmplt_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, LDM, SET1, BITS, _CMP_LT_OQ) \
+    ARRAY__VCMP_KERNEL(array__vcmple_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, LDM, SET1, BITS, _CMP_LE_OQ) \
+    ARRAY__VCMP_KERNEL(array__vcmpgt_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, LDM, SET1, BITS, _CMP_GT_OQ) \
+    ARRAY__VCMP_KERNEL(array__vcmpge_##sfx##_##isa, attr, T, V, M, W, MASKN, LD, LDM, SET1, BITS, _CMP_GE_OQ) \
+    static const array__vop_##sfx##_fn array__vops_##sfx##_##isa[ARRAY__VOP_COUNT] = { \
+        array__vadd_##sfx##_##isa, array__vsub_##sfx##_##isa, array__vmul_##sfx##_##isa, array__vfma_##sfx##_##isa, \
+        array__vscale_##sfx##_##isa, array__vadds_##sfx##_##isa, array__vclamp_##sfx##_##isa, array__vabs_##sfx##_##isa \
+    }; \
+    static const array__vcmp_##sfx##_fn array__vcmps_##sfx##_##isa[6] = { \
+        array__vcmpeq_##sfx##_##isa, array__vcmpne_##sfx##_##isa, array__vcmplt_##sfx##_##isa, \
+        array__vcmple_##sfx##_##isa, array__vcmpgt_##sfx##_##isa, array__vcmpge_##sfx##_##isa \
+    };
+
+ARRAY__VKERNELS(avx2, ARRAY_TARGET("avx2,fma"), float, f32, __m256, __m256i, 8, ARRAY__MASK_PS256,
+    _mm256_loadu_ps, _mm256_storeu_ps, ARRAY__LDM_PS256, ARRAY__STM_PS256, _mm256_set1_ps,
+    _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_fmadd_ps, _mm256_min_ps, _mm256_max_ps,
+    ARRAY__ABS_PS256, ARRAY__BITS_PS256)
+ARRAY__VKERNELS(avx2, ARRAY_TARGET("avx2,fma"), double, f64, __m256d, __m256i, 4, ARRAY__MASK_PD256,
+    _mm256_loadu_pd, _mm256_storeu_pd, ARRAY__LDM_PD256, ARRAY__STM_PD256, _mm256_set1_pd,
+    _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd, _mm256_fmadd_pd, _mm256_min_pd, _mm256_max_pd,
+    ARRAY__ABS_PD256, ARRAY__BITS_PD256)
+ARRAY__VKERNELS(avx512, ARRAY_TARGET("avx512f"), float, f32, __m512, __mmask16, 16, ARRAY__MASK_PS512,
+    _mm512_loadu_ps, _mm512_storeu_ps, ARRAY__LDM_PS512, ARRAY__STM_PS512, _mm512_set1_ps,
+    _mm512_add_ps, _mm512_sub_ps, _mm512_mul_ps, _mm512_fmadd_ps, _mm512_min_ps, _mm512_max_ps,
+    _mm512_abs_ps, ARRAY__BITS_PS512)
+ARRAY__VKERNELS(avx512, ARRAY_TARGET("avx512f"), double, f64, __m512d, __mmask8, 8, ARRAY__MASK_PD512,
+    _mm512_loadu_pd, _mm512_storeu_pd, ARRAY__LDM_PD512, ARRAY__STM_PD512, _mm512_set1_pd,
+    _mm512_add_pd, _mm512_sub_pd, _mm512_mul_pd, _mm512_fmadd_pd, _mm512_min_pd, _mm512_max_pd,
+    _mm512_abs_pd, ARRAY__BITS_PD512)
+
+#endif
+
+#if defined(ARRAY_HAS_X86_SIMD)
+#define ARRAY__VDISPATCH(sfx, table, call, scalar_call) do { \
+        switch(array_cpu_isa()) { \
+        case ARRAY_ISA_AVX512: table##_##sfx##_avx512 call; return; \
+        case ARRAY_ISA_AVX2: table##_##sfx##_avx2 call; return; \
+        default: scalar_call; return; \
+        } \
+    } while(0)
+#else
+#define ARRAY__VDISPATCH(sfx, table, call, scalar_call) do { \
+        scalar_call; \
+    } while(0)
+#endif
+
+#define ARRAY__DISPATCHERS(T, sfx) \
+    static inline void array__vop_##sfx(int op, T* d, const T* a, const T* b, const T* c, T s, T t, uint64_t n) { \
+        ARRAY__VDISPATCH(sfx, array__vops, [op](d, a, b, c, s, t, n), array__vop_##sfx##_scalar(op, d, a, b, c, s, t, n)); \
+    } \
+    static inline void array__vcmp_##sfx(int pred, uint8_t* d, const T* a, const T* b, T s, uint64_t n) { \
+        ARRAY__VDISPATCH(sfx, array__vcmps, [pred](d, a, b, s, n), array__vcmp_##sfx##_scalar(pred, d, a, b, s, n)); \
+    }
+
+ARRAY__DISPATCHERS(float, f32)
+ARRAY__DISPATCHERS(double, f64)
+
+/*
+*   Checks the operands, sizes the destination once and runs the kernel matching the element type
+*/
+#define array__vapply(op, dst_struct, a_struct, b_struct, c_struct, s, t) do { \
+        if(dst_struct.error == ARRAY_OK_ERROR && a_struct.error == ARRAY_OK_ERROR && \
+                b_struct.error == ARRAY_OK_ERROR && c_struct.error == ARRAY_OK_ERROR) { \
+            if(a_struct.size != b_struct.size || a_struct.size != c_struct.size) { \
+                dst_struct.error = ARRAY_SIZE_MISMATCH; \
+                break; \
+            } \
+            array__reserve_exact(dst_struct, a_struct.size); \
+            if(dst_struct.error == ARRAY_OK_ERROR) { \
+                array__before(dst_struct, 0, dst_struct.size); \
+                _Generic(dst_struct.buf, float*: array__vop_f32, double*: array__vop_f64)( \
+                    op, dst_struct.buf, a_struct.buf, b_struct.buf, c_struct.buf, s, t, a_struct.size); \
+                dst_struct.size = a_struct.size; \
+                array__after(dst_struct, 0, dst_struct.size); \
+            } \
+        } \
+    } while(0)
+
+#define array__vcompare(mask_struct, a_struct, pred, b_buf, s) do { \
+        if(mask_struct.error == ARRAY_OK_ERROR && a_struct.error == ARRAY_OK_ERROR) { \
+            array__reserve_exact(mask_struct, a_struct.size); \
+            if(mask_struct.error == ARRAY_OK_ERROR) { \
+                array__before(mask_struct, 0, mask_struct.size); \
+                _Generic(a_struct.buf, float*: array__vcmp_f32, double*: array__vcmp_f64)( \
+                    pred, mask_struct.buf, a_struct.buf, b_buf, s, a_struct.size); \
+                mask_struct.size = a_struct.size; \
+                array__after(mask_struct, 0, mask_struct.size); \
+            } \
+        } \
+    } while(0)
+
+/**
+*   Stores the elementwise sum of two float or double arrays
+*   @param dst_struct Array struct to store the result in, may be a_struct or b_struct to work in place
+*   @param a_struct First operand
+*   @param b_struct Second operand
+*   @note Grows the capacity of dst_struct to exactly the operand size when it is too small
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM or ARRAY_SIZE_MISMATCH
+*   @example array_vadd(c, a, b);
+*/
+#define array_vadd(dst_struct, a_struct, b_struct) \
+    array__vapply(ARRAY__VOP_ADD, dst_struct, a_struct, b_struct, a_struct, 0, 0)
+
+/**
+*   Stores the elementwise difference a - b of two float or double arrays
+*   @param dst_struct Array struct to store the result in, may be a_struct or b_struct to work in place
+*   @param a_struct First operand
+*   @param b_struct Second operand
+*   @note Grows the capacity of dst_struct to exactly the operand size when it is too small
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM or ARRAY_SIZE_MISMATCH
+*   @example array_vsub(c, a, b);
+*/
+#define array_vsub(dst_struct, a_struct, b_struct) \
+    array__vapply(ARRAY__VOP_SUB, dst_struct, a_struct, b_struct, a_struct, 0, 0)
+
+/**
+*   Stores the elementwise product of two float or double arrays
+*   @param dst_struct Array struct to store the result in, may be a_struct or b_struct to work in place
+*   @param a_struct First operand
+*   @param b_struct Second operand
+*   @note Grows the capacity of dst_struct to exactly the operand size when it is too small
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM or ARRAY_SIZE_MISMATCH
+*   @example array_vmul(c, a, b);
+*/
+#define array_vmul(dst_struct, a_struct, b_struct) \
+    array__vapply(ARRAY__VOP_MUL, dst_struct, a_struct, b_struct, a_struct, 0, 0)
+
+/**
+*   Stores the elementwise fused multiply add a * b + c of three float or double arrays
+*   @param dst_struct Array struct to store the result in, may be any operand to work in place
+*   @param a_struct First factor
+*   @param b_struct Second factor
+*   @param c_struct Addend
+*   @note Only rounded once when the cpu has fma instructions
+*   @note Grows the capacity of dst_struct to exactly the operand size when it is too small
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM or ARRAY_SIZE_MISMATCH
+*   @example array_vfma(d, a, b, c);
+*/
+#define array_vfma(dst_struct, a_struct, b_struct, c_struct) \
+    array__vapply(ARRAY__VOP_FMA, dst_struct, a_struct, b_struct, c_struct, 0, 0)
+
+/**
+*   Stores every element of a float or double array multiplied by a scalar
+*   @param dst_struct Array struct to store the result in, may be a_struct to work in place
+*   @param a_struct Operand
+*   @param s Scalar factor
+*   @note Grows the capacity of dst_struct to exactly the operand size when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_vscale(a, a, 0.5);
+*/
+#define array_vscale(dst_struct, a_struct, s) \
+    array__vapply(ARRAY__VOP_SCALE, dst_struct, a_struct, a_struct, a_struct, s, 0)
+
+/**
+*   Stores every element of a float or double array plus a scalar
+*   @param dst_struct Array struct to store the result in, may be a_struct to work in place
+*   @param a_struct Operand
+*   @param s Scalar to add
+*   @note Grows the capacity of dst_struct to exactly the operand size when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_vadd_scalar(a, a, 1.0);
+*/
+#define array_vadd_scalar(dst_struct, a_struct, s) \
+    array__vapply(ARRAY__VOP_ADD_SCALAR, dst_struct, a_struct, a_struct, a_struct, s, 0)
+
+/**
+*   Stores every element of a float or double array limited to [lo, hi]
+*   @param dst_struct Array struct to store the result in, may be a_struct to work in place
+*   @param a_struct Operand
+*   @param lo Lower bound
+*   @param hi Upper bound, must not be less than lo
+*   @note NaN elements are kept as NaN
+*   @note Grows the capacity of dst_struct to exactly the operand size when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_vclamp(a, a, 0.0, 1.0);
+*/
+#define array_vclamp(dst_struct, a_struct, lo, hi) \
+    array__vapply(ARRAY__VOP_CLAMP, dst_struct, a_struct, a_struct, a_struct, lo, hi)
+
+/**
+*   Stores the absolute value of every element of a float or double array
+*   @param dst_struct Array struct to store the result in, may be a_struct to work in place
+*   @param a_struct Operand
+*   @note Grows the capacity of dst_struct to exactly the operand size when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_vabs(a, a);
+*/
+#define array_vabs(dst_struct, a_struct) \
+    array__vapply(ARRAY__VOP_ABS, dst_struct, a_struct, a_struct, a_struct, 0, 0)
+
+/**
+*   Compares two float or double arrays elementwise into a mask of 0 and 1 bytes
+*   @param mask_struct array_struct(uint8_t) to store the mask in
+*   @param a_struct Left operand
+*   @param pred Comparison from array_cmp, NaN only compares true for ARRAY_CMP_NE
+*   @param b_struct Right operand
+*   @note Grows the capacity of mask_struct to exactly the operand size when it is too small
+*   @note Will not execute if any error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of mask_struct to ARRAY_OUT_OF_MEM or ARRAY_SIZE_MISMATCH
+*   @example array_vcmp(mask, a, ARRAY_CMP_LT, b);
+*/
+#define array_vcmp(mask_struct, a_struct, pred, b_struct) do { \
+        if(mask_struct.error != ARRAY_OK_ERROR || a_struct.error != ARRAY_OK_ERROR || b_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        if(a_struct.size != b_struct.size) { \
+            mask_struct.error = ARRAY_SIZE_MISMATCH; \
+            break; \
+        } \
+        array__vcompare(mask_struct, a_struct, pred, b_struct.buf, 0); \
+    } while(0)
+
+/**
+*   Compares every element of a float or double array with a scalar into a mask of 0 and 1 bytes
+*   @param mask_struct array_struct(uint8_t) to store the mask in
+*   @param a_struct Left operand
+*   @param pred Comparison from array_cmp, NaN only compares true for ARRAY_CMP_NE
+*   @param s Right operand
+*   @note Grows the capacity of mask_struct to exactly the operand size when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of mask_struct to ARRAY_OUT_OF_MEM
+*   @example array_vcmp_scalar(mask, a, ARRAY_CMP_GE, 0.0);
+*/
+#define array_vcmp_scalar(mask_struct, a_struct, pred, s) \
+    array__vcompare(mask_struct, a_struct, pred, NULL, s)
+
+typedef enum {
+    ARRAY_ROUND_NEAREST,
+    ARRAY_ROUND_DOWN,
+    ARRAY_ROUND_UP,
+    ARRAY_ROUND_ZERO
+} array_round;
+
+/**
+*   Checks whether the cpu has F16C half precision conversion instructions, detected once
+*   @return Nonzero if F16C can be used
+*/
+static inline int array_cpu_f16c(void) {
+#if defined(ARRAY_HAS_X86_SIMD)
+    /* Worker threads may ask at the same time, they all store the same answer */
+    static int f16c = -1;
+    int cached = __atomic_load_n(&f16c, __ATOMIC_RELAXED);
+    if(cached < 0) {
+        __builtin_cpu_init();
+        cached = array_cpu_isa() != ARRAY_ISA_SCALAR && __builtin_cpu_supports("f16c");
+        __atomic_store_n(&f16c, cached, __ATOMIC_RELAXED);
+    }
+    return cached;
+#else
+    return 0;
+#endif
+}
+
+static inline uint16_t array__f32_to_f16(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    x &= 0x7FFFFFFF;
+    if(x >= 0x47800000) {
+        return sign | (x > 0x7F800000 ? 0x7E00 : 0x7C00);
+    }
+    if(x < 0x38800000) {
+        /* Adding 0.5f lines the half subnormal up with the float mantissa and rounds to nearest even */
+        float magic = 0.5f;
+        uint32_t magic_bits;
+        memcpy(&f, &x, sizeof(f));
+        f += magic;
+        memcpy(&x, &f, sizeof(x));
+        memcpy(&magic_bits, &magic, sizeof(magic_bits));
+        return sign | (x - magic_bits);
+    }
+    x += 0xC8000FFF + ((x >> 13) & 1);
+    return sign | (x >> 13);
+}
+
+static inline float array__f16_to_f32(uint16_t h) {
+    uint32_t x = (uint32_t)(h & 0x7FFF) << 13;
+    uint32_t exponent = x & 0x0F800000;
+    x += 0x38000000;
+    if(exponent == 0x0F800000) {
+        x += 0x38000000;
+    }
+    else if(exponent == 0) {
+        float f, magic = 0x1p-14f;
+        x += 1 << 23;
+        memcpy(&f, &x, sizeof(f));
+        f -= magic;
+        memcpy(&x, &f, sizeof(x));
+    }
+    x |= (uint32_t)(h & 0x8000) << 16;
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static inline int8_t array__quantize_i8(float x, float scale, int mode) {
+    x *= scale;
+    if(x != x) {
+        return 0;
+    }
+    x = x < -128.0f ? -128.0f : x > 127.0f ? 127.0f : x;
+    int32_t r = (int32_t)x;
+    switch(mode) {
+    case ARRAY_ROUND_NEAREST: {
+        float frac = x - (float)r;
+        if(frac > 0.5f || (frac == 0.5f && (r & 1))) {
+            ++r;
+        }
+        else if(frac < -0.5f || (frac == -0.5f && (r & 1))) {
+            --r;
+        }
+        break;
+    }
+    case ARRAY_ROUND_DOWN:
+        r -= (float)r > x;
+        break;
+    case ARRAY_ROUND_UP:
+        r += (float)r < x;
+        break;
+    }
+    return (int8_t)r;
+}
+
+static inline void array__cvt_f64_f32_scalar(float* d, const double* s, uint64_t n, float scale, int mode) {
+    (void)scale; (void)mode;
+    for(uint64_t i = 0; i < n; ++i) d[i] = (float)s[i];
+}
+
+static inline void array__cvt_f32_f64_scalar(double* d, const float* s, uint64_t n, float scale, int mode) {
+    (void)scale; (void)mode;
+    for(uint64_t i = 0; i < n; ++i) d[i] = s[i];
+}
+
+static inline void array__cvt_u16_u32_scalar(uint32_t* d, const uint16_t* s, uint64_t n, float scale, int mode) {
+    (void)scale; (void)mode;
+    for(uint64_t i = 0; i < n; ++i) d[i] = s[i];
+}
+
+static inline void array__cvt_u32_u16_scalar(uint16_t* d, const uint32_t* s, uint64_t n, float scale, int saturate) {
+    (void)scale;
+    for(uint64_t i = 0; i < n; ++i) d[i] = saturate && s[i] > 0xFFFF ? 0xFFFF : (uint16_t)s[i];
+}
+
+static inline void array__cvt_f32_f16_scalar(uint16_t* d, const float* s, uint64_t n, float scale, int mode) {
+    (void)scale; (void)mode;
+    for(uint64_t i = 0; i < n; ++i) d[i] = array__f32_to_f16(s[i]);
+}
+
+static inline void array__cvt_f16_f32_scalar(float* d, const uint16_t* s, uint64_t n, float scale, int mode) {
+    (void)scale; (void)mode;
+    for(uint64_t i = 0; i < n; ++i) d[i] = array__f16_to_f32(s[i]);
+}
+
+static inline void array__quantize_f32_i8_scalar(int8_t* d, const float* s, uint64_t n, float scale, int mode) {
+    for(uint64_t i = 0; i < n; ++i) d[i] = array__quantize_i8(s[i], scale, mode);
+}
+
+static inline void array__dequantize_i8_f32_scalar(float* d, const int8_t* s, uint64_t n, float scale, int mode) {
+    (void)mode;
+    for(uint64_t i = 0; i < n; ++i) d[i] = s[i] * scale;
+}
+
+#if defined(ARRAY_HAS_X86_SIMD)
+
+static inline ARRAY_TARGET("avx2") uint64_t array__cvt_f64_f32_avx2(float* d, const double* s, uint64_t n, float scale, int mode) {
+    (void)scale; (void)mode;
+    uint64_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        _mm_storeu_ps(d + i, _mm256_cvtpd_ps(_mm256_loadu_pd(s + i)));
+        _mm_storeu_ps(d + i + 4, _mm256_cvtpd_ps(_mm256_loadu_pd(s + i + 4)));
+    }
+    return i;
+}
+
+static inline ARRAY_TARGET("avx2") uint64_t array__cvt_f32_f64_avx2(double* d, const float* s, uint64_t n, float scale, int mode) {
+    (void)scale; (void)mode;
+    uint64_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(d + i, _mm256_cvtps_pd(_mm_loadu_ps(s + i)));
+        _mm256_storeu_pd(d + i + 4, _mm256_cvtps_pd(_mm_loadu_ps(s + i + 4)));
+    }
+    return i;
+}
+
+static inline ARRAY_TARGET("avx2") uint64_t array__cvt_u16_u32_avx2(uint32_t* d, const uint16_t* s, uint64_t n, float scale, int mode) {
+    (void)scale; (void)mode;
+    uint64_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(s + i));
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(x)));
+        _mm256_storeu_si256((__m256i*)(d + i + 8), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(x, 1)));
+    }
+    return i;
+}
+
+static inline ARRAY_TARGET("avx2") uint64_t array__cvt_u32_u16_avx2(uint16_t* d, const uint32_t* s, uint64_t n, float scale, int saturate) {
+    (void)scale;
+    const __m256i max = _mm256_set1_epi32(0xFFFF);
+    uint64_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        __m256i lo = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i hi = _mm256_loadu_si256((const __m256i*)(s + i + 8));
+        lo = saturate ? _mm256_min_epu32(lo, max) : _mm256_and_si256(lo, max);
+        hi = saturate ? _mm256_min_epu32(hi, max) : _mm256_and_si256(hi, max);
+        /* packus works within 128 bit lanes, so restore the element order afterwards */
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256((__m256i*)(d + i), packed);
+    }
+    return i;
+}
+
+static inline ARRAY_TARGET("avx2,f16c") uint64_t array__cvt_f32_f16_avx2(uint16_t* d, const float* s, uint64_t n, float scale, int mode) {
+    (void)scale; (void)mode;
+    uint64_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        _mm_storeu_si128((__m128i*)(d + i), _mm256_cvtps_ph(_mm256_loadu_ps(s + i), _MM_FROUND_TO_NEAREST_INT));
+    }
+    return i;
+}
+
+static inline ARRAY_TARGET("avx2,f16c") uint64_t array__cvt_f16_f32_avx2(float* d, const uint16_t* s, uint64_t n, float scale, int mode) {
+    (void)scale; (void)mode;
+    uint64_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(d + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(s + i))));
+    }
+    return i;
+}
+
+#define ARRAY__QUANTIZE_LOOP(imm) \
+    for(; i + 8 <= n; i += 8) { \
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(s + i), vscale); \
+        x = _mm256_and_ps(x, _mm256_cmp_ps(x, x, _CMP_ORD_Q)); \
+        x = _mm256_round_ps(_mm256_min_ps(_mm256_max_ps(x, lo), hi), imm | _MM_FROUND_NO_EXC); \
+        __m256i x32 = _mm256_cvttps_epi32(x); \
+        __m128i x16 = _mm_packs_epi32(_mm256_castsi256_si128(x32), _mm256_extracti128_si256(x32, 1)); \
+        _mm_storel_epi64((__m128i*)(d + i), _mm_packs_epi16(x16, x16)); \
+    }
+
+static inline ARRAY_TARGET("avx2") uint64_t array__quantize_f32_i8_avx2(int8_t* d, const float* s, uint64_t n, float scale, int mode) {
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256 lo = _mm256_set1_ps(-128.0f);
+    const __m256 hi = _mm256_set1_ps(127.0f);
+    uint64_t i = 0;
+    switch(mode) {
+    case ARRAY_ROUND_NEAREST: ARRAY__QUANTIZE_LOOP(_MM_FROUND_TO_NEAREST_INT) break;
+    case ARRAY_ROUND_DOWN: ARRAY__QUANTIZE_LOOP(_MM_FROUND_TO_NEG_INF) break;
+    case ARRAY_ROUND_UP: ARRAY__QUANTIZE_LOOP(_MM_FROUND_TO_POS_INF) break;
+    case ARRAY_ROUND_ZERO: ARRAY__QUANTIZE_LOOP(_MM_FROUND_TO_ZERO) break;
+    }
+    return i;
+}
+
+static inline ARRAY_TARGET("avx2") uint64_t array__dequantize_i8_f32_avx2(float* d, const int8_t* s, uint64_t n, float scale, int mode) {
+    (void)mode;
+    const __m256 vscale = _mm256_set1_ps(scale);
+    uint64_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(s + i)));
+        _mm256_storeu_ps(d + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), vscale));
+    }
+    return i;
+}
+
+/* Runs the AVX2 kernel over whole vectors when available and the scalar kernel over the rest */
+#define ARRAY__CVT_DISPATCH(name, usable) do { \
+        uint64_t done = (usable) ? array__##name##_avx2(d, s, n, scale, mode) : 0; \
+        array__##name##_scalar(d + done, s + done, n - done, scale, mode); \
+    } while(0)
+#else
+#define ARRAY__CVT_DISPATCH(name, usable) array__##name##_scalar(d, s, n, scale, mode)
+#endif
+
+static inline void array__cvt_f64_f32(float* d, const double* s, uint64_t n, float scale, int mode) {
+    ARRAY__CVT_DISPATCH(cvt_f64_f32, array_cpu_isa() != ARRAY_ISA_SCALAR);
+}
+
+static inline void array__cvt_f32_f64(double* d, const float* s, uint64_t n, float scale, int mode) {
+    ARRAY__CVT_DISPATCH(cvt_f32_f64, array_cpu_isa() != ARRAY_ISA_SCALAR);
+}
+
+static inline void array__cvt_u16_u32(uint32_t* d, const uint16_t* s, uint64_t n, float scale, int mode) {
+    ARRAY__CVT_DISPATCH(cvt_u16_u32, array_cpu_isa() != ARRAY_ISA_SCALAR);
+}
+
+static inline void array__cvt_u32_u16(uint16_t* d, const uint32_t* s, uint64_t n, float scale, int mode) {
+    ARRAY__CVT_DISPATCH(cvt_u32_u16, array_cpu_isa() != ARRAY_ISA_SCALAR);
+}
+
+static inline void array__cvt_f32_f16(uint16_t* d, const float* s, uint64_t n, float scale, int mode) {
+    ARRAY__CVT_DISPATCH(cvt_f32_f16, array_cpu_f16c());
+}
+
+static inline void array__cvt_f16_f32(float* d, const uint16_t* s, uint64_t n, float scale, int mode) {
+    ARRAY__CVT_DISPATCH(cvt_f16_f32, array_cpu_f16c());
+}
+
+static inline void array__quantize_f32_i8(int8_t* d, const float* s, uint64_t n, float scale, int mode) {
+    ARRAY__CVT_DISPATCH(quantize_f32_i8, array_cpu_isa() != ARRAY_ISA_SCALAR);
+}
+
+static inline void array__dequantize_i8_f32(float* d, const int8_t* s, uint64_t n, float scale, int mode) {
+    ARRAY__CVT_DISPATCH(dequantize_i8_f32, array_cpu_isa() != ARRAY_ISA_SCALAR);
+}
+
+/*
+*   Checks the operands, sizes the destination once and runs a conversion kernel over every element
+*/
+#define array__vconvert(kernel, dst_struct, src_struct, scale, mode) do { \
+        if(dst_struct.error == ARRAY_OK_ERROR && src_struct.error == ARRAY_OK_ERROR) { \
+            array__reserve_exact(dst_struct, src_struct.size); \
+            if(dst_struct.error == ARRAY_OK_ERROR) { \
+                array__before(dst_struct, 0, dst_struct.size); \
+                kernel(dst_struct.buf, src_struct.buf, src_struct.size, scale, mode); \
+                dst_struct.size = src_struct.size; \
+                array__after(dst_struct, 0, dst_struct.size); \
+            } \
+        } \
+    } while(0)
+
+/**
+*   Replaces the contents of a float array with the values of a double array, rounded to nearest
+*   @param dst_struct array_struct(float) to store the result in
+*   @param src_struct array_struct(double) to convert
+*   @note Grows the capacity of dst_struct to exactly the size of src_struct when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_convert_f64_f32(f, d);
+*/
+#define array_convert_f64_f32(dst_struct, src_struct) array__vconvert(array__cvt_f64_f32, dst_struct, src_struct, 0, 0)
+
+/**
+*   Replaces the contents of a double array with the values of a float array
+*   @param dst_struct array_struct(double) to store the result in
+*   @param src_struct array_struct(float) to convert
+*   @note Grows the capacity of dst_struct to exactly the size of src_struct when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_convert_f32_f64(d, f);
+*/
+#define array_convert_f32_f64(dst_struct, src_struct) array__vconvert(array__cvt_f32_f64, dst_struct, src_struct, 0, 0)
+
+/**
+*   Replaces the contents of a uint32_t array with the values of a uint16_t array
+*   @param dst_struct array_struct(uint32_t) to store the result in
+*   @param src_struct array_struct(uint16_t) to widen
+*   @note Grows the capacity of dst_struct to exactly the size of src_struct when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_convert_u16_u32(wide, narrow);
+*/
+#define array_convert_u16_u32(dst_struct, src_struct) array__vconvert(array__cvt_u16_u32, dst_struct, src_struct, 0, 0)
+
+/**
+*   Replaces the contents of a uint16_t array with the values of a uint32_t array
+*   @param dst_struct array_struct(uint16_t) to store the result in
+*   @param src_struct array_struct(uint32_t) to narrow
+*   @param saturate Nonzero to store 65535 for larger values, zero to keep only their low 16 bits
+*   @note Grows the capacity of dst_struct to exactly the size of src_struct when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_convert_u32_u16(narrow, wide, 1);
+*/
+#define array_convert_u32_u16(dst_struct, src_struct, saturate) \
+    array__vconvert(array__cvt_u32_u16, dst_struct, src_struct, 0, saturate)
+
+/**
+*   Replaces the contents of a uint16_t array with the values of a float array as IEEE half precision bits
+*   @param dst_struct array_struct(uint16_t) to store the result in
+*   @param src_struct array_struct(float) to convert
+*   @note Rounds to nearest even and uses F16C instructions when the cpu has them
+*   @note Grows the capacity of dst_struct to exactly the size of src_struct when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_convert_f32_f16(half, f);
+*/
+#define array_convert_f32_f16(dst_struct, src_struct) array__vconvert(array__cvt_f32_f16, dst_struct, src_struct, 0, 0)
+
+/**
+*   Replaces the contents of a float array with the values of a uint16_t array of IEEE half precision bits
+*   @param dst_struct array_struct(float) to store the result in
+*   @param src_struct array_struct(uint16_t) to convert
+*   @note Uses F16C instructions when the cpu has them
+*   @note Grows the capacity of dst_struct to exactly the size of src_struct when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_convert_f16_f32(f, half);
+*/
+#define array_convert_f16_f32(dst_struct, src_struct) array__vconvert(array__cvt_f16_f32, dst_struct, src_struct, 0, 0)
+
+/**
+*   Replaces the contents of an int8_t array with the values of a float array multiplied by scale
+*   @param dst_struct array_struct(int8_t) to store the result in
+*   @param src_struct array_struct(float) to quantize
+*   @param scale Factor applied before rounding
+*   @param mode Rounding from array_round
+*   @note Saturates to [-128, 127] and stores 0 for NaN
+*   @note Grows the capacity of dst_struct to exactly the size of src_struct when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_quantize_f32_i8(q, f, 127.0f, ARRAY_ROUND_NEAREST);
+*/
+#define array_quantize_f32_i8(dst_struct, src_struct, scale, mode) \
+    array__vconvert(array__quantize_f32_i8, dst_struct, src_struct, scale, mode)
+
+/**
+*   Replaces the contents of a float array with the values of an int8_t array multiplied by scale
+*   @param dst_struct array_struct(float) to store the result in
+*   @param src_struct array_struct(int8_t) to dequantize
+*   @param scale Factor applied to every value
+*   @note Grows the capacity of dst_struct to exactly the size of src_struct when it is too small
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of dst_struct to ARRAY_OUT_OF_MEM
+*   @example array_dequantize_i8_f32(f, q, 1.0f / 127.0f);
+*/
+#define array_dequantize_i8_f32(dst_struct, src_struct, scale) \
+    array__vconvert(array__dequantize_i8_f32, dst_struct, src_struct, scale, 0)
+
+#endif
@@ -0,0 +1,348 @@
+#ifndef ARRAY_SORT_H
+#define ARRAY_SORT_H
+
+#include "array.h"
+
+/*
+*   Argsort computes the order of an array as a permutation instead of moving its values, so several
+*   parallel arrays can be put in the same order with array_apply_permutation without building a
+*   sorted copy of each.
+*
+*   array_struct(uint64_t) perm;
+*   array_init(uint64_t, perm, 1);
+*   array_argsort(timestamps, perm);
+*   array_apply_permutation(timestamps, perm);
+*   array_apply_permutation(prices, perm);
+*/
+
+#define ARRAY__PERM_MARK (1ull << 63)
+
+/* Maps each value to an unsigned key with the same order, so radix passes over key bytes sort it */
+#define ARRAY__SORT_KEYS(T, U, sfx, flip) \
+    static inline void array__sort_keys_##sfx(const void* buf, uint64_t n, uint64_t* keys) { \
+        const T* values = buf; \
+        for(uint64_t i = 0; i < n; ++i) { \
+            keys[i] = (uint64_t)(U)((U)values[i] ^ (U)(flip)); \
+        } \
+    }
+
+ARRAY__SORT_KEYS(char, unsigned char, char, (char)-1 < 0 ? 0x80 : 0)
+ARRAY__SORT_KEYS(signed char, unsigned char, schar, 0x80)
+ARRAY__SORT_KEYS(unsigned char, unsigned char, uchar, 0)
+ARRAY__SORT_KEYS(short, unsigned short, short, 1u << (sizeof(short) * 8 - 1))
+ARRAY__SORT_KEYS(unsigned short, unsigned short, ushort, 0)
+ARRAY__SORT_KEYS(int, unsigned int, int, 1u << (sizeof(int) * 8 - 1))
+ARRAY__SORT_KEYS(unsigned int, unsigned int, uint, 0)
+ARRAY__SORT_KEYS(long, unsigned long, long, 1ul << (sizeof(long) * 8 - 1))
+ARRAY__SORT_KEYS(unsigned long, unsigned long, ulong, 0)
+ARRAY__SORT_KEYS(long long, unsigned long long, llong, 1ull << (sizeof(long long) * 8 - 1))
+ARRAY__SORT_KEYS(unsigned long long, unsigned long long, ullong, 0)
+
+/* Negative floats have every bit flipped so larger magnitudes sort first, positive ones only the sign */
+static inline void array__sort_keys_float(const void* buf, uint64_t n, uint64_t* keys) {
+    const float* values = buf;
+    for(uint64_t i = 0; i < n; ++i) {
+        uint32_t bits;
+        memcpy(&bits, values + i, sizeof(bits));
+        keys[i] = bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+    }
+}
+
+static inline void array__sort_keys_double(const void* buf, uint64_t n, uint64_t* keys) {
+    const double* values = buf;
+    for(uint64_t i = 0; i < n; ++i) {
+        uint64_t bits;
+        memcpy(&bits, values + i, sizeof(bits));
+        keys[i] = bits & ARRAY__PERM_MARK ? ~bits : bits | ARRAY__PERM_MARK;
+    }
+}
+
+#define array__sort_keys(buf) _Generic((buf), \
+        char*: array__sort_keys_char, signed char*: array__sort_keys_schar, unsigned char*: array__sort_keys_uchar, \
+        short*: array__sort_keys_short, unsigned short*: array__sort_keys_ushort, \
+        int*: array__sort_keys_int, unsigned int*: array__sort_keys_uint, \
+        long*: array__sort_keys_long, unsigned long*: array__sort_keys_ulong, \
+        long long*: array__sort_keys_llong, unsigned long long*: array__sort_keys_ullong, \
+        float*: array__sort_keys_float, double*: array__sort_keys_double)
+
+/**
+*   Sorts indices by key with a stable least significant digit radix sort over 8 bit digits
+*   @note Digits that are the same for every key are skipped, so narrow types take only their own width in passes
+*   @return 1 on success, 0 when out of memory and perm is untouched
+*/
+static inline int array__argsort_radix(uint64_t* keys, uint64_t n, uint64_t* perm) {
+    uint64_t* keys_tmp = malloc(sizeof(uint64_t) * (n > 0 ? n : 1));
+    uint64_t* perm_tmp = malloc(sizeof(uint64_t) * (n > 0 ? n : 1));
+    uint64_t* hist = calloc(8 * 256, sizeof(uint64_t));
+    if(!keys_tmp || !perm_tmp || !hist) {
+        free(keys_tmp);
+        free(perm_tmp);
+        free(hist);
+        return 0;
+    }
+    for(uint64_t i = 0; i < n; ++i) {
+        uint64_t k = keys[i];
+        for(int d = 0; d < 8; ++d) {
+            ++hist[d * 256 + ((k >> (d * 8)) & 0xFF)];
+        }
+    }
+    uint64_t* src_keys = keys;
+    uint64_t* src_perm = perm;
+    uint64_t* dst_keys = keys_tmp;
+    uint64_t* dst_perm = perm_tmp;
+    for(uint64_t i = 0; i < n; ++i) {
+        perm[i] = i;
+    }
+    for(int d = 0; d < 8; ++d) {
+        uint64_t* h = hist + d * 256;
+        if(n == 0 || h[(keys[0] >> (d * 8)) & 0xFF] == n) {
+            continue;
+        }
+        uint64_t offset = 0;
+        for(int b = 0; b < 256; ++b) {
+            uint64_t count = h[b];
+            h[b] = offset;
+            offset += count;
+        }
+        for(uint64_t i = 0; i < n; ++i) {
+            uint64_t at = h[(src_keys[i] >> (d * 8)) & 0xFF]++;
+            dst_keys[at] = src_keys[i];
+            dst_perm[at] = src_perm[i];
+        }
+        uint64_t* t = src_keys;
+        src_keys = dst_keys;
+        dst_keys = t;
+        t = src_perm;
+        src_perm = dst_perm;
+        dst_perm = t;
+    }
+    if(src_perm != perm) {
+        memcpy(perm, src_perm, sizeof(uint64_t) * n);
+    }
+    free(keys_tmp);
+    free(perm_tmp);
+    free(hist);
+    return 1;
+}
+
+/**
+*   Sorts indices by comparing the elements they point at, with a stable bottom up merge sort
+*   @return 1 on success, 0 when out of memory and perm is untouched
+*/
+static inline int array__argsort_cmp(const unsigned char* buf, uint64_t es, uint64_t n, uint64_t* perm,
+        int (*cmp)(const void*, const void*)) {
+    uint64_t* tmp = malloc(sizeof(uint64_t) * (n > 0 ? n : 1));
+    if(!tmp) {
+        return 0;
+    }
+    /* Short runs are insertion sorted first, merging them is where the comparisons add up */
+    const uint64_t run = 16;
+    for(uint64_t i = 0; i < n; ++i) {
+        perm[i] = i;
+    }
+    for(uint64_t lo = 0; lo < n; lo += run) {
+        uint64_t hi = lo + run < n ? lo + run : n;
+        for(uint64_t i = lo + 1; i < hi; ++i) {
+            uint64_t x = perm[i];
+            uint64_t j = i;
+            for(; j > lo && cmp(buf + es * perm[j - 1], buf + es * x) > 0; --j) {
+                perm[j] = perm[j - 1];
+            }
+            perm[j] = x;
+        }
+    }
+    uint64_t* src = perm;
+    uint64_t* dst = tmp;
+    for(uint64_t width = run; width < n; width *= 2) {
+        for(uint64_t lo = 0; lo < n; lo += 2 * width) {
+            uint64_t mid = lo + width < n ? lo + width : n;
+            uint64_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            uint64_t i = lo;
+            uint64_t j = mid;
+            uint64_t k = lo;
+            while(i < mid && j < hi) {
+                dst[k++] = cmp(buf + es * src[j], buf + es * src[i]) < 0 ? src[j++] : src[i++];
+            }
+            memcpy(dst + k, src + i, sizeof(uint64_t) * (mid - i));
+            k += mid - i;
+            memcpy(dst + k, src + j, sizeof(uint64_t) * (hi - j));
+        }
+        uint64_t* t = src;
+        src = dst;
+        dst = t;
+    }
+    if(src != perm) {
+        memcpy(perm, src, sizeof(uint64_t) * n);
+    }
+    free(tmp);
+    return 1;
+}
+
+/**
+*   Checks that perm holds every index below n exactly once
+*   @return ARRAY_OK_ERROR, ARRAY_OUT_OF_BOUNDS for an index of n or more or ARRAY_INVALID_DATA for a repeated index
+*/
+static inline array_error array__perm_check(uint64_t* perm, uint64_t n) {
+    for(uint64_t i = 0; i < n; ++i) {
+        if(perm[i] >= n) {
+            return ARRAY_OUT_OF_BOUNDS;
+        }
+    }
+    /* The top bit of perm[k] is free since every index is below n, it records that k was seen */
+    array_error error = ARRAY_OK_ERROR;
+    for(uint64_t i = 0; i < n; ++i) {
+        uint64_t k = perm[i] & ~ARRAY__PERM_MARK;
+        if(perm[k] & ARRAY__PERM_MARK) {
+            error = ARRAY_INVALID_DATA;
+            break;
+        }
+        perm[k] |= ARRAY__PERM_MARK;
+    }
+    for(uint64_t i = 0; i < n; ++i) {
+        perm[i] &= ~ARRAY__PERM_MARK;
+    }
+    return error;
+}
+
+static inline void array__swap_bytes(unsigned char* p, unsigned char* q, uint64_t es) {
+    unsigned char tmp[64];
+    for(uint64_t off = 0; off < es; off += sizeof(tmp)) {
+        uint64_t len = es - off < sizeof(tmp) ? es - off : sizeof(tmp);
+        memcpy(tmp, p + off, len);
+        memcpy(p + off, q + off, len);
+        memcpy(q + off, tmp, len);
+    }
+}
+
+/**
+*   Moves element perm[i] of buf to position i for every i by following each cycle of the permutation once
+*   @note Visited positions are marked in the top bit of perm, which is cleared again before returning
+*/
+static inline void array__permute(unsigned char* buf, uint64_t es, uint64_t* perm, uint64_t n) {
+    unsigned char tmp[256];
+    for(uint64_t i = 0; i < n; ++i) {
+        if(perm[i] & ARRAY__PERM_MARK || perm[i] == i) {
+            continue;
+        }
+        uint64_t j = i;
+        if(es <= sizeof(tmp)) {
+            memcpy(tmp, buf + es * i, es);
+            for(;;) {
+                uint64_t k = perm[j];
+                perm[j] |= ARRAY__PERM_MARK;
+                if(k == i) {
+                    memcpy(buf + es * j, tmp, es);
+                    break;
+                }
+                memcpy(buf + es * j, buf + es * k, es);
+                j = k;
+            }
+        }
+        else {
+            /* Swapping along the cycle needs no element sized buffer for large elements */
+            for(;;) {
+                uint64_t k = perm[j];
+                perm[j] |= ARRAY__PERM_MARK;
+                if(k == i) {
+                    break;
+                }
+                array__swap_bytes(buf + es * j, buf + es * k, es);
+                j = k;
+            }
+        }
+    }
+    for(uint64_t i = 0; i < n; ++i) {
+        perm[i] &= ~ARRAY__PERM_MARK;
+    }
+}
+
+/**
+*   Stores in perm the indices of the array in ascending order of their values, using a radix sort
+*   @param array_struct Array struct of a builtin integer or floating point type to order
+*   @param perm_struct array_struct(uint64_t) to store the permutation in, perm[0] is the index of the smallest value
+*   @note The sort is stable, equal values keep their relative order
+*   @note Floating point values are ordered by their bits, -0 before +0 and NaNs at the ends by sign
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of perm_struct to ARRAY_OUT_OF_MEM
+*   @example array_argsort(timestamps, perm);
+*/
+#define array_argsort(array_struct, perm_struct) do { \
+        if(array_struct.error == ARRAY_OK_ERROR && perm_struct.error == ARRAY_OK_ERROR) { \
+            array_reserve(uint64_t, perm_struct, array_struct.size); \
+            if(perm_struct.error != ARRAY_OK_ERROR) { \
+                break; \
+            } \
+            uint64_t* array__keys = malloc(sizeof(uint64_t) * (array_struct.size > 0 ? array_struct.size : 1)); \
+            if(!array__keys) { \
+                perm_struct.error = ARRAY_OUT_OF_MEM; \
+                break; \
+            } \
+            array__sort_keys(array_struct.buf)(array_struct.buf, array_struct.size, array__keys); \
+            array__before(perm_struct, 0, perm_struct.size); \
+            if(array__argsort_radix(array__keys, array_struct.size, perm_struct.buf)) { \
+                perm_struct.size = array_struct.size; \
+            } \
+            else { \
+                perm_struct.error = ARRAY_OUT_OF_MEM; \
+            } \
+            array__after(perm_struct, 0, perm_struct.size); \
+            free(array__keys); \
+        } \
+    } while(0)
+
+/**
+*   Stores in perm the indices of the array in the order given by a comparison function, using a merge sort
+*   @param array_struct Array struct to order
+*   @param perm_struct array_struct(uint64_t) to store the permutation in, perm[0] is the index of the smallest value
+*   @param cmp qsort style function comparing two elements through pointers to them
+*   @note The sort is stable, equal values keep their relative order
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of perm_struct to ARRAY_OUT_OF_MEM
+*   @example array_argsort_by(orders, perm, order_cmp);
+*/
+#define array_argsort_by(array_struct, perm_struct, cmp) do { \
+        if(array_struct.error == ARRAY_OK_ERROR && perm_struct.error == ARRAY_OK_ERROR) { \
+            array_reserve(uint64_t, perm_struct, array_struct.size); \
+            if(perm_struct.error != ARRAY_OK_ERROR) { \
+                break; \
+            } \
+            array__before(perm_struct, 0, perm_struct.size); \
+            if(array__argsort_cmp((const unsigned char*)array_struct.buf, sizeof(*array_struct.buf), array_struct.size, \
+                    perm_struct.buf, cmp)) { \
+                perm_struct.size = array_struct.size; \
+            } \
+            else { \
+                perm_struct.error = ARRAY_OUT_OF_MEM; \
+            } \
+            array__after(perm_struct, 0, perm_struct.size); \
+        } \
+    } while(0)
+
+/**
+*   Reorders the array in place so that element i becomes the old element perm[i]
+*   @param array_struct Array struct to reorder
+*   @param perm_struct array_struct(uint64_t) holding a permutation, such as one from array_argsort
+*   @note Every element is moved once, perm_struct is left unchanged so it can be applied to more arrays
+*   @note Will not execute if either error state is not ARRAY_OK_ERROR
+*   @note Can modify error state of array_struct to ARRAY_SIZE_MISMATCH when the sizes differ,
+*   ARRAY_OUT_OF_BOUNDS when an index is too large or ARRAY_INVALID_DATA when an index repeats
+*   @example array_apply_permutation(prices, perm);
+*/
+#define array_apply_permutation(array_struct, perm_struct) do { \
+        if(array_struct.error == ARRAY_OK_ERROR && perm_struct.error == ARRAY_OK_ERROR) { \
+            if(array_struct.size != perm_struct.size) { \
+                array_struct.error = ARRAY_SIZE_MISMATCH; \
+                break; \
+            } \
+            array_error array__perm_error = array__perm_check(perm_struct.buf, perm_struct.size); \
+            if(array__perm_error != ARRAY_OK_ERROR) { \
+                array_struct.error = array__perm_error; \
+                break; \
+            } \
+            array__before(array_struct, 0, array_struct.size); \
+            array__permute((unsigned char*)array_struct.buf, sizeof(*array_struct.buf), perm_struct.buf, array_struct.size); \
+            array__after(array_struct, 0, array_struct.size); \
+        } \
+    } while(0)
+
+#endif
@@ -0,0 +1,324 @@
+#ifndef ARRAY_STRING_H
+#define ARRAY_STRING_H
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "array_io.h"
+
+/*
+*   String builder operations on array_struct(char). Bytes, C strings and numbers are appended straight
+*   into the spare capacity of the array, which grows by doubling, and the result can be flushed to a
+*   file descriptor once it holds enough bytes to make the system call worth it.
+*
+*   array_struct(char) out;
+*   array_init(char, out, 1 << 16);
+*   for(...) {
+*       array_str_append_cstr(out, "id=");
+*       array_str_append_int(out, row.id);
+*       array_str_append(out, " score=", 7);
+*       array_str_append_double(out, row.score);
+*       array_str_append(out, "\n", 1);
+*       array_str_flush_at(out, STDOUT_FILENO, 1 << 16);
+*   }
+*   array_str_flush(out, STDOUT_FILENO);
+*/
+
+/* Longest output of array__str_double plus the terminator snprintf writes */
+#define ARRAY__STR_DOUBLE_MAX 32
+
+static const char array__str_digits[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/**
+*   Writes the decimal digits of v to out, two at a time from the end
+*   @return Number of characters written, at most 20
+*/
+static inline unsigned array__str_u64(char* out, uint64_t v) {
+    unsigned len = 1;
+    for(uint64_t t = v; t >= 10; t /= 10) {
+        ++len;
+    }
+    char* p = out + len;
+    while(v >= 100) {
+        unsigned d = (unsigned)(v % 100) * 2;
+        v /= 100;
+        *--p = array__str_digits[d + 1];
+        *--p = array__str_digits[d];
+    }
+    if(v >= 10) {
+        *--p = array__str_digits[v * 2 + 1];
+        *--p = array__str_digits[v * 2];
+    }
+    else {
+        *--p = (char)('0' + v);
+    }
+    return len;
+}
+
+static inline unsigned array__str_i64(char* out, int64_t v) {
+    if(v < 0) {
+        *out = '-';
+        return 1 + array__str_u64(out + 1, (uint64_t)0 - (uint64_t)v);
+    }
+    return array__str_u64(out, (uint64_t)v);
+}
+
+static const double array__str_pow10[20] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19
+};
+
+/**
+*   Writes the shortest decimal form of x that reads back as the same double, in the style of %g
+*   @return Number of characters written, out needs ARRAY__STR_DOUBLE_MAX bytes
+*/
+static inline unsigned array__str_double(char* out, double x) {
+    /* Integral values below 1e15 print the same as %.15g, without going through snprintf */
+    if(x > -1e15 && x < 1e15 && x == (double)(int64_t)x && (x != 0 || !signbit(x))) {
+        return array__str_i64(out, (int64_t)x);
+    }
+    /*
+    *   In the range %g prints without exponent, look for the fewest decimals k such that m / 10^k is x.
+    *   Both m and 10^k are exact doubles there, so the division rounds like strtod does on the digits.
+    */
+    double ax = fabs(x);
+    int precision = isnormal(x) ? 15 : 1;
+    if(ax >= 1e-4 && ax < 1e15) {
+        /* Running out of exact digits means x needs more than 15 significant ones */
+        precision = 16;
+        for(unsigned k = 1; k < 20; ++k) {
+            double scaled = ax * array__str_pow10[k];
+            if(scaled >= 9007199254740992.0) {
+                break;
+            }
+            uint64_t m = (uint64_t)(scaled + 0.5);
+            if((double)m / array__str_pow10[k] == ax) {
+                unsigned len = 0;
+                if(x < 0) {
+                    out[len++] = '-';
+                }
+                uint64_t scale = (uint64_t)array__str_pow10[k];
+                len += array__str_u64(out + len, m / scale);
+                out[len++] = '.';
+                uint64_t frac = m % scale + scale;
+                array__str_u64(out + len - 1, frac);
+                /* frac was written with a leading 1 that the point overwrites back */
+                out[len - 1] = '.';
+                return len + k;
+            }
+        }
+    }
+    /* Every normal double with 15 or fewer significant digits survives %.15g, subnormals have fewer */
+    int len = 0;
+    for(; precision <= 17; ++precision) {
+        len = snprintf(out, ARRAY__STR_DOUBLE_MAX, "%.*g", precision, x);
+        if(x != x || strtod(out, NULL) == x) {
+            break;
+        }
+    }
+    return (unsigned)len;
+}
+
+/* Makes room for extra more bytes, doubling the capacity like array_add */
+#define array__str_reserve(array_struct, extra) do { \
+        if(array_struct.size + (extra) > array_struct.capacity) { \
+            char* array__temp = array__grow(array_struct.alloc, array_struct.buf, 1, &array_struct.capacity, \
+                array_struct.size + (extra)); \
+            if(!array__temp) { \
+                array_struct.error = ARRAY_OUT_OF_MEM; \
+                break; \
+            } \
+            array_struct.buf = array__temp; \
+        } \
+    } while(0)
+
+/**
+*   Appends n bytes to a char array
+*   @param array_struct array_struct(char) to append to
+*   @param bytes Pointer to the bytes
+*   @param n Number of bytes
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM
+*   @example array_str_append(out, "\r\n", 2);
+*/
+#define array_str_append(array_struct, bytes, n) do { \
+        uint64_t array__n = (n); \
+        if(array_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        array__str_reserve(array_struct, array__n); \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            memcpy(array_struct.buf + array_struct.size, (bytes), array__n); \
+            array_struct.size += array__n; \
+            array__after(array_struct, array_struct.size - array__n, array_struct.size); \
+        } \
+    } while(0)
+
+/**
+*   Appends a NUL terminated string to a char array, without the terminator
+*   @param array_struct array_struct(char) to append to
+*   @param cstr String to append
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM
+*   @example array_str_append_cstr(out, "total: ");
+*/
+#define array_str_append_cstr(array_struct, cstr) do { \
+        const char* array__cstr = (cstr); \
+        array_str_append(array_struct, array__cstr, strlen(array__cstr)); \
+    } while(0)
+
+/**
+*   Appends the decimal form of a signed integer to a char array
+*   @param array_struct array_struct(char) to append to
+*   @param value Integer converted to int64_t
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM
+*   @example array_str_append_int(out, -42);
+*/
+#define array_str_append_int(array_struct, value) do { \
+        int64_t array__value = (value); \
+        if(array_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        array__str_reserve(array_struct, 20); \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            unsigned array__len = array__str_i64(array_struct.buf + array_struct.size, array__value); \
+            array_struct.size += array__len; \
+            array__after(array_struct, array_struct.size - array__len, array_struct.size); \
+        } \
+    } while(0)
+
+/**
+*   Appends the decimal form of an unsigned integer to a char array
+*   @param array_struct array_struct(char) to append to
+*   @param value Integer converted to uint64_t
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM
+*   @example array_str_append_uint(out, bytes_sent);
+*/
+#define array_str_append_uint(array_struct, value) do { \
+        uint64_t array__value = (value); \
+        if(array_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        array__str_reserve(array_struct, 20); \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            unsigned array__len = array__str_u64(array_struct.buf + array_struct.size, array__value); \
+            array_struct.size += array__len; \
+            array__after(array_struct, array_struct.size - array__len, array_struct.size); \
+        } \
+    } while(0)
+
+/**
+*   Appends the shortest decimal form of a double that reads back as the same value
+*   @param array_struct array_struct(char) to append to
+*   @param value Double to format
+*   @note The format is that of %g with just enough digits, such as 0.1, 1e+100 or 0.30000000000000004, except
+*   that integral values below 1e15 are written out in full
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM
+*   @example array_str_append_double(out, ratio);
+*/
+#define array_str_append_double(array_struct, value) do { \
+        double array__value = (value); \
+        if(array_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        array__str_reserve(array_struct, ARRAY__STR_DOUBLE_MAX); \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            unsigned array__len = array__str_double(array_struct.buf + array_struct.size, array__value); \
+            array_struct.size += array__len; \
+            array__after(array_struct, array_struct.size - array__len, array_struct.size); \
+        } \
+    } while(0)
+
+/**
+*   Terminates the contents of a char array with a NUL, which is not counted in its size
+*   @param array_struct array_struct(char) to terminate
+*   @return buf, usable as a C string until the array changes
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM
+*   @example array_str_terminate(out); puts(out.buf);
+*/
+#define array_str_terminate(array_struct) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            array__str_reserve(array_struct, 1); \
+            if(array_struct.error == ARRAY_OK_ERROR) { \
+                array_struct.buf[array_struct.size] = '\0'; \
+            } \
+        } \
+    } while(0)
+
+/* Empties the array after its contents were written out */
+#define array__str_clear(array_struct) do { \
+        array__before(array_struct, 0, array_struct.size); \
+        array_struct.size = 0; \
+        array__after(array_struct, 0, 0); \
+    } while(0)
+
+/**
+*   Writes the contents of a char array to a file descriptor and empties it
+*   @param array_struct array_struct(char) to flush
+*   @param fd File descriptor to write to
+*   @note Partial and interrupted writes are retried until every byte is written
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_IO_ERROR, the array then keeps its contents even if part was written
+*   @example array_str_flush(out, STDOUT_FILENO);
+*/
+#define array_str_flush(array_struct, fd) do { \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            array_struct.error = array__write_all((fd), array_struct.buf, array_struct.size); \
+            if(array_struct.error == ARRAY_OK_ERROR) { \
+                array__str_clear(array_struct); \
+            } \
+        } \
+    } while(0)
+
+/**
+*   Flushes a char array to a file descriptor once it holds at least threshold bytes
+*   @param array_struct array_struct(char) to flush
+*   @param fd File descriptor to write to
+*   @param threshold Size from which the array is written out, the initial capacity is a good choice
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_IO_ERROR
+*   @example array_str_flush_at(out, sock, 1 << 16);
+*/
+#define array_str_flush_at(array_struct, fd, threshold) do { \
+        if(array_struct.size >= (uint64_t)(threshold)) { \
+            array_str_flush(array_struct, fd); \
+        } \
+    } while(0)
+
+/**
+*   Appends bytes through a char array used as a write buffer for a file descriptor
+*   @param array_struct array_struct(char) buffering the output
+*   @param fd File descriptor to write to
+*   @param bytes Pointer to the bytes
+*   @param n Number of bytes
+*   @param threshold Size from which the buffer is written out
+*   @note When the buffer and the bytes reach threshold together both go out in one writev, so large
+*   blocks are written without being copied into the buffer
+*   @note Will not execute if error state is not ARRAY_OK_ERROR
+*   @note Can modify error state to ARRAY_OUT_OF_MEM or ARRAY_IO_ERROR
+*   @example array_str_write(out, sock, body, body_len, 1 << 16);
+*/
+#define array_str_write(array_struct, fd, bytes, n, threshold) do { \
+        const char* array__bytes = (const char*)(bytes); \
+        uint64_t array__count = (n); \
+        if(array_struct.error != ARRAY_OK_ERROR) { \
+            break; \
+        } \
+        if(array_struct.size + array__count < (uint64_t)(threshold)) { \
+            array_str_append(array_struct, array__bytes, array__count); \
+            break; \
+        } \
+        struct iovec array__parts[2] = { array_iov(array_struct), { (void*)array__bytes, array__count } }; \
+        array_struct.error = array_writev((fd), array__parts, 2); \
+        if(array_struct.error == ARRAY_OK_ERROR) { \
+            array__str_clear(array_struct); \
+        } \
+    } while(0)
+
+#endif
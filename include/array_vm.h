@@ -0,0 +1,104 @@
+#ifndef ARRAY_VM_H
+#define ARRAY_VM_H
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include "array.h"
+
+/*
+*   The page allocator maps the buffer of an array straight from the OS instead of the heap. Shrinking
+*   keeps the mapping and hands the pages past the new capacity back with madvise, so no element is
+*   copied and growing again reuses the same virtual range, the pages are faulted back in as they are
+*   written. Growing past the mapping moves it with mremap where available, which does not copy either.
+*   It pays off for arrays of many pages that shrink and grow again, small arrays are better on the heap.
+*
+*   array_struct(double) samples;
+*   array_init(double, samples, 1 << 20);
+*   array_set_allocator(samples, array_vm_allocator());
+*
+*   Needs MAP_ANONYMOUS, define _DEFAULT_SOURCE or _GNU_SOURCE when building with -std=c11.
+*/
+
+/**
+*   Bytes before the first element of a mapping, they hold its length and keep the elements cache line aligned
+*/
+#define ARRAY_VM_HEADER 64
+
+static inline uint64_t array__vm_round(uint64_t bytes) {
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    return (bytes + page - 1) / page * page;
+}
+
+static inline void array__vm_discard(unsigned char* base, uint64_t from, uint64_t to) {
+    from = array__vm_round(from);
+    to = array__vm_round(to);
+    if(from < to) {
+#if defined(MADV_DONTNEED)
+        madvise(base + from, to - from, MADV_DONTNEED);
+#else
+        posix_madvise(base + from, to - from, POSIX_MADV_DONTNEED);
+#endif
+    }
+}
+
+static inline void* array__vm_resize(array_allocator* alloc, void* buf, uint64_t old_bytes, uint64_t new_bytes) {
+    (void)alloc;
+    uint64_t need = ARRAY_VM_HEADER + new_bytes;
+    if(!buf) {
+        uint64_t mapped = array__vm_round(need);
+        unsigned char* base = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(base == MAP_FAILED) {
+            return NULL;
+        }
+        memcpy(base, &mapped, sizeof(uint64_t));
+        return base + ARRAY_VM_HEADER;
+    }
+    unsigned char* base = (unsigned char*)buf - ARRAY_VM_HEADER;
+    uint64_t mapped;
+    memcpy(&mapped, base, sizeof(uint64_t));
+    if(new_bytes <= old_bytes) {
+        array__vm_discard(base, need, ARRAY_VM_HEADER + old_bytes);
+        return buf;
+    }
+    if(need <= mapped) {
+        return buf;
+    }
+    uint64_t grown = array__vm_round(need);
+#if defined(MREMAP_MAYMOVE)
+    unsigned char* moved = mremap(base, mapped, grown, MREMAP_MAYMOVE);
+    if(moved == MAP_FAILED) {
+        return NULL;
+    }
+#else
+    unsigned char* moved = mmap(NULL, grown, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(moved == MAP_FAILED) {
+        return NULL;
+    }
+    memcpy(moved, base, ARRAY_VM_HEADER + old_bytes);
+    munmap(base, mapped);
+#endif
+    memcpy(moved, &grown, sizeof(uint64_t));
+    return moved + ARRAY_VM_HEADER;
+}
+
+static inline void array__vm_release(array_allocator* alloc, void* buf, uint64_t bytes) {
+    (void)alloc;
+    (void)bytes;
+    unsigned char* base = (unsigned char*)buf - ARRAY_VM_HEADER;
+    uint64_t mapped;
+    memcpy(&mapped, base, sizeof(uint64_t));
+    munmap(base, mapped);
+}
+
+/**
+*   Gets the page allocator, shared by every array that uses it
+*   @return Pointer to pass to array_set_allocator
+*   @note Removing elements releases whole pages past the halved capacity without copying the elements
+*   @example array_set_allocator(a, array_vm_allocator());
+*/
+static inline array_allocator* array_vm_allocator(void) {
+    static array_allocator vm = { array__vm_resize, array__vm_release };
+    return &vm;
+}
+
+#endif
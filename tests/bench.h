@@ -0,0 +1,43 @@
+#ifndef ARRAY_BENCH_H
+#define ARRAY_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+*   Timing for the benchmarks. Each measurement keeps the fastest of BENCH_RUNS runs, so time lost to
+*   other processes or a cold cache drops out. Results go through bench_keep so the work is not removed.
+*/
+
+#define BENCH_RUNS 5
+
+static volatile double bench__sink;
+
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static inline void bench_keep(double x) {
+    bench__sink += x;
+}
+
+/* Size argument of a benchmark, such as megabytes or elements, or fallback when it is not given */
+static inline unsigned long long bench_arg(int argc, char** argv, unsigned long long fallback) {
+    return argc > 1 ? strtoull(argv[1], NULL, 10) : fallback;
+}
+
+/* Runs stmt BENCH_RUNS times and stores the fastest run in seconds */
+#define bench_best(seconds, stmt) do { \
+        seconds = 1e9; \
+        for(int bench__run = 0; bench__run < BENCH_RUNS; ++bench__run) { \
+            double bench__start = bench_now(); \
+            stmt; \
+            double bench__time = bench_now() - bench__start; \
+            seconds = bench__time < seconds ? bench__time : seconds; \
+        } \
+    } while(0)
+
+#endif
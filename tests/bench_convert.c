@@ -0,0 +1,104 @@
+#include "array_simd.h"
+#include "bench.h"
+
+/*
+*   Times every conversion against the element by element array_add loop it replaces, in elements
+*   per ns. Run as bench_convert [elements].
+*/
+
+static void report(const char* name, uint64_t n, double seconds) {
+    printf("%-28s %8.3f elements/ns\n", name, (double)n / seconds * 1e-9);
+}
+
+/* Converts with a plain loop of array_add, the way callers did before the kernels */
+#define add_loop(T, dst_struct, src_struct, expr) do { \
+        dst_struct.size = 0; \
+        for(uint64_t i = 0; i < src_struct.size; ++i) { \
+            array_add(T, dst_struct, expr); \
+        } \
+    } while(0)
+
+static float half_to_float(uint16_t h) {
+    uint32_t sign = (uint32_t)(h >> 15) << 31;
+    uint32_t exp = h >> 10 & 0x1F;
+    uint32_t mant = h & 0x3FF;
+    float f;
+    if(exp == 0) {
+        f = ldexpf((float)mant, -24);
+        return sign ? -f : f;
+    }
+    uint32_t bits = sign | (exp == 31 ? 0xFFu << 23 : (exp + 112) << 23) | mant << 13;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+int main(int argc, char** argv) {
+    uint64_t n = bench_arg(argc, argv, 1 << 20);
+    array_struct(double) d = { 0 };
+    array_struct(float) f = { 0 };
+    array_struct(float) g = { 0 };
+    array_struct(uint16_t) u16 = { 0 };
+    array_struct(uint32_t) u32 = { 0 };
+    array_struct(uint16_t) half = { 0 };
+    array_struct(int8_t) q = { 0 };
+    array_init(double, d, n);
+    array_init(float, f, n);
+    array_init(float, g, n);
+    array_init(uint16_t, u16, n);
+    array_init(uint32_t, u32, n);
+    array_init(uint16_t, half, n);
+    array_init(int8_t, q, n);
+    unsigned long long state = 1;
+    for(uint64_t i = 0; i < n; ++i) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        array_add(double, d, (double)(int64_t)(state >> 11) * 0x1p-53 * 2.0 - 1.0);
+        array_add(uint16_t, u16, (uint16_t)(state >> 48));
+    }
+    if(d.error != ARRAY_OK_ERROR || u16.error != ARRAY_OK_ERROR) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    printf("%llu elements, %s kernels, F16C %s\n", (unsigned long long)n,
+        array_cpu_isa() == ARRAY_ISA_AVX512 ? "AVX-512" : array_cpu_isa() == ARRAY_ISA_AVX2 ? "AVX2" : "scalar",
+        array_cpu_f16c() ? "yes" : "no");
+
+    double seconds;
+    bench_best(seconds, add_loop(float, f, d, (float)d.buf[i]));
+    report("f64 -> f32 array_add loop", n, seconds);
+    bench_best(seconds, array_convert_f64_f32(f, d));
+    report("array_convert_f64_f32", n, seconds);
+    bench_best(seconds, add_loop(double, d, f, (double)f.buf[i]));
+    report("f32 -> f64 array_add loop", n, seconds);
+    bench_best(seconds, array_convert_f32_f64(d, f));
+    report("array_convert_f32_f64", n, seconds);
+    bench_best(seconds, add_loop(uint32_t, u32, u16, u16.buf[i]));
+    report("u16 -> u32 array_add loop", n, seconds);
+    bench_best(seconds, array_convert_u16_u32(u32, u16));
+    report("array_convert_u16_u32", n, seconds);
+    bench_best(seconds, add_loop(uint16_t, u16, u32, (uint16_t)(u32.buf[i] > 0xFFFF ? 0xFFFF : u32.buf[i])));
+    report("u32 -> u16 array_add loop", n, seconds);
+    bench_best(seconds, array_convert_u32_u16(u16, u32, 1));
+    report("array_convert_u32_u16", n, seconds);
+    bench_best(seconds, array_convert_f32_f16(half, f));
+    report("array_convert_f32_f16", n, seconds);
+    bench_best(seconds, add_loop(float, g, half, half_to_float(half.buf[i])));
+    report("f16 -> f32 array_add loop", n, seconds);
+    bench_best(seconds, array_convert_f16_f32(g, half));
+    report("array_convert_f16_f32", n, seconds);
+    bench_best(seconds, add_loop(int8_t, q, f, (int8_t)fmaxf(-128.0f, fminf(127.0f, nearbyintf(f.buf[i] * 127.0f)))));
+    report("f32 -> i8 array_add loop", n, seconds);
+    bench_best(seconds, array_quantize_f32_i8(q, f, 127.0f, ARRAY_ROUND_NEAREST));
+    report("array_quantize_f32_i8", n, seconds);
+    bench_best(seconds, array_dequantize_i8_f32(g, q, 1.0f / 127.0f));
+    report("array_dequantize_i8_f32", n, seconds);
+    bench_keep(g.buf[n / 2] + u16.buf[n / 3]);
+
+    array_free(d);
+    array_free(f);
+    array_free(g);
+    array_free(u16);
+    array_free(u32);
+    array_free(half);
+    array_free(q);
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "array.h"
+#include "bench.h"
+
+/*
+*   Compares the iteration macros with array_get and with plain indexing of buf, in elements per ns.
+*   Run as bench_foreach [elements], the default fits in the L2 cache so the loops are not waiting on
+*   memory, and small arrays are passed over several times per run to be long enough to time.
+*/
+
+typedef array_struct(uint32_t) u32_array;
+
+static uint32_t sum_get(u32_array a) {
+    uint32_t s = 0;
+    for(uint64_t i = 0; i < a.size; ++i) {
+        uint32_t x = 0;
+        array_get(a, i, x);
+        s += x;
+    }
+    return s;
+}
+
+static uint32_t sum_indexed(u32_array a) {
+    uint32_t s = 0;
+    for(uint64_t i = 0; i < a.size; ++i) {
+        s += a.buf[i];
+    }
+    return s;
+}
+
+static uint32_t sum_foreach(u32_array a) {
+    uint32_t s = 0;
+    array_foreach(uint32_t, x, a) {
+        s += x;
+    }
+    return s;
+}
+
+static void report(const char* name, uint64_t elements, double seconds) {
+    printf("%-26s %8.3f elements/ns\n", name, (double)elements / seconds * 1e-9);
+}
+
+/* Runs stmt passes times per measured run */
+#define repeat(passes, stmt) for(uint64_t pass = 0; pass < (passes); ++pass) { stmt; }
+
+int main(int argc, char** argv) {
+    uint64_t n = bench_arg(argc, argv, 1 << 15);
+    u32_array a, b, c;
+    array_init(uint32_t, a, n);
+    array_init(uint32_t, b, n);
+    array_init(uint32_t, c, n);
+    array_fill(uint32_t, a, n, 1);
+    array_fill(uint32_t, b, n, 2);
+    array_fill(uint32_t, c, n, 0);
+    if(a.error != ARRAY_OK_ERROR || b.error != ARRAY_OK_ERROR || c.error != ARRAY_OK_ERROR) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    uint64_t passes = (1ull << 26) / n + 1;
+    printf("%llu uint32_t values, %llu passes per run\n", (unsigned long long)n, (unsigned long long)passes);
+
+    double seconds;
+    bench_best(seconds, repeat(passes, bench_keep(sum_get(a))));
+    report("array_get loop", n * passes, seconds);
+    bench_best(seconds, repeat(passes, bench_keep(sum_indexed(a))));
+    report("indexed buf loop", n * passes, seconds);
+    bench_best(seconds, repeat(passes, bench_keep(sum_foreach(a))));
+    report("array_foreach sum", n * passes, seconds);
+    bench_best(seconds, repeat(passes, array_foreach_ptr(uint32_t, p, a) { *p = *p * 3 + 1; }));
+    report("array_foreach_ptr map", n * passes, seconds);
+    bench_best(seconds, repeat(passes, array_foreach_zip3(i, a, b, c) { c.buf[i] = a.buf[i] * b.buf[i] + c.buf[i]; }));
+    report("array_foreach_zip3 madd", n * passes, seconds);
+    bench_keep(c.buf[n / 2]);
+
+    array_free(a);
+    array_free(b);
+    array_free(c);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "array_groupby.h"
+#include "bench.h"
+
+/*
+*   Times array_groupby from a few distinct keys up to nearly one key per record, against sorting a
+*   copy of the records and folding runs of equal keys, in millions of records per second. Run as
+*   bench_groupby [records].
+*/
+
+typedef struct {
+    uint64_t user;
+    double ms;
+} event;
+
+typedef array_struct(event) event_array;
+
+static uint64_t user_of(const void* rec) {
+    return ((const event*)rec)->user;
+}
+
+static double ms_of(const void* rec) {
+    return ((const event*)rec)->ms;
+}
+
+static int by_user(const void* a, const void* b) {
+    uint64_t x = ((const event*)a)->user;
+    uint64_t y = ((const event*)b)->user;
+    return (x > y) - (x < y);
+}
+
+/* Sorts a copy and folds count, sum and max over each run of one key */
+static uint64_t sort_groupby(event_array* events, event_array* copy, double* check) {
+    array_copy(event, (*copy), (*events));
+    qsort(copy->buf, copy->size, sizeof(event), by_user);
+    uint64_t groups = 0;
+    for(uint64_t i = 0; i < copy->size; ++groups) {
+        uint64_t count = 0;
+        double sum = 0;
+        double max = -INFINITY;
+        uint64_t user = copy->buf[i].user;
+        for(; i < copy->size && copy->buf[i].user == user; ++i) {
+            ++count;
+            sum += copy->buf[i].ms;
+            max = copy->buf[i].ms > max ? copy->buf[i].ms : max;
+        }
+        *check += (double)count + sum + max;
+    }
+    return groups;
+}
+
+int main(int argc, char** argv) {
+    uint64_t n = bench_arg(argc, argv, 1 << 22);
+    event_array events = { 0 };
+    event_array copy = { 0 };
+    array_struct(uint64_t) users = { 0 };
+    array_struct(double) stats = { 0 };
+    array_init(event, events, n);
+    array_init(event, copy, 1);
+    array_init(uint64_t, users, 1);
+    array_init(double, stats, 1);
+    array_agg_spec specs[] = { { ARRAY_AGG_COUNT, NULL }, { ARRAY_AGG_SUM, ms_of }, { ARRAY_AGG_MAX, ms_of } };
+    printf("%llu records, %d threads\n", (unsigned long long)n, (int)array__thread_count());
+
+    uint64_t cardinalities[] = { 16, 1024, 65536, n };
+    for(size_t c = 0; c < sizeof(cardinalities) / sizeof(*cardinalities); ++c) {
+        uint64_t keys = cardinalities[c] < n ? cardinalities[c] : n;
+        unsigned long long state = 1;
+        events.size = 0;
+        for(uint64_t i = 0; i < n; ++i) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            array_add(event, events, ((event){ (state >> 20) % keys * 0x9E3779B97F4A7C15ull, (double)(state >> 54) }));
+        }
+        if(events.error != ARRAY_OK_ERROR) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        double seconds;
+        bench_best(seconds, array_groupby(events, user_of, specs, 3, users, stats));
+        printf("%8llu keys  array_groupby %8.2f Mrecords/s  %llu groups\n", (unsigned long long)keys,
+            (double)n / seconds * 1e-6, (unsigned long long)users.size);
+        double check = 0;
+        uint64_t groups = 0;
+        bench_best(seconds, groups = sort_groupby(&events, &copy, &check));
+        printf("%8llu keys  sort and fold %8.2f Mrecords/s  %llu groups\n", (unsigned long long)keys,
+            (double)n / seconds * 1e-6, (unsigned long long)groups);
+        bench_keep(check);
+        if(users.error != ARRAY_OK_ERROR || stats.error != ARRAY_OK_ERROR) {
+            fprintf(stderr, "group-by failed\n");
+            return 1;
+        }
+    }
+
+    array_free(events);
+    array_free(copy);
+    array_free(users);
+    array_free(stats);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <inttypes.h>
+#include "array_parse.h"
+#include "array_string.h"
+#include "bench.h"
+#include "test.h"
+
+/*
+*   Measures the parsers in MB/s of text, next to a strtod/strtoll loop over the same fields.
+*   Run as bench_parse [megabytes], the text is generated in memory so no file is needed.
+*/
+
+#define COLUMNS 8
+
+typedef array_struct(char) text_array;
+
+static void make_text(text_array* text, uint64_t bytes, int doubles) {
+    unsigned long long state = 1;
+    text->size = 0;
+    while(text->size < bytes && text->error == ARRAY_OK_ERROR) {
+        for(int c = 0; c < COLUMNS; ++c) {
+            int64_t v = (int64_t)(test_rand(&state) % 2000000000) - 1000000000;
+            if(doubles) {
+                array_str_append_double((*text), (double)v / 1024);
+            }
+            else {
+                array_str_append_int((*text), v);
+            }
+            array_str_append((*text), c + 1 < COLUMNS ? "," : "\n", 1);
+        }
+    }
+}
+
+/* Splits fields like the parsers, converting each one with the C library */
+static uint64_t libc_parse(const text_array* text, int doubles, double* sink) {
+    uint64_t fields = 0;
+    const char* p = text->buf;
+    const char* end = text->buf + text->size;
+    char* stop;
+    while(p < end) {
+        *sink += doubles ? strtod(p, &stop) : (double)strtoll(p, &stop, 10);
+        p = stop + 1;
+        ++fields;
+    }
+    return fields;
+}
+
+static void report(const char* name, uint64_t bytes, double seconds) {
+    printf("%-22s %8.1f MB/s\n", name, (double)bytes / seconds / 1e6);
+}
+
+int main(int argc, char** argv) {
+    uint64_t megabytes = bench_arg(argc, argv, 64);
+    text_array text = { 0 };
+    array_struct(int64_t) ints = { 0 };
+    array_struct(double) doubles = { 0 };
+    array_struct(uint64_t) ends = { 0 };
+    array_init(char, text, 1 << 20);
+    array_init(int64_t, ints, 1);
+    array_init(double, doubles, 1);
+    array_init(uint64_t, ends, 1);
+    printf("%" PRIu64 " MB of text, %d threads\n", megabytes, (int)array__thread_count());
+
+    for(int kind = 0; kind < 2; ++kind) {
+        make_text(&text, megabytes << 20, kind);
+        double best[3];
+        double sink = 0;
+        bench_best(best[0], array_parse_offsets(text, ',', ends));
+        if(kind) {
+            bench_best(best[1], array_parse_double(text, ',', doubles));
+        }
+        else {
+            bench_best(best[1], array_parse_int64(text, ',', ints));
+        }
+        bench_best(best[2], libc_parse(&text, kind, &sink));
+        if(text.error != ARRAY_OK_ERROR || ends.error != ARRAY_OK_ERROR || ints.error != ARRAY_OK_ERROR ||
+                doubles.error != ARRAY_OK_ERROR) {
+            fprintf(stderr, "parse failed\n");
+            return 1;
+        }
+        printf("%s fields (checksum %g)\n", kind ? "double" : "int64", sink);
+        report("array_parse_offsets", text.size, best[0]);
+        report(kind ? "array_parse_double" : "array_parse_int64", text.size, best[1]);
+        report(kind ? "strtod" : "strtoll", text.size, best[2]);
+    }
+
+    array_free(ends);
+    array_free(doubles);
+    array_free(ints);
+    array_free(text);
+    return 0;
+}
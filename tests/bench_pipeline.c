@@ -0,0 +1,109 @@
+#include "array_pipeline.h"
+#include "bench.h"
+
+/*
+*   Compares a filter, map and sum chain run as a fused pipeline, as a chunked pipeline and as the
+*   materialized chain building an array per stage, in records per ns. Run as bench_pipeline [records].
+*/
+
+typedef struct {
+    int kind;
+    int duration;
+} event;
+
+typedef array_struct(event) event_array;
+typedef array_struct(double) double_array;
+
+static double materialized(event_array events) {
+    event_array kept = { 0 };
+    double_array ms = { 0 };
+    array_init(event, kept, 1);
+    array_init(double, ms, 1);
+    for(uint64_t i = 0; i < events.size; ++i) {
+        if(events.buf[i].kind == 2) {
+            array_add(event, kept, events.buf[i]);
+        }
+    }
+    for(uint64_t i = 0; i < kept.size; ++i) {
+        array_add(double, ms, kept.buf[i].duration * 1e-3);
+    }
+    double total = 0;
+    for(uint64_t i = 0; i < ms.size; ++i) {
+        total += ms.buf[i];
+    }
+    array_free(kept);
+    array_free(ms);
+    return total;
+}
+
+static double fused(event_array events) {
+    double total = 0;
+    array_pipe(event, e, events,
+        array_pipe_filter(e.kind == 2)
+        array_pipe_let(double, ms, e.duration * 1e-3)
+        array_pipe_sum(total, ms));
+    return total;
+}
+
+static double chunked(event_array events, double_array* block) {
+    double total = 0;
+    array_pipe_chunked(event, e, events, 4096,
+        array_pipe_filter(e.kind == 2)
+        array_pipe_collect(double, (*block), e.duration * 1e-3), {
+            for(uint64_t i = 0; i < block->size; ++i) {
+                total += block->buf[i];
+            }
+            block->size = 0;
+        });
+    return total;
+}
+
+static double parallel(event_array events) {
+    double total = 0;
+    array_pipe_parallel(event, e, events, +:total,
+        array_pipe_filter(e.kind == 2)
+        array_pipe_sum(total, e.duration * 1e-3));
+    return total;
+}
+
+static void report(const char* name, uint64_t n, double seconds, double total) {
+    printf("%-22s %8.3f records/ns (total %.0f)\n", name, (double)n / seconds * 1e-9, total);
+}
+
+int main(int argc, char** argv) {
+    uint64_t n = bench_arg(argc, argv, 1 << 24);
+    event_array events;
+    double_array block;
+    array_init(event, events, n);
+    array_init(double, block, 4096);
+    unsigned long long state = 1;
+    for(uint64_t i = 0; i < n; ++i) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        array_add(event, events, ((event){ (int)(state >> 62), (int)(state >> 40 & 0xFFFF) }));
+    }
+    if(events.error != ARRAY_OK_ERROR) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    printf("%llu records, a quarter pass the filter\n", (unsigned long long)n);
+
+    double seconds;
+    double total = 0;
+    bench_best(seconds, total = materialized(events));
+    report("materialized chain", n, seconds, total);
+    bench_best(seconds, total = fused(events));
+    report("array_pipe", n, seconds, total);
+    bench_best(seconds, total = chunked(events, &block));
+    report("array_pipe_chunked", n, seconds, total);
+#if defined(_OPENMP)
+    bench_best(seconds, total = parallel(events));
+    report("array_pipe_parallel", n, seconds, total);
+#else
+    (void)parallel;
+#endif
+    bench_keep(total);
+
+    array_free(events);
+    array_free(block);
+    return 0;
+}
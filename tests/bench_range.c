@@ -0,0 +1,107 @@
+#include "array_range.h"
+#include "bench.h"
+
+/*
+*   Measures query and update throughput of the range index against scanning the range, in millions
+*   of operations per second. Run as bench_range [elements].
+*/
+
+#define QUERIES 1000000
+#define SCANS 200
+#define UPDATES 1000000
+
+static void report(const char* name, uint64_t ops, double seconds) {
+    printf("%-30s %10.3f Mops/s\n", name, (double)ops / seconds * 1e-6);
+}
+
+int main(int argc, char** argv) {
+    uint64_t n = bench_arg(argc, argv, 1 << 20);
+    array_struct(int64_t) a = { 0 };
+    array_struct(uint64_t) bounds = { 0 };
+    array_init(int64_t, a, n);
+    array_init(uint64_t, bounds, 2 * QUERIES);
+    unsigned long long state = 1;
+    for(uint64_t i = 0; i < n; ++i) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        array_add(int64_t, a, (int64_t)(state >> 44) - (1 << 19));
+    }
+    /* Ranges of every length, from single elements to the whole array */
+    for(int q = 0; q < QUERIES; ++q) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        uint64_t l = (state >> 20) % n;
+        uint64_t r = l + 1 + (state >> 42) % (n - l);
+        array_add(uint64_t, bounds, l);
+        array_add(uint64_t, bounds, r);
+    }
+    if(a.error != ARRAY_OK_ERROR || bounds.error != ARRAY_OK_ERROR) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    printf("%llu elements\n", (unsigned long long)n);
+
+    array_range_index idx;
+    double seconds;
+    bench_best(seconds, array_range_build(a, &idx); array_range_free(a, &idx));
+    report("build, elements", n, seconds);
+    array_range_build(a, &idx);
+    if(idx.error != ARRAY_OK_ERROR) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    int64_t keep = 0;
+    bench_best(seconds, for(int q = 0; q < SCANS; ++q) {
+        int64_t sum = 0;
+        for(uint64_t i = bounds.buf[2 * q]; i < bounds.buf[2 * q + 1]; ++i) {
+            sum += a.buf[i];
+        }
+        keep += sum;
+    });
+    report("scan sum queries", SCANS, seconds);
+    bench_best(seconds, for(int q = 0; q < QUERIES; ++q) {
+        keep += array_range_sum(&idx, bounds.buf[2 * q], bounds.buf[2 * q + 1]);
+    });
+    report("array_range_sum queries", QUERIES, seconds);
+    bench_best(seconds, for(int q = 0; q < SCANS; ++q) {
+        int64_t min = INT64_MAX;
+        for(uint64_t i = bounds.buf[2 * q]; i < bounds.buf[2 * q + 1]; ++i) {
+            min = a.buf[i] < min ? a.buf[i] : min;
+        }
+        keep += min;
+    });
+    report("scan min queries", SCANS, seconds);
+    bench_best(seconds, for(int q = 0; q < QUERIES; ++q) {
+        keep += array_range_min(&idx, bounds.buf[2 * q], bounds.buf[2 * q + 1]);
+    });
+    report("array_range_min queries", QUERIES, seconds);
+    bench_best(seconds, for(int q = 0; q < QUERIES; ++q) {
+        keep += array_range_max(&idx, bounds.buf[2 * q], bounds.buf[2 * q + 1]);
+    });
+    report("array_range_max queries", QUERIES, seconds);
+
+    /* Updates go through array_set, which repairs the index through its hook */
+    bench_best(seconds, for(int u = 0; u < UPDATES; ++u) {
+        array_set(a, bounds.buf[2 * u], (int64_t)u);
+    });
+    report("array_set with index", UPDATES, seconds);
+    array_range_free(a, &idx);
+    bench_best(seconds, for(int u = 0; u < UPDATES; ++u) {
+        array_set(a, bounds.buf[2 * u], (int64_t)u);
+    });
+    report("array_set without index", UPDATES, seconds);
+
+    /* Appends grow the array, so they are timed in a single run */
+    array_range_build(a, &idx);
+    double start = bench_now();
+    for(int u = 0; u < UPDATES; ++u) {
+        array_add(int64_t, a, (int64_t)u);
+    }
+    seconds = bench_now() - start;
+    report("array_add with index", UPDATES, seconds);
+    bench_keep((double)keep + (double)array_range_sum(&idx, 0, a.size));
+
+    array_range_free(a, &idx);
+    array_free(a);
+    array_free(bounds);
+    return 0;
+}
@@ -0,0 +1,33 @@
+# Compiles SOURCE with the GCC vectorization report and fails unless every line calling an iteration
+# macro is reported as a vectorized loop. Run with cmake -DCC=... -DINCLUDE=... -DSOURCE=... -DOUTPUT=... -P
+execute_process(
+    COMMAND ${CC} -O3 -fopt-info-vec-optimized -D_GNU_SOURCE -I${INCLUDE} -c ${SOURCE} -o ${OUTPUT}
+    RESULT_VARIABLE result
+    ERROR_VARIABLE report)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "compiling ${SOURCE} failed:\n${report}")
+endif()
+
+# Empty lines are kept so the position in the list is the line number
+file(READ ${SOURCE} text)
+string(REPLACE ";" "," text "${text}")
+string(REPLACE "\n" ";" lines "${text}")
+get_filename_component(name ${SOURCE} NAME)
+set(line 0)
+set(missed "")
+set(loops 0)
+foreach(code IN LISTS lines)
+    math(EXPR line "${line} + 1")
+    if(code MATCHES "^ +array_foreach")
+        math(EXPR loops "${loops} + 1")
+        if(NOT report MATCHES "${name}:${line}:[0-9]+: optimized: loop vectorized")
+            string(APPEND missed "\n${name}:${line}: ${code}")
+        endif()
+    endif()
+endforeach()
+if(loops EQUAL 0)
+    message(FATAL_ERROR "no iteration macro calls found in ${SOURCE}")
+endif()
+if(missed)
+    message(FATAL_ERROR "loops not vectorized:${missed}\nreport:\n${report}")
+endif()
@@ -0,0 +1,30 @@
+#ifndef ARRAY_TEST_H
+#define ARRAY_TEST_H
+
+#include <stdio.h>
+
+/*
+*   Minimal checks for the tests, a failed check reports its line and the test keeps running so one
+*   run lists every failure. Each test returns test_result() from main.
+*/
+
+static int test__failures = 0;
+
+#define test_check(cond) do { \
+        if(!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++test__failures; \
+        } \
+    } while(0)
+
+/* Deterministic values so a failure reproduces, rand() differs between C libraries */
+static inline unsigned long long test_rand(unsigned long long* state) {
+    *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+    return *state >> 33;
+}
+
+static inline int test_result(void) {
+    return test__failures ? 1 : 0;
+}
+
+#endif
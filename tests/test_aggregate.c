@@ -0,0 +1,80 @@
+#include "array_aggregate.h"
+#include "test.h"
+
+typedef struct {
+    int id;
+    double price;
+} order;
+
+static double order_price(const void* buf, uint64_t index) {
+    return ((const order*)buf)[index].price;
+}
+
+int main(void) {
+    unsigned long long state = 17;
+    array_struct(int) a;
+    array_init(int, a, 1);
+    for(int i = 0; i < 300; ++i) {
+        array_add(int, a, (int)(test_rand(&state) % 1000) - 500);
+    }
+    array_aggregate agg;
+    array_track_aggregate(a, &agg);
+
+    /* Every kind of mutation is compared against a scan of the array */
+    int ok = 1;
+    for(int step = 0; step < 5000; ++step) {
+        uint64_t at = a.size > 0 ? test_rand(&state) % a.size : 0;
+        int v = (int)(test_rand(&state) % 1000) - 500;
+        switch(test_rand(&state) % 6) {
+        case 0: array_add(int, a, v); break;
+        case 1: array_add_index(int, a, at, v); break;
+        case 2: if(a.size > 0) { array_set(a, at, v); } break;
+        case 3: if(a.size > 0) { array_remove_index(int, a, at); } break;
+        case 4: if(a.size > 0) { array_remove(int, a); } break;
+        default: if(step % 500 == 0) { array_fill(int, a, 50 + at % 400, v); } break;
+        }
+        double sum = 0;
+        double min = INFINITY;
+        double max = -INFINITY;
+        for(uint64_t i = 0; i < a.size; ++i) {
+            sum += a.buf[i];
+            min = a.buf[i] < min ? a.buf[i] : min;
+            max = a.buf[i] > max ? a.buf[i] : max;
+        }
+        ok &= array_aggregate_sum(&agg) == sum && array_aggregate_count(&agg) == a.size;
+        ok &= array_aggregate_min(&agg) == min && array_aggregate_max(&agg) == max;
+
+        uint64_t l = a.size > 0 ? test_rand(&state) % a.size : 0;
+        uint64_t r = l + test_rand(&state) % 64;
+        double lo, hi;
+        array_aggregate_range(&agg, l, r, &lo, &hi);
+        min = INFINITY;
+        max = -INFINITY;
+        for(uint64_t i = l; i < r && i < a.size; ++i) {
+            min = a.buf[i] < min ? a.buf[i] : min;
+            max = a.buf[i] > max ? a.buf[i] : max;
+        }
+        ok &= lo == min && hi == max;
+    }
+    test_check(ok);
+    test_check(a.error == ARRAY_OK_ERROR && agg.error == ARRAY_OK_ERROR);
+    array_untrack_aggregate(a, &agg);
+    test_check(a.hooks == NULL);
+    array_free(a);
+
+    array_struct(order) orders;
+    array_init(order, orders, 1);
+    array_aggregate prices;
+    array_track_aggregate_by(orders, &prices, order_price);
+    test_check(array_aggregate_min(&prices) == INFINITY && array_aggregate_sum(&prices) == 0);
+    array_add(order, orders, ((order){ 1, 2.5 }));
+    array_add(order, orders, ((order){ 2, 0.25 }));
+    array_add(order, orders, ((order){ 3, 10.0 }));
+    test_check(array_aggregate_sum(&prices) == 12.75);
+    test_check(array_aggregate_min(&prices) == 0.25 && array_aggregate_max(&prices) == 10.0);
+    array_remove(order, orders);
+    test_check(array_aggregate_max(&prices) == 2.5 && array_aggregate_count(&prices) == 2);
+    array_untrack_aggregate(orders, &prices);
+    array_free(orders);
+    return test_result();
+}
@@ -0,0 +1,108 @@
+#include <pthread.h>
+#include "array_budget.h"
+#include "test.h"
+
+#define LIMIT (1u << 20)
+
+typedef array_struct(uint64_t) u64_array;
+
+static int holds(const u64_array* a, uint64_t n, uint64_t mul) {
+    int ok = a->size == n;
+    for(uint64_t i = 0; ok && i < n; ++i) {
+        ok = a->buf[i] == i * mul;
+    }
+    return ok;
+}
+
+static void* grow_blocked(void* arg) {
+    array_budget* budget = arg;
+    u64_array b;
+    array_init(uint64_t, b, 1);
+    array_set_allocator(b, &budget->alloc);
+    for(uint64_t i = 0; i < 60000; ++i) {
+        array_add(uint64_t, b, i);
+    }
+    int ok = b.error == ARRAY_OK_ERROR && holds(&b, 60000, 1);
+    array_free(b);
+    return ok ? arg : NULL;
+}
+
+int main(void) {
+    array_budget budget;
+
+    /* Growth past the limit fails and the array keeps what it had */
+    test_check(array_budget_init(&budget, LIMIT, ARRAY_BUDGET_FAIL, NULL) == ARRAY_OK_ERROR);
+    u64_array a;
+    array_init(uint64_t, a, 1);
+    array_set_allocator(a, &budget.alloc);
+    uint64_t n = 0;
+    while(a.error == ARRAY_OK_ERROR && n < 10 * LIMIT) {
+        array_add(uint64_t, a, n * 2);
+        n += a.error == ARRAY_OK_ERROR;
+    }
+    array_budget_stats stats = array_budget_stats_of(&budget);
+    test_check(a.error == ARRAY_OUT_OF_MEM);
+    test_check(stats.used <= LIMIT && stats.peak <= LIMIT && stats.failures > 0);
+    test_check(n > LIMIT / 16 && holds(&a, n, 2));
+    array_free(a);
+    test_check(array_budget_stats_of(&budget).used == 0);
+    array_budget_free(&budget);
+
+    /* Spilling moves the least recently grown array to a file, it keeps its address and contents */
+    test_check(array_budget_init(&budget, LIMIT, ARRAY_BUDGET_SPILL, NULL) == ARRAY_OK_ERROR);
+    u64_array b;
+    array_init(uint64_t, a, 1);
+    array_init(uint64_t, b, 1);
+    array_set_allocator(a, &budget.alloc);
+    array_set_allocator(b, &budget.alloc);
+    for(uint64_t i = 0; i < 80000; ++i) {
+        array_add(uint64_t, a, i * 3);
+    }
+    uint64_t* a_buf = a.buf;
+    for(uint64_t i = 0; i < 80000; ++i) {
+        array_add(uint64_t, b, i * 5);
+    }
+    stats = array_budget_stats_of(&budget);
+    test_check(a.error == ARRAY_OK_ERROR && b.error == ARRAY_OK_ERROR);
+    test_check(stats.spills > 0 && stats.spilled_bytes > 0 && stats.used <= LIMIT);
+    test_check(a.buf == a_buf && holds(&a, 80000, 3) && holds(&b, 80000, 5));
+
+    /* A spilled array that grows comes back into memory */
+    for(uint64_t i = 80000; i < 90000; ++i) {
+        array_add(uint64_t, a, i * 3);
+    }
+    test_check(a.error == ARRAY_OK_ERROR && holds(&a, 90000, 3) && holds(&b, 80000, 5));
+    array_budget_spill(b);
+    test_check(b.error == ARRAY_OK_ERROR && holds(&b, 80000, 5));
+    array_free(a);
+    array_free(b);
+    stats = array_budget_stats_of(&budget);
+    test_check(stats.used == 0 && stats.spilled_bytes == 0);
+    array_budget_free(&budget);
+
+    u64_array heap;
+    array_init(uint64_t, heap, 1);
+    array_budget_spill(heap);
+    test_check(heap.error == ARRAY_INVALID_DATA);
+    array_free(heap);
+
+    /* A blocked growth waits until another array of the group is freed */
+    test_check(array_budget_init(&budget, LIMIT, ARRAY_BUDGET_BLOCK, NULL) == ARRAY_OK_ERROR);
+    array_init(uint64_t, a, 1);
+    array_set_allocator(a, &budget.alloc);
+    for(uint64_t i = 0; i < 100000; ++i) {
+        array_add(uint64_t, a, i);
+    }
+    pthread_t thread;
+    void* result = NULL;
+    test_check(pthread_create(&thread, NULL, grow_blocked, &budget) == 0);
+    while(array_budget_stats_of(&budget).waits == 0) {
+        usleep(1000);
+    }
+    array_free(a);
+    pthread_join(thread, &result);
+    test_check(result == &budget);
+    test_check(array_budget_stats_of(&budget).used == 0);
+    array_budget_free(&budget);
+    return test_result();
+}
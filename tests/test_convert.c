@@ -0,0 +1,132 @@
+#include "array_simd.h"
+#include "test.h"
+
+static int8_t expected_i8(float x, float scale, int mode) {
+    x *= scale;
+    if(isnan(x)) {
+        return 0;
+    }
+    float r = mode == ARRAY_ROUND_NEAREST ? nearbyintf(x) : mode == ARRAY_ROUND_DOWN ? floorf(x)
+        : mode == ARRAY_ROUND_UP ? ceilf(x) : truncf(x);
+    return (int8_t)(r < -128.0f ? -128.0f : r > 127.0f ? 127.0f : r);
+}
+
+int main(void) {
+    unsigned long long state = 3;
+
+    /* Every half value converts to float and back to itself, NaNs stay NaNs */
+    array_struct(uint16_t) halves, back;
+    array_struct(float) f;
+    array_init(uint16_t, halves, 1);
+    array_init(uint16_t, back, 1);
+    array_init(float, f, 1);
+    for(uint32_t h = 0; h <= 0xFFFF; ++h) {
+        array_add(uint16_t, halves, (uint16_t)h);
+    }
+    array_convert_f16_f32(f, halves);
+    array_convert_f32_f16(back, f);
+    int ok = f.size == 65536 && back.size == 65536;
+    for(uint32_t h = 0; ok && h <= 0xFFFF; ++h) {
+        int nan = (h & 0x7C00) == 0x7C00 && (h & 0x3FF);
+        ok &= nan ? isnan(f.buf[h]) && (back.buf[h] & 0x7C00) == 0x7C00 && (back.buf[h] & 0x3FF)
+            : back.buf[h] == h && f.buf[h] == array__f16_to_f32((uint16_t)h);
+    }
+    test_check(ok);
+    test_check(f.buf[0x3C00] == 1.0f && f.buf[0xC000] == -2.0f && f.buf[0x0001] == 0x1p-24f);
+
+    /* Rounding to half matches the scalar reference, including ties, subnormals and overflow */
+    array_clear_error(f);
+    f.size = 0;
+    float specials[] = { 65504.0f, 65520.0f, 1e10f, -1e10f, 0x1p-25f, 0x1.8p-24f, 1.0f + 0x1p-11f, 1.0f + 0x3p-11f, -0.0f };
+    for(size_t i = 0; i < sizeof(specials) / sizeof(specials[0]); ++i) {
+        array_add(float, f, specials[i]);
+    }
+    for(int i = 0; i < 10000; ++i) {
+        uint32_t bits = (uint32_t)test_rand(&state);
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        array_add(float, f, isnan(x) ? 0.0f : x);
+    }
+    array_convert_f32_f16(back, f);
+    ok = back.size == f.size;
+    for(uint64_t i = 0; i < f.size; ++i) {
+        ok &= back.buf[i] == array__f32_to_f16(f.buf[i]);
+    }
+    test_check(ok);
+    test_check(back.buf[0] == 0x7BFF && back.buf[1] == 0x7C00 && back.buf[3] == 0xFC00);
+
+    array_struct(double) d;
+    array_struct(float) f2;
+    array_init(double, d, 1);
+    array_init(float, f2, 1);
+    for(int i = 0; i < 1001; ++i) {
+        array_add(double, d, (double)(int64_t)test_rand(&state) / 3.0);
+    }
+    array_convert_f64_f32(f2, d);
+    ok = f2.size == d.size;
+    for(uint64_t i = 0; i < d.size; ++i) {
+        ok &= f2.buf[i] == (float)d.buf[i];
+    }
+    array_convert_f32_f64(d, f2);
+    for(uint64_t i = 0; i < d.size; ++i) {
+        ok &= d.buf[i] == (double)f2.buf[i];
+    }
+    test_check(ok);
+
+    array_struct(uint32_t) wide;
+    array_struct(uint16_t) narrow;
+    array_init(uint32_t, wide, 1);
+    array_init(uint16_t, narrow, 1);
+    for(int i = 0; i < 1001; ++i) {
+        array_add(uint32_t, wide, (uint32_t)test_rand(&state) >> (i % 20));
+    }
+    array_convert_u32_u16(narrow, wide, 1);
+    ok = narrow.size == wide.size;
+    for(uint64_t i = 0; i < wide.size; ++i) {
+        ok &= narrow.buf[i] == (wide.buf[i] > 0xFFFF ? 0xFFFF : wide.buf[i]);
+    }
+    array_convert_u32_u16(narrow, wide, 0);
+    for(uint64_t i = 0; i < wide.size; ++i) {
+        ok &= narrow.buf[i] == (uint16_t)wide.buf[i];
+    }
+    array_convert_u16_u32(wide, narrow);
+    for(uint64_t i = 0; i < wide.size; ++i) {
+        ok &= wide.buf[i] == narrow.buf[i];
+    }
+    test_check(ok);
+
+    array_struct(int8_t) q;
+    array_struct(float) dq;
+    array_init(int8_t, q, 1);
+    array_init(float, dq, 1);
+    f.size = 0;
+    for(int i = -1200; i <= 1200; ++i) {
+        array_add(float, f, i / 8.0f);
+    }
+    array_add(float, f, NAN);
+    for(int mode = ARRAY_ROUND_NEAREST; mode <= ARRAY_ROUND_ZERO; ++mode) {
+        array_quantize_f32_i8(q, f, 0.5f, mode);
+        ok = q.size == f.size;
+        for(uint64_t i = 0; i < f.size; ++i) {
+            ok &= q.buf[i] == expected_i8(f.buf[i], 0.5f, mode);
+        }
+        test_check(ok);
+    }
+    array_dequantize_i8_f32(dq, q, 0.25f);
+    ok = dq.size == q.size;
+    for(uint64_t i = 0; i < q.size; ++i) {
+        ok &= dq.buf[i] == q.buf[i] * 0.25f;
+    }
+    test_check(ok);
+
+    array_free(halves);
+    array_free(back);
+    array_free(f);
+    array_free(d);
+    array_free(f2);
+    array_free(wide);
+    array_free(narrow);
+    array_free(q);
+    array_free(dq);
+    return test_result();
+}
@@ -0,0 +1,172 @@
+#define ARRAY_DIFF_BLOCK_BYTES 64
+#include "array_diff.h"
+#include "array_aggregate.h"
+#include "test.h"
+
+typedef struct {
+    array_allocator base;
+    uint64_t live;
+} counting_allocator;
+
+static void* counting_resize(array_allocator* alloc, void* buf, uint64_t old_bytes, uint64_t new_bytes) {
+    counting_allocator* c = (counting_allocator*)alloc;
+    void* temp = realloc(buf, new_bytes);
+    if(temp) {
+        c->live += new_bytes - (buf ? old_bytes : 0);
+    }
+    return temp;
+}
+
+static void counting_release(array_allocator* alloc, void* buf, uint64_t bytes) {
+    ((counting_allocator*)alloc)->live -= bytes;
+    free(buf);
+}
+
+typedef array_struct(uint8_t) byte_array;
+
+static void put_varint(byte_array* patch, uint64_t x) {
+    for(; x >= 0x80; x >>= 7) {
+        array_add(uint8_t, (*patch), (uint8_t)(x | 0x80));
+    }
+    array_add(uint8_t, (*patch), (uint8_t)x);
+}
+
+/* A patch for 5 int32_t values that copies all of them count times */
+static void repeat_patch(byte_array* patch, uint64_t new_n, uint64_t hash, int count) {
+    patch->size = 0;
+    for(int i = 0; i < 4; ++i) {
+        array_add(uint8_t, (*patch), (uint8_t)"ADF1"[i]);
+    }
+    put_varint(patch, sizeof(int32_t));
+    put_varint(patch, 5);
+    put_varint(patch, new_n);
+    for(int i = 0; i < 8; ++i) {
+        array_add(uint8_t, (*patch), (uint8_t)(hash >> (8 * i)));
+    }
+    for(int i = 0; i < count; ++i) {
+        array_add(uint8_t, (*patch), ARRAY__DIFF_COPY);
+        put_varint(patch, 0);
+        put_varint(patch, 5);
+    }
+}
+
+int main(void) {
+    unsigned long long state = 11;
+    array_struct(int32_t) old, cur, replica;
+    byte_array patch;
+    array_init(int32_t, old, 1);
+    for(int i = 0; i < 5000; ++i) {
+        array_add(int32_t, old, (int32_t)test_rand(&state));
+    }
+    array_init(uint8_t, patch, 1);
+
+    for(int round = 0; round < 20; ++round) {
+        /* Edit a copy by changing values, inserting and removing elements and moving a block */
+        array_clone(int32_t, cur, old);
+        for(int e = 0; e < 5; ++e) {
+            uint64_t at = test_rand(&state) % cur.size;
+            int32_t v = (int32_t)test_rand(&state);
+            switch(test_rand(&state) % 3) {
+            case 0: array_set(cur, at, v); break;
+            case 1: array_add_index(int32_t, cur, at, v); break;
+            default: array_remove_index(int32_t, cur, at); break;
+            }
+        }
+        if(round % 4 == 0) {
+            int32_t block[300];
+            memcpy(block, cur.buf + 100, sizeof(block));
+            memmove(cur.buf + 100, cur.buf + 400, sizeof(int32_t) * (cur.size - 400));
+            memcpy(cur.buf + cur.size - 300, block, sizeof(block));
+        }
+        array_diff(old, cur, patch);
+        test_check(patch.error == ARRAY_OK_ERROR);
+        /* Small edits must not degrade to a full copy of the array */
+        test_check(patch.size < sizeof(int32_t) * cur.size / 4);
+        array_clone(int32_t, replica, old);
+        array_patch(replica, patch);
+        test_check(replica.error == ARRAY_OK_ERROR);
+        test_check(array_equal(replica, cur));
+        array_free(replica);
+        array_free(old);
+        old = cur;
+    }
+
+    /* A patch only applies to the contents it was made from */
+    array_clone(int32_t, cur, old);
+    cur.buf[7] ^= 1;
+    array_clone(int32_t, replica, old);
+    replica.buf[2000] ^= 1;
+    array_diff(old, cur, patch);
+    array_patch(replica, patch);
+    test_check(replica.error == ARRAY_INVALID_DATA);
+    test_check(replica.buf[7] == old.buf[7] && replica.buf[2000] != old.buf[2000]);
+    array_free(replica);
+
+    array_struct(int16_t) narrow;
+    array_init(int16_t, narrow, 1);
+    array_add(int16_t, narrow, 1);
+    array_patch(narrow, patch);
+    test_check(narrow.error == ARRAY_SIZE_MISMATCH);
+    array_free(narrow);
+
+    array_clone(int32_t, replica, old);
+    patch.buf[patch.size / 2] ^= 0x40;
+    array_patch(replica, patch);
+    test_check(replica.error == ARRAY_INVALID_DATA);
+    test_check(array_equal(replica, old));
+    array_free(replica);
+
+    /* Arrays on an allocator get the result copied into their block, hooks see it as one replacement */
+    counting_allocator alloc = { { counting_resize, counting_release }, 0 };
+    array_init(int32_t, replica, 1);
+    array_set_allocator(replica, &alloc.base);
+    for(uint64_t i = 0; i < old.size; ++i) {
+        array_add(int32_t, replica, old.buf[i]);
+    }
+    array_aggregate agg;
+    array_track_aggregate(replica, &agg);
+    array_diff(old, cur, patch);
+    array_patch(replica, patch);
+    test_check(replica.error == ARRAY_OK_ERROR);
+    test_check(array_equal(replica, cur));
+    double sum = 0;
+    double max = -INFINITY;
+    for(uint64_t i = 0; i < cur.size; ++i) {
+        sum += cur.buf[i];
+        max = cur.buf[i] > max ? cur.buf[i] : max;
+    }
+    test_check(array_aggregate_sum(&agg) == sum);
+    test_check(array_aggregate_max(&agg) == max);
+    test_check(array_aggregate_count(&agg) == cur.size);
+    array_untrack_aggregate(replica, &agg);
+    array_free(replica);
+    test_check(alloc.live == 0);
+
+    /* Copying the same old run twice is valid, a header claiming more than the operations make is not */
+    array_struct(int32_t) five, twice;
+    array_init(int32_t, five, 5);
+    array_init(int32_t, twice, 10);
+    for(int32_t i = 0; i < 10; ++i) {
+        if(i < 5) {
+            array_add(int32_t, five, i * 3);
+        }
+        array_add(int32_t, twice, i % 5 * 3);
+    }
+    repeat_patch(&patch, 10, array_hash(twice), 2);
+    array_clone(int32_t, replica, five);
+    array_patch(replica, patch);
+    test_check(replica.error == ARRAY_OK_ERROR && array_equal(replica, twice));
+    array_free(replica);
+    repeat_patch(&patch, 1ull << 48, array_hash(twice), 2);
+    array_clone(int32_t, replica, five);
+    array_patch(replica, patch);
+    test_check(replica.error == ARRAY_INVALID_DATA && array_equal(replica, five));
+    array_free(replica);
+    array_free(five);
+    array_free(twice);
+
+    array_free(old);
+    array_free(cur);
+    array_free(patch);
+    return test_result();
+}
@@ -0,0 +1,75 @@
+#include "array_dirty.h"
+#include "test.h"
+
+#define CHUNK 16
+
+/* Checks that the runs cover exactly the elements of the expected chunks, with adjacent chunks merged */
+static int runs_match(const array_dirty* dirty, const unsigned char* expected, uint64_t size) {
+    unsigned char* seen = calloc(size + 1, 1);
+    uint64_t prev_end = 0;
+    int ok = 1;
+    for(uint64_t begin, end, at = 0; array_dirty_next(dirty, at, &begin, &end); at = end) {
+        ok &= begin < end && end <= size && (at == 0 || begin > prev_end);
+        memset(seen + begin, 1, end - begin);
+        prev_end = end;
+    }
+    for(uint64_t i = 0; i < size; ++i) {
+        ok &= seen[i] == expected[i / CHUNK];
+    }
+    free(seen);
+    return ok;
+}
+
+int main(void) {
+    unsigned long long state = 13;
+    array_struct(int) a;
+    array_init(int, a, 1);
+    for(int i = 0; i < 10000; ++i) {
+        array_add(int, a, i);
+    }
+    array_dirty dirty;
+    array_track_dirty(a, &dirty, 10);
+    unsigned char expected[20000 / CHUNK + 1] = { 0 };
+    uint64_t begin, end;
+    test_check(!array_dirty_next(&dirty, 0, &begin, &end));
+
+    for(int i = 0; i < 200; ++i) {
+        uint64_t at = test_rand(&state) % a.size;
+        array_set(a, at, -1);
+        expected[at / CHUNK] = 1;
+    }
+    test_check(runs_match(&dirty, expected, a.size));
+
+    /* Writes through buf are only seen once marked by hand */
+    a.buf[9999] = 0;
+    array_dirty_mark(&dirty, 9999, 10000);
+    expected[9999 / CHUNK] = 1;
+    test_check(runs_match(&dirty, expected, a.size));
+
+    /* Appending marks the new tail, enumeration starting mid run is clipped to the start */
+    array_dirty_clear(&dirty);
+    memset(expected, 0, sizeof(expected));
+    test_check(!array_dirty_next(&dirty, 0, &begin, &end));
+    for(int i = 0; i < 100; ++i) {
+        array_add(int, a, i);
+    }
+    for(uint64_t i = 10000; i < 10100; ++i) {
+        expected[i / CHUNK] = 1;
+    }
+    test_check(runs_match(&dirty, expected, a.size));
+    test_check(array_dirty_next(&dirty, 10050, &begin, &end) && begin == 10050 && end == 10100);
+
+    /* Removing from the tail shrinks what can be reported */
+    array_remove(int, a);
+    test_check(array_dirty_next(&dirty, 0, &begin, &end) && end == a.size);
+
+    array_dirty_clear(&dirty);
+    array_dirty_mark_all(&dirty);
+    test_check(array_dirty_next(&dirty, 0, &begin, &end) && begin == 0 && end == a.size);
+    test_check(!array_dirty_next(&dirty, end, &begin, &end));
+
+    array_untrack_dirty(a, &dirty);
+    test_check(a.hooks == NULL);
+    array_free(a);
+    return test_result();
+}
@@ -0,0 +1,79 @@
+/* Small thresholds so modest arrays take the threaded and non-temporal paths */
+#define ARRAY_PARALLEL_THRESHOLD 4096
+#define ARRAY_NONTEMPORAL_THRESHOLD 65536
+#define ARRAY_THREADS 4
+
+#include "array.h"
+#include "test.h"
+
+typedef struct {
+    int32_t a;
+    int32_t b;
+    int32_t c;
+} triple;
+
+int main(void) {
+    array_struct(triple) t;
+    array_init(triple, t, 1);
+    triple v = { 1, -2, 3 };
+    array_fill(triple, t, 100003, v);
+    test_check(t.error == ARRAY_OK_ERROR);
+    test_check(t.size == 100003);
+    int same = 1;
+    array_foreach(triple, x, t) {
+        same &= x.a == 1 && x.b == -2 && x.c == 3;
+    }
+    test_check(same);
+    array_fill(triple, t, 0, v);
+    test_check(t.size == 0);
+    array_free(t);
+
+    uint64_t sizes[] = { 1, 7, 4095, 4097, 65536, 300001 };
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        array_struct(char) c;
+        array_init(char, c, 1);
+        array_fill(char, c, sizes[s], 'x');
+        test_check(c.size == sizes[s]);
+        test_check(c.buf[0] == 'x' && c.buf[c.size - 1] == 'x' && memchr(c.buf, 0, c.size) == NULL);
+        array_free(c);
+    }
+
+    array_struct(uint64_t) a, b, d;
+    array_init(uint64_t, a, 1);
+    for(uint64_t i = 0; i < 200000; ++i) {
+        array_add(uint64_t, a, i * 2654435761u);
+    }
+    array_init(uint64_t, b, 1);
+    array_add(uint64_t, b, 42);
+    array_copy(uint64_t, b, a);
+    test_check(b.error == ARRAY_OK_ERROR);
+    test_check(array_equal(a, b));
+    array_clone(uint64_t, d, a);
+    test_check(d.error == ARRAY_OK_ERROR);
+    test_check(d.capacity == a.size);
+    test_check(array_equal(a, d));
+    array_copy(uint64_t, b, b);
+    test_check(array_equal(a, b));
+
+    /* A clone of a small array keeps the minimum capacity its shrinks rely on */
+    array_struct(uint64_t) small, f;
+    array_init(uint64_t, small, 64);
+    array_add(uint64_t, small, 1);
+    array_add(uint64_t, small, 2);
+    array_clone(uint64_t, f, small);
+    test_check(f.error == ARRAY_OK_ERROR && f.size == 2 && f.capacity == 64 && f.min_capacity == 64);
+    array_remove(uint64_t, f);
+    array_remove(uint64_t, f);
+    test_check(f.error == ARRAY_OK_ERROR && f.size == 0 && f.capacity >= f.min_capacity);
+    array_free(small);
+    array_free(f);
+
+    a.error = ARRAY_OUT_OF_MEM;
+    array_struct(uint64_t) e;
+    array_clone(uint64_t, e, a);
+    test_check(e.error == ARRAY_OUT_OF_MEM && e.buf == NULL);
+    array_free(a);
+    array_free(b);
+    array_free(d);
+    return test_result();
+}
@@ -0,0 +1,116 @@
+#include <string.h>
+#include "array.h"
+#include "test.h"
+
+int main(void) {
+    array_struct(int) a, b, c;
+    array_init(int, a, 1);
+    array_init(int, b, 1);
+    array_init(int, c, 1);
+    for(int i = 0; i < 100; ++i) {
+        array_add(int, a, i);
+        array_add(int, b, 2 * i);
+        array_add(int, c, 0);
+    }
+
+    long sum = 0;
+    array_foreach(int, x, a) {
+        sum += x;
+    }
+    test_check(sum == 4950);
+
+    array_foreach_ptr(int, p, a) {
+        *p += 1;
+    }
+    test_check(a.buf[0] == 1 && a.buf[99] == 100);
+
+    int expected = 100;
+    int ordered = 1;
+    array_foreach_reverse(int, x, a) {
+        ordered &= x == expected--;
+    }
+    test_check(ordered && expected == 0);
+
+    int* last = NULL;
+    array_foreach_ptr_reverse(int, p, a) {
+        last = p;
+    }
+    test_check(last == a.buf);
+
+    array_foreach_zip3(i, a, b, c) {
+        c.buf[i] = a.buf[i] + b.buf[i];
+    }
+    test_check(c.buf[10] == 11 + 20);
+
+    /* Mismatched sizes run no iteration and flag every array */
+    array_add(int, c, 7);
+    int visited = 0;
+    array_foreach_zip(i, a, c) {
+        ++visited;
+    }
+    test_check(visited == 0);
+    test_check(a.error == ARRAY_SIZE_MISMATCH && c.error == ARRAY_SIZE_MISMATCH);
+    test_check(b.error == ARRAY_OK_ERROR);
+
+    /* Arrays in an error state are not iterated */
+    array_foreach(int, x, a) {
+        (void)x;
+        ++visited;
+    }
+    test_check(visited == 0);
+
+    array_struct(int) empty;
+    array_init(int, empty, 1);
+    array_foreach_reverse(int, x, empty) {
+        (void)x;
+        ++visited;
+    }
+    test_check(visited == 0);
+
+    /* Pointer element types, with break and continue leaving or skipping as in a plain for */
+    array_struct(const char*) words;
+    array_init(const char*, words, 1);
+    array_add(const char*, words, "one");
+    array_add(const char*, words, "two");
+    array_add(const char*, words, "three");
+    array_add(const char*, words, "four");
+    size_t letters = 0;
+    array_foreach(const char*, w, words) {
+        if(w[0] == 't' && w[1] == 'w') {
+            continue;
+        }
+        if(strcmp(w, "four") == 0) {
+            break;
+        }
+        letters += strlen(w);
+    }
+    test_check(letters == 8);
+    const char** found = NULL;
+    array_foreach_ptr(const char*, w, words) {
+        if(strcmp(*w, "three") == 0) {
+            found = w;
+            break;
+        }
+    }
+    test_check(found == words.buf + 2);
+    const char* first = NULL;
+    array_foreach_reverse(const char*, w, words) {
+        first = w;
+    }
+    test_check(first == words.buf[0]);
+    int from_tail = 0;
+    array_foreach_ptr_reverse(const char*, w, words) {
+        ++from_tail;
+        if(*w == words.buf[2]) {
+            break;
+        }
+    }
+    test_check(from_tail == 2);
+
+    array_free(a);
+    array_free(b);
+    array_free(c);
+    array_free(empty);
+    array_free(words);
+    return test_result();
+}
@@ -0,0 +1,54 @@
+#include "array.h"
+#include "test.h"
+
+int main(void) {
+    array_struct(int64_t) a;
+    array_init(int64_t, a, 1);
+    for(int64_t i = 0; i < 1000; ++i) {
+        array_add(int64_t, a, i * 3);
+    }
+
+    unsigned long long state = 1;
+    uint64_t idx[500];
+    int64_t out[500];
+    int64_t values[500];
+    for(int i = 0; i < 500; ++i) {
+        idx[i] = test_rand(&state) % a.size;
+    }
+    array_gather(a, idx, 500, out);
+    test_check(a.error == ARRAY_OK_ERROR);
+    int same = 1;
+    for(int i = 0; i < 500; ++i) {
+        same &= out[i] == (int64_t)idx[i] * 3;
+    }
+    test_check(same);
+
+    /* Duplicate indices keep the last value written */
+    for(int i = 0; i < 500; ++i) {
+        idx[i] = i % 250;
+        values[i] = -i;
+    }
+    array_scatter(a, idx, values, 500);
+    test_check(a.error == ARRAY_OK_ERROR);
+    same = 1;
+    for(int i = 0; i < 250; ++i) {
+        same &= a.buf[i] == -(i + 250);
+    }
+    test_check(same);
+    test_check(a.buf[250] == 750);
+
+    /* A bad index anywhere rejects the whole batch before any write */
+    idx[0] = 0;
+    values[0] = 12345;
+    idx[300] = a.size;
+    test_check(array_check_indices(a, idx, 500) == 300);
+    array_scatter(a, idx, values, 500);
+    test_check(a.error == ARRAY_OUT_OF_BOUNDS);
+    test_check(a.buf[0] == -250);
+    array_clear_error(a);
+    array_gather(a, idx, 500, out);
+    test_check(a.error == ARRAY_OUT_OF_BOUNDS);
+
+    array_free(a);
+    return test_result();
+}
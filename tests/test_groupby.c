@@ -0,0 +1,88 @@
+/* A small threshold so the records are pre-aggregated on several threads and merged */
+#define ARRAY_PARALLEL_THRESHOLD 4096
+#define ARRAY_THREADS 4
+
+#include "array_groupby.h"
+#include "test.h"
+
+typedef struct {
+    uint64_t user;
+    double ms;
+} event;
+
+static uint64_t user_of(const void* rec) {
+    return ((const event*)rec)->user;
+}
+
+static double ms_of(const void* rec) {
+    return ((const event*)rec)->ms;
+}
+
+int main(void) {
+    unsigned long long state = 31;
+    array_struct(event) events;
+    array_init(event, events, 1);
+    for(int i = 0; i < 50000; ++i) {
+        uint64_t user = test_rand(&state) % 3000;
+        array_add(event, events, ((event){ user == 7 ? UINT64_MAX : user, (double)(test_rand(&state) % 10000) - 5000 }));
+    }
+
+    array_agg_spec specs[] = { { ARRAY_AGG_COUNT, NULL }, { ARRAY_AGG_SUM, ms_of }, { ARRAY_AGG_MIN, ms_of }, { ARRAY_AGG_MAX, ms_of } };
+    array_struct(uint64_t) users;
+    array_struct(double) stats;
+    array_init(uint64_t, users, 1);
+    array_init(double, stats, 1);
+    array_groupby(events, user_of, specs, 4, users, stats);
+    test_check(users.error == ARRAY_OK_ERROR && stats.error == ARRAY_OK_ERROR);
+    test_check(stats.size == users.size * 4);
+
+    /* Keys come out in order of first appearance, each row matches a scan over its records */
+    uint64_t next = 0;
+    int ok = 1;
+    for(uint64_t g = 0; g < users.size; ++g) {
+        while(next < events.size) {
+            int seen = 0;
+            for(uint64_t h = 0; h < g && !seen; ++h) {
+                seen = users.buf[h] == events.buf[next].user;
+            }
+            if(!seen) {
+                break;
+            }
+            ++next;
+        }
+        ok &= next < events.size && users.buf[g] == events.buf[next].user;
+        double count = 0, sum = 0, min = INFINITY, max = -INFINITY;
+        array_foreach(event, e, events) {
+            if(e.user == users.buf[g]) {
+                ++count;
+                sum += e.ms;
+                min = e.ms < min ? e.ms : min;
+                max = e.ms > max ? e.ms : max;
+            }
+        }
+        const double* row = stats.buf + g * 4;
+        ok &= row[0] == count && row[1] == sum && row[2] == min && row[3] == max;
+    }
+    test_check(ok);
+    uint64_t total = 0;
+    for(uint64_t g = 0; g < users.size; ++g) {
+        total += (uint64_t)stats.buf[g * 4];
+    }
+    test_check(total == events.size);
+
+    /* An empty input replaces the outputs with no groups */
+    events.size = 0;
+    array_groupby(events, user_of, specs, 4, users, stats);
+    test_check(users.error == ARRAY_OK_ERROR && users.size == 0 && stats.size == 0);
+
+    /* An output in an error state stops the call and leaves the other output alone */
+    events.size = 10;
+    stats.error = ARRAY_OUT_OF_MEM;
+    array_groupby(events, user_of, specs, 4, users, stats);
+    test_check(users.size == 0 && users.error == ARRAY_OK_ERROR);
+
+    array_free(events);
+    array_free(users);
+    array_free(stats);
+    return test_result();
+}
@@ -0,0 +1,72 @@
+#include "array.h"
+#include "test.h"
+
+/* Heap allocator that refuses blocks above a limit, standing in for memory pressure */
+typedef struct {
+    array_allocator base;
+    uint64_t max_bytes;
+    uint64_t refused;
+} limited_allocator;
+
+static void* limited_resize(array_allocator* alloc, void* buf, uint64_t old_bytes, uint64_t new_bytes) {
+    (void)old_bytes;
+    limited_allocator* l = (limited_allocator*)alloc;
+    if(new_bytes > l->max_bytes) {
+        ++l->refused;
+        return NULL;
+    }
+    return realloc(buf, new_bytes);
+}
+
+static void limited_release(array_allocator* alloc, void* buf, uint64_t bytes) {
+    (void)alloc;
+    (void)bytes;
+    free(buf);
+}
+
+int main(void) {
+    limited_allocator alloc = { { limited_resize, limited_release }, sizeof(int) * 1000, 0 };
+    array_struct(int) a;
+    array_init(int, a, 1);
+    array_set_allocator(a, &alloc.base);
+    for(int i = 0; i < 640; ++i) {
+        array_add(int, a, i);
+    }
+    test_check(a.error == ARRAY_OK_ERROR && a.capacity >= 640 && a.capacity < 1024);
+
+    /* Doubling to 1280 is refused, the growth retries with smaller steps and still fits */
+    uint64_t refused = alloc.refused;
+    for(int i = 640; i < 1000; ++i) {
+        array_add(int, a, i);
+    }
+    test_check(a.error == ARRAY_OK_ERROR && a.size == 1000);
+    test_check(alloc.refused > refused);
+    test_check(a.capacity <= 1000);
+
+    /* Past the limit the add fails and the array keeps its values and capacity */
+    uint64_t capacity = a.capacity;
+    array_add(int, a, 1000);
+    test_check(a.error == ARRAY_OUT_OF_MEM);
+    test_check(a.size == 1000 && a.capacity == capacity && a.buf[999] == 999);
+    array_add(int, a, 1001);
+    test_check(a.size == 1000);
+
+    /* Once memory is available again the array recovers */
+    alloc.max_bytes = sizeof(int) * 4096;
+    array_clear_error(a);
+    array_add_index(int, a, 0, -1);
+    test_check(a.error == ARRAY_OK_ERROR && a.size == 1001 && a.buf[0] == -1 && a.buf[1000] == 999);
+
+    /* A refused shrink keeps the larger buffer and is not an error */
+    alloc.max_bytes = 0;
+    while(a.size > 10) {
+        array_remove(int, a);
+    }
+    test_check(a.error == ARRAY_OK_ERROR && a.size == 10);
+    test_check(a.buf[9] == 8);
+    array_remove_index(int, a, 0);
+    test_check(a.error == ARRAY_OK_ERROR && a.buf[0] == 0);
+
+    array_free(a);
+    return test_result();
+}
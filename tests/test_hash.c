@@ -0,0 +1,68 @@
+#include "array_hash.h"
+#include "test.h"
+
+int main(void) {
+    array_struct(char) s;
+    array_init(char, s, 1);
+    test_check(array_hash(s) == 0xEF46DB3751D8E999ull);
+    test_check(array_crc32c(s) == 0);
+    array_add(char, s, 'a');
+    test_check(array_hash(s) == 0xD24EC4F1A98C6E5Bull);
+    array_add(char, s, 'b');
+    array_add(char, s, 'c');
+    test_check(array_hash(s) == 0x44BC2CF5AD770999ull);
+
+    s.size = 0;
+    for(int i = 1; i <= 9; ++i) {
+        array_add(char, s, (char)('0' + i));
+    }
+    test_check(array_crc32c(s) == 0xE3069283u);
+    test_check(array_crc32c_update(array_crc32c_update(0, "1234", 4), "56789", 5) == 0xE3069283u);
+
+    /* Inputs of 32 bytes and more take the four lane path of XXH64 */
+    array_struct(unsigned char) b;
+    array_init(unsigned char, b, 1);
+    for(int i = 0; i < 100; ++i) {
+        array_add(unsigned char, b, (unsigned char)(i * 7 + 3));
+    }
+    test_check(array_hash(b) == 0xA61F8D4C170FE531ull);
+    test_check(array_hash_seed(b, 42) == 0x7DD00BE8513C25A2ull);
+    b.size = 37;
+    test_check(array_hash(b) == 0xE32EF63802F5A3FDull);
+
+    /* The instruction path matches the table path at every length and alignment */
+    unsigned long long state = 5;
+    b.size = 0;
+    for(int i = 0; i < 4096; ++i) {
+        array_add(unsigned char, b, (unsigned char)test_rand(&state));
+    }
+    int same = 1;
+    for(uint64_t off = 0; off < 8; ++off) {
+        for(uint64_t len = 0; len + off <= b.size; len += 1 + len / 3) {
+            same &= array_crc32c_update(0, b.buf + off, len) == ~array__crc32c_sw(~0u, b.buf + off, len);
+        }
+    }
+    test_check(same);
+
+    array_struct(unsigned char) c;
+    array_clone(unsigned char, c, b);
+    test_check(array_equal(c, b));
+    test_check(array_hash(c) == array_hash(b));
+    int order;
+    array_compare(c, b, order);
+    test_check(order == 0);
+    c.buf[1000] ^= 1;
+    test_check(!array_equal(c, b));
+    test_check(array_hash(c) != array_hash(b));
+    array_compare(c, b, order);
+    test_check(order == (c.buf[1000] < b.buf[1000] ? -1 : 1));
+    c.buf[1000] ^= 1;
+    c.size -= 1;
+    array_compare(c, b, order);
+    test_check(order == -1);
+
+    array_free(s);
+    array_free(b);
+    array_free(c);
+    return test_result();
+}
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <sys/wait.h>
+#include "array_io.h"
+#include "test.h"
+
+#define PARTS 3000
+
+static unsigned char pattern(uint64_t i) {
+    return (unsigned char)(i * 31 + (i >> 8));
+}
+
+int main(void) {
+    char path[] = "/tmp/array-test-io-XXXXXX";
+    int fd = mkstemp(path);
+    test_check(fd >= 0);
+
+    array_struct(int) src;
+    array_init(int, src, 1);
+    for(int i = 0; i < 100000; ++i) {
+        array_add(int, src, i * 3 - 7);
+    }
+    struct iovec whole[] = { array_iov(src) };
+    test_check(array_writev(fd, whole, 1) == ARRAY_OK_ERROR);
+
+    /* The file is appended after existing values, growing the capacity once to exactly fit */
+    array_struct(int) a;
+    array_init(int, a, 1);
+    array_add(int, a, 42);
+    array_read_file(a, path);
+    test_check(a.error == ARRAY_OK_ERROR && a.size == 100001 && a.capacity == 100001);
+    test_check(a.buf[0] == 42 && memcmp(a.buf + 1, src.buf, sizeof(int) * src.size) == 0);
+
+    /* Reads start at the current position and stop at max */
+    test_check(lseek(fd, sizeof(int) * 10, SEEK_SET) == sizeof(int) * 10);
+    a.size = 0;
+    array_read_fd(a, fd, sizeof(int) * 5);
+    test_check(a.error == ARRAY_OK_ERROR && a.size == 5 && a.buf[0] == src.buf[10] && a.buf[4] == src.buf[14]);
+    array_read_fd(a, fd, UINT64_MAX);
+    test_check(a.error == ARRAY_OK_ERROR && a.size == 100000 - 10);
+    test_check(memcmp(a.buf, src.buf + 10, sizeof(int) * a.size) == 0);
+
+    /* Data ending inside a value keeps the whole values */
+    test_check(ftruncate(fd, 10) == 0);
+    a.size = 0;
+    array_read_file(a, path);
+    test_check(a.error == ARRAY_SIZE_MISMATCH && a.size == 2 && a.buf[1] == src.buf[1]);
+    array_clear_error(a);
+    close(fd);
+    unlink(path);
+    array_read_file(a, path);
+    test_check(a.error == ARRAY_IO_ERROR && a.size == 2);
+    array_clear_error(a);
+
+    /* More buffers than one writev takes, into a pipe that only holds part of them at a time */
+    array_struct(unsigned char) bytes;
+    array_init(unsigned char, bytes, 1);
+    struct iovec parts[PARTS];
+    uint64_t total = 0;
+    for(int i = 0; i < PARTS; ++i) {
+        parts[i].iov_len = (size_t)(i % 7 == 0 ? 0 : i % 700);
+        total += parts[i].iov_len;
+    }
+    array_fill(unsigned char, bytes, total, 0);
+    for(uint64_t i = 0; i < total; ++i) {
+        bytes.buf[i] = pattern(i);
+    }
+    for(int i = 0, at = 0; i < PARTS; at += (int)parts[i].iov_len, ++i) {
+        parts[i].iov_base = bytes.buf + at;
+    }
+    struct iovec first = parts[0];
+    int fds[2];
+    test_check(pipe(fds) == 0);
+    pid_t child = fork();
+    if(child == 0) {
+        close(fds[1]);
+        array_struct(unsigned char) got;
+        array_init(unsigned char, got, 16);
+        array_read_fd(got, fds[0], UINT64_MAX);
+        int ok = got.error == ARRAY_OK_ERROR && got.size == total;
+        for(uint64_t i = 0; ok && i < got.size; ++i) {
+            ok = got.buf[i] == pattern(i);
+        }
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[0]);
+    test_check(array_writev(fds[1], parts, PARTS) == ARRAY_OK_ERROR);
+    test_check(parts[0].iov_base == first.iov_base && parts[0].iov_len == first.iov_len);
+    close(fds[1]);
+    int status = 0;
+    test_check(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    test_check(array_writev(-1, parts, PARTS) == ARRAY_IO_ERROR);
+
+    array_free(bytes);
+    array_free(a);
+    array_free(src);
+    return test_result();
+}
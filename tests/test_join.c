@@ -0,0 +1,148 @@
+/* Small limits so larger inputs take the partitioned path on several threads */
+#define ARRAY_PARALLEL_THRESHOLD 4096
+#define ARRAY_THREADS 4
+#define ARRAY_JOIN_CACHE_BYTES 4096
+
+#include "array_join.h"
+#include "test.h"
+
+typedef struct {
+    uint64_t id;
+    int payload;
+} request;
+
+typedef struct {
+    int status;
+    uint64_t request_id;
+} response;
+
+static uint64_t request_id_of(const void* rec) {
+    return ((const request*)rec)->id;
+}
+
+static uint64_t response_id_of(const void* rec) {
+    return ((const response*)rec)->request_id;
+}
+
+/* Heap allocator that refuses blocks above a limit, standing in for memory pressure */
+typedef struct {
+    array_allocator base;
+    uint64_t max_bytes;
+    uint64_t refused;
+} limited_allocator;
+
+static void* limited_resize(array_allocator* alloc, void* buf, uint64_t old_bytes, uint64_t new_bytes) {
+    (void)old_bytes;
+    limited_allocator* l = (limited_allocator*)alloc;
+    if(new_bytes > l->max_bytes) {
+        ++l->refused;
+        return NULL;
+    }
+    return realloc(buf, new_bytes);
+}
+
+static void limited_release(array_allocator* alloc, void* buf, uint64_t bytes) {
+    (void)alloc;
+    (void)bytes;
+    free(buf);
+}
+
+static int pair_cmp(const void* a, const void* b) {
+    const uint64_t* x = a;
+    const uint64_t* y = b;
+    return x[0] != y[0] ? (x[0] > y[0]) - (x[0] < y[0]) : (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+/* Compares the pairs found with the pairs of a nested loop, both sorted */
+static int join_matches(const request* left, uint64_t left_n, const response* right, uint64_t right_n,
+        const uint64_t* left_idx, const uint64_t* right_idx, uint64_t n) {
+    uint64_t expected_n = 0;
+    uint64_t* expected = malloc(sizeof(uint64_t) * 2 * (left_n * right_n + 1));
+    for(uint64_t l = 0; l < left_n; ++l) {
+        for(uint64_t r = 0; r < right_n; ++r) {
+            if(left[l].id == right[r].request_id) {
+                expected[expected_n * 2] = l;
+                expected[expected_n * 2 + 1] = r;
+                ++expected_n;
+            }
+        }
+    }
+    uint64_t* actual = malloc(sizeof(uint64_t) * 2 * (n + 1));
+    for(uint64_t i = 0; i < n; ++i) {
+        actual[i * 2] = left_idx[i];
+        actual[i * 2 + 1] = right_idx[i];
+    }
+    qsort(expected, expected_n, sizeof(uint64_t) * 2, pair_cmp);
+    qsort(actual, n, sizeof(uint64_t) * 2, pair_cmp);
+    int ok = expected_n == n && memcmp(expected, actual, sizeof(uint64_t) * 2 * n) == 0;
+    free(expected);
+    free(actual);
+    return ok;
+}
+
+int main(void) {
+    unsigned long long state = 37;
+    uint64_t sizes[][2] = { { 0, 10 }, { 20, 30 }, { 3000, 5000 }, { 5000, 700 } };
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        array_struct(request) requests;
+        array_struct(response) responses;
+        array_init(request, requests, 1);
+        array_init(response, responses, 1);
+        uint64_t keys = sizes[s][0] / 2 + 5;
+        for(uint64_t i = 0; i < sizes[s][0]; ++i) {
+            array_add(request, requests, ((request){ test_rand(&state) % keys, (int)i }));
+        }
+        for(uint64_t i = 0; i < sizes[s][1]; ++i) {
+            array_add(response, responses, ((response){ 200, test_rand(&state) % keys }));
+        }
+        array_struct(uint64_t) req_idx, resp_idx;
+        array_init(uint64_t, req_idx, 1);
+        array_init(uint64_t, resp_idx, 1);
+        array_add(uint64_t, req_idx, 99);
+        array_join(requests, request_id_of, responses, response_id_of, req_idx, resp_idx);
+        test_check(req_idx.error == ARRAY_OK_ERROR && resp_idx.error == ARRAY_OK_ERROR);
+        test_check(req_idx.size == resp_idx.size);
+        test_check(join_matches(requests.buf, requests.size, responses.buf, responses.size,
+            req_idx.buf, resp_idx.buf, req_idx.size));
+        array_free(requests);
+        array_free(responses);
+        array_free(req_idx);
+        array_free(resp_idx);
+    }
+
+    /* A partition that cannot grow fails the whole join instead of dropping its pairs */
+    array_struct(request) requests;
+    array_struct(response) responses;
+    array_init(request, requests, 1);
+    array_init(response, responses, 1);
+    for(uint64_t i = 0; i < 5000; ++i) {
+        array_add(request, requests, ((request){ i, (int)i }));
+    }
+    for(uint64_t i = 0; i < 700; ++i) {
+        array_add(response, responses, ((response){ 200, i % 100 == 0 ? i : 100000 + i }));
+    }
+    uint64_t limits[] = { 1ull << 30, 4096 };
+    for(size_t l = 0; l < sizeof(limits) / sizeof(limits[0]); ++l) {
+        limited_allocator alloc = { { limited_resize, limited_release }, limits[l], 0 };
+        array_struct(uint64_t) req_idx, resp_idx;
+        array_init(uint64_t, req_idx, 1);
+        array_init(uint64_t, resp_idx, 1);
+        array_set_allocator(req_idx, &alloc.base);
+        array_join(requests, request_id_of, responses, response_id_of, req_idx, resp_idx);
+        if(l == 0) {
+            test_check(req_idx.error == ARRAY_OK_ERROR && alloc.refused == 0);
+            test_check(join_matches(requests.buf, requests.size, responses.buf, responses.size,
+                req_idx.buf, resp_idx.buf, req_idx.size));
+        }
+        else {
+            test_check(alloc.refused > 0);
+            test_check(req_idx.error == ARRAY_OUT_OF_MEM && resp_idx.error == ARRAY_OUT_OF_MEM);
+            test_check(req_idx.size == 0 && resp_idx.size == 0);
+        }
+        array_free(req_idx);
+        array_free(resp_idx);
+    }
+    array_free(requests);
+    array_free(responses);
+    return test_result();
+}
@@ -0,0 +1,172 @@
+#define ARRAY_PARALLEL_THRESHOLD 4096
+#define ARRAY_THREADS 4
+#include <inttypes.h>
+#include "array_parse.h"
+#include "array_string.h"
+#include "test.h"
+
+#define ROWS 20000
+#define COLUMNS 5
+
+typedef array_struct(char) text_array;
+
+static void set_text(text_array* text, const char* s) {
+    text->size = 0;
+    array_str_append_cstr((*text), s);
+}
+
+/* Field separator, surrounding spaces and line endings vary from row to row */
+static void end_field(text_array* text, unsigned long long* state, int column) {
+    if(test_rand(state) % 4 == 0) {
+        array_str_append_cstr((*text), " ");
+    }
+    if(column + 1 < COLUMNS) {
+        array_str_append_cstr((*text), ",");
+        if(test_rand(state) % 4 == 0) {
+            array_str_append_cstr((*text), "\t");
+        }
+        return;
+    }
+    array_str_append_cstr((*text), test_rand(state) % 2 ? "\r\n" : "\n");
+    switch(test_rand(state) % 16) {
+    case 0:
+        array_str_append_cstr((*text), "\n");
+        break;
+    case 1:
+        array_str_append_cstr((*text), "  \t\r\n");
+        break;
+    }
+}
+
+static double random_double(unsigned long long* state, char* field, size_t max) {
+    uint64_t bits = test_rand(state) << 33 ^ test_rand(state);
+    double x = (double)(int64_t)(bits % 2000000001) - 1e9;
+    switch(test_rand(state) % 6) {
+    case 0:
+        snprintf(field, max, "%.17g", x / 7);
+        break;
+    case 1:
+        snprintf(field, max, "%g", x * 1e-300);
+        break;
+    case 2:
+        snprintf(field, max, "%.3f", x / 1000);
+        break;
+    case 3:
+        snprintf(field, max, "%.3E", x * 1e200);
+        break;
+    case 4:
+        /* Longer than the stack copy, so strtod gets an allocated one */
+        snprintf(field, max, "%.150f", x / 3e9);
+        break;
+    default:
+        snprintf(field, max, "%.0f", x);
+        break;
+    }
+    return strtod(field, NULL);
+}
+
+int main(void) {
+    text_array text;
+    array_struct(int64_t) ints;
+    array_struct(double) doubles;
+    array_struct(uint64_t) ends;
+    array_init(char, text, 64);
+    array_init(int64_t, ints, 1);
+    array_init(double, doubles, 1);
+    array_init(uint64_t, ends, 1);
+
+    set_text(&text, "1,22\n333\n");
+    array_parse_offsets(text, ',', ends);
+    test_check(ends.error == ARRAY_OK_ERROR && ends.size == 3 && ends.buf[0] == 1 && ends.buf[1] == 4 && ends.buf[2] == 8);
+
+    set_text(&text, "\n1,2,3\r\n-4, 5 ,6\n\n  \t\r\n7,8,9");
+    array_parse_int64(text, ',', ints);
+    test_check(ints.error == ARRAY_OK_ERROR && ints.size == 9);
+    int64_t expect[] = { 1, 2, 3, -4, 5, 6, 7, 8, 9 };
+    test_check(ints.size == 9 && memcmp(ints.buf, expect, sizeof(expect)) == 0);
+
+    set_text(&text, "9223372036854775807\t-9223372036854775808\n");
+    array_parse_int64(text, '\t', ints);
+    test_check(ints.error == ARRAY_OK_ERROR && ints.size == 2 && ints.buf[0] == INT64_MAX && ints.buf[1] == INT64_MIN);
+
+    set_text(&text, "0.1;-2.5e-3;  1e400 ;+7.;.5\r\n");
+    array_parse_double(text, ';', doubles);
+    test_check(doubles.error == ARRAY_OK_ERROR && doubles.size == 5);
+    test_check(doubles.buf[0] == 0.1 && doubles.buf[1] == -2.5e-3 && doubles.buf[2] == HUGE_VAL);
+    test_check(doubles.buf[3] == 7.0 && doubles.buf[4] == 0.5);
+
+    /* A field that is not a number leaves the output empty with its error set */
+    const char* bad_ints[] = { "1,x,3\n", "1,,3\n", "9223372036854775808\n", "1 2\n", "1,-\n" };
+    for(unsigned i = 0; i < sizeof(bad_ints) / sizeof(*bad_ints); ++i) {
+        set_text(&text, bad_ints[i]);
+        array_parse_int64(text, ',', ints);
+        test_check(ints.error == ARRAY_INVALID_DATA && ints.size == 0);
+        array_clear_error(ints);
+    }
+    set_text(&text, "1.5,e5,3\n");
+    array_parse_double(text, ',', doubles);
+    test_check(doubles.error == ARRAY_INVALID_DATA && doubles.size == 0);
+    /* Nothing runs while the output holds an error */
+    set_text(&text, "1,2\n");
+    array_parse_double(text, ',', doubles);
+    test_check(doubles.error == ARRAY_INVALID_DATA && doubles.size == 0);
+    array_clear_error(doubles);
+
+    /* Enough text for every thread to take a chunk, checked against strtoll and strtod */
+    unsigned long long state = 7;
+    array_struct(int64_t) want_ints;
+    array_init(int64_t, want_ints, ROWS * COLUMNS);
+    text.size = 0;
+    for(int r = 0; r < ROWS; ++r) {
+        for(int c = 0; c < COLUMNS; ++c) {
+            char field[32];
+            int64_t v = (int64_t)(test_rand(&state) << 33 ^ test_rand(&state) << 2 ^ test_rand(&state)) >> (r % 64);
+            snprintf(field, sizeof(field), "%" PRId64, v);
+            array_add(int64_t, want_ints, strtoll(field, NULL, 10));
+            array_str_append_cstr(text, field);
+            end_field(&text, &state, c);
+        }
+    }
+    array_parse_int64(text, ',', ints);
+    test_check(ints.error == ARRAY_OK_ERROR && ints.size == want_ints.size);
+    test_check(ints.size == want_ints.size && memcmp(ints.buf, want_ints.buf, sizeof(int64_t) * ints.size) == 0);
+
+    array_struct(double) want_doubles;
+    array_init(double, want_doubles, ROWS * COLUMNS);
+    text.size = 0;
+    for(int r = 0; r < ROWS; ++r) {
+        for(int c = 0; c < COLUMNS; ++c) {
+            char field[256];
+            array_add(double, want_doubles, random_double(&state, field, sizeof(field)));
+            array_str_append_cstr(text, field);
+            end_field(&text, &state, c);
+        }
+    }
+    array_parse_double(text, ',', doubles);
+    test_check(doubles.error == ARRAY_OK_ERROR && doubles.size == want_doubles.size);
+    test_check(doubles.size == want_doubles.size &&
+        memcmp(doubles.buf, want_doubles.buf, sizeof(double) * doubles.size) == 0);
+
+    /* Field ends line up with the text and count every field */
+    array_parse_offsets(text, ',', ends);
+    test_check(ends.error == ARRAY_OK_ERROR && ends.size == want_doubles.size);
+    int ends_ok = ends.size > 0;
+    for(uint64_t i = 0; ends_ok && i < ends.size; ++i) {
+        char c = text.buf[ends.buf[i]];
+        ends_ok = ends.buf[i] < text.size && (c == ',' || c == '\n') && (i == 0 || ends.buf[i] > ends.buf[i - 1]);
+    }
+    test_check(ends_ok);
+
+    /* A bad field in the last chunk still fails the whole parse */
+    text.buf[text.size - 3] = 'x';
+    array_parse_double(text, ',', doubles);
+    test_check(doubles.error == ARRAY_INVALID_DATA && doubles.size == 0);
+
+    array_free(want_doubles);
+    array_free(want_ints);
+    array_free(ends);
+    array_free(doubles);
+    array_free(ints);
+    array_free(text);
+    return test_result();
+}
@@ -0,0 +1,94 @@
+/* A small threshold so the count and scatter passes run on several threads */
+#define ARRAY_PARALLEL_THRESHOLD 4096
+#define ARRAY_THREADS 4
+
+#include "array_partition.h"
+#include "test.h"
+
+typedef struct {
+    uint32_t key;
+    uint32_t seq;
+} event;
+
+static uint64_t by_key(const void* elem, void* ctx) {
+    return ((const event*)elem)->key % *(const uint64_t*)ctx;
+}
+
+static uint64_t out_of_range(const void* elem, void* ctx) {
+    (void)ctx;
+    return ((const event*)elem)->seq == 5000 ? 1000 : 0;
+}
+
+int main(void) {
+    unsigned long long state = 29;
+    array_struct(event) events;
+    array_init(event, events, 1);
+    for(uint32_t i = 0; i < 100000; ++i) {
+        array_add(event, events, ((event){ (uint32_t)test_rand(&state), i }));
+    }
+
+    /* Large fan-outs shrink the buffers, the largest scatters without them */
+    uint64_t counts[] = { 1, 7, 300, 3000, 40000 };
+    for(size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        uint64_t parts = counts[c];
+        array_struct(event)* outs = malloc(sizeof(*outs) * parts);
+        for(uint64_t p = 0; p < parts; ++p) {
+            array_init(event, outs[p], 1);
+        }
+        array_add(event, outs[0], ((event){ 0, 0 }));
+        array_partition(event, events, outs, parts, by_key, &parts);
+
+        /* Each output holds its elements in their original order, and together they hold every element */
+        uint64_t total = 0;
+        int ok = 1;
+        for(uint64_t p = 0; p < parts; ++p) {
+            ok &= outs[p].error == ARRAY_OK_ERROR;
+            for(uint64_t i = 0; i < outs[p].size; ++i) {
+                ok &= outs[p].buf[i].key % parts == p;
+                ok &= i == 0 || outs[p].buf[i - 1].seq < outs[p].buf[i].seq;
+                ok &= events.buf[outs[p].buf[i].seq].key == outs[p].buf[i].key;
+            }
+            total += outs[p].size;
+        }
+        test_check(ok);
+        test_check(total == events.size);
+        for(uint64_t p = 0; p < parts; ++p) {
+            array_free(outs[p]);
+        }
+        free(outs);
+    }
+
+    /* Buffers of one thread never outgrow the limit, whatever the fan-out */
+    for(uint64_t parts = 1; parts < 100000; parts = parts * 3 + 1) {
+        uint64_t slots = array__partition_slots(sizeof(event), parts);
+        test_check(slots * sizeof(event) <= ARRAY_PARTITION_BUFFER);
+        test_check(slots < 2 || parts * slots * sizeof(event) <= ARRAY_PARTITION_BUFFER_LIMIT);
+    }
+    test_check(array__partition_slots(sizeof(event), 4) == ARRAY_PARTITION_BUFFER / sizeof(event));
+    test_check(array__partition_slots(sizeof(event), 40000) < 2);
+
+    /* A partition number out of range flags every output and changes nothing */
+    array_struct(event) outs[3];
+    for(int p = 0; p < 3; ++p) {
+        array_init(event, outs[p], 1);
+        array_add(event, outs[p], ((event){ 1, 2 }));
+    }
+    array_partition(event, events, outs, 3, out_of_range, NULL);
+    for(int p = 0; p < 3; ++p) {
+        test_check(outs[p].error == ARRAY_OUT_OF_BOUNDS);
+        test_check(outs[p].size == 1 && outs[p].buf[0].seq == 2);
+    }
+    test_check(events.error == ARRAY_OK_ERROR && events.size == 100000);
+
+    /* An output in an error state stops the whole call */
+    array_clear_error(outs[0]);
+    array_clear_error(outs[1]);
+    array_partition(event, events, outs, 3, by_key, &(uint64_t){ 3 });
+    test_check(outs[0].size == 1 && outs[1].size == 1);
+
+    for(int p = 0; p < 3; ++p) {
+        array_free(outs[p]);
+    }
+    array_free(events);
+    return test_result();
+}
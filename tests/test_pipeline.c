@@ -0,0 +1,89 @@
+#include "array_pipeline.h"
+#include "test.h"
+
+int main(void) {
+    array_struct(int) a;
+    array_init(int, a, 1);
+    for(int i = -50; i < 50; ++i) {
+        array_add(int, a, i);
+    }
+
+    long sum = 0;
+    int count = 0;
+    int low = 1000;
+    int high = -1000;
+    array_struct(double) halves;
+    array_init(double, halves, 1);
+    array_pipe(int, x, a,
+        array_pipe_filter(x % 2 == 0)
+        array_pipe_map(x, x * 3)
+        array_pipe_let(double, half, x / 2.0)
+        array_pipe_sum(sum, x)
+        array_pipe_count(count)
+        array_pipe_min(low, x)
+        array_pipe_max(high, x)
+        array_pipe_collect(double, halves, half));
+    test_check(count == 50);
+    test_check(sum == -150);
+    test_check(low == -150 && high == 144);
+    test_check(halves.size == 50 && halves.buf[0] == -75.0 && halves.buf[49] == 72.0);
+
+    /* Stages are braced blocks, so they can be the body of an if or else */
+    int positive = 0;
+    int negative = 0;
+    array_pipe(int, x, a,
+        if(x > 0)
+            array_pipe_count(positive)
+        else if(x < 0)
+            array_pipe_count(negative)
+        else
+            array_pipe_do((void)0));
+    test_check(positive == 49 && negative == 50);
+
+    long total = 0;
+    long peak = 0;
+    array_pipe_parallel(int, x, a, +:total,
+        array_pipe_filter(x > 0)
+        array_pipe_sum(total, x));
+    array_pipe_parallel(int, x, a, max:peak,
+        array_pipe_max(peak, (long)x * x));
+    test_check(total == 1225);
+    test_check(peak == 2500);
+
+    /* Chunked runs see every value once and the collected block never outgrows one chunk */
+    array_struct(int) block;
+    array_init(int, block, 8);
+    long chunked_sum = 0;
+    int chunks = 0;
+    uint64_t largest = 0;
+    array_pipe_chunked(int, x, a, 16,
+        array_pipe_filter(x % 3 != 0)
+        array_pipe_collect(int, block, x), {
+            ++chunks;
+            largest = block.size > largest ? block.size : largest;
+            for(uint64_t i = 0; i < block.size; ++i) {
+                chunked_sum += block.buf[i];
+            }
+            block.size = 0;
+        });
+    long expected_sum = 0;
+    for(int i = -50; i < 50; ++i) {
+        expected_sum += i % 3 != 0 ? i : 0;
+    }
+    test_check(chunks == 7 && largest <= 16 && chunked_sum == expected_sum);
+    test_check(block.error == ARRAY_OK_ERROR && block.capacity <= 16);
+
+    a.error = ARRAY_OUT_OF_MEM;
+    count = 0;
+    array_pipe(int, x, a, array_pipe_count(count));
+    test_check(count == 0);
+
+    chunks = 0;
+    array_pipe_chunked(int, x, a, 16, array_pipe_count(count), { ++chunks; });
+    test_check(chunks == 0 && count == 0);
+
+    array_free(a);
+    array_free(block);
+    array_free(halves);
+    return test_result();
+}
@@ -0,0 +1,38 @@
+#define ARRAY_PROFILE
+#include "array_profile.h"
+#include "test.h"
+
+static void make_arrays(int count, int size) {
+    for(int i = 0; i < count; ++i) {
+        array_struct(int) a;
+        /* The call site is matched by line, pin it so the expected entry does not move with edits */
+#line 9001
+        array_init_auto(int, a, 4);
+        for(int v = 0; v < size; ++v) {
+            array_add(int, a, v);
+        }
+        array_free(a);
+    }
+}
+
+int main(void) {
+    /* Nine arrays peak at 128 elements and one at 4096, the 90th percentile is 128 */
+    make_arrays(9, 100);
+    make_arrays(1, 3000);
+
+    FILE* out = tmpfile();
+    test_check(array_profile_dump(out) == 1);
+    char text[4096];
+    rewind(out);
+    size_t n = fread(text, 1, sizeof(text) - 1, out);
+    text[n] = '\0';
+    fclose(out);
+
+    char entry[512];
+    snprintf(entry, sizeof(entry), "{ \"%s\", 9001, 128, 10 }", __FILE__);
+    test_check(strstr(text, "#define ARRAY_PROFILE_ENTRIES") != NULL);
+    test_check(strstr(text, entry) != NULL);
+    test_check(strstr(text, "10 arrays, peak p50 128 p90 128 max 4096") != NULL);
+    test_check(array_profile_dump(NULL) == -1);
+    return test_result();
+}
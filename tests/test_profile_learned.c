@@ -0,0 +1,38 @@
+#include <stdint.h>
+
+/* What array_profile_dump would have written for the call sites pinned below */
+#define ARRAY_PROFILE_ENTRIES \
+    { "profile_site.c", 9001, 1000, 10 }, \
+    { "profile_site.c", 9002, UINT64_MAX, 1 }, \
+    { "profile_site.c", 9003, 1ull << 60, 1 },
+
+#include "array_profile.h"
+#include "test.h"
+
+int main(void) {
+    array_struct(int) learned, clamped, unaffordable, unknown;
+    /* Call sites are matched by file and line, pin both so the entries above do not move with edits */
+#line 9001 "profile_site.c"
+    array_init_auto(int, learned, 4);
+    array_init_auto(int, clamped, 4);
+    array_init_auto(int, unaffordable, 4);
+    array_init_auto(int, unknown, 4);
+#line 104 "test_profile_learned.c"
+    test_check(learned.error == ARRAY_OK_ERROR && learned.capacity == 1000 && learned.min_capacity == 1000);
+
+    /* A capacity whose bytes overflow is ignored, one that cannot be allocated falls back */
+    test_check(clamped.error == ARRAY_OK_ERROR && clamped.capacity == 4);
+    test_check(unaffordable.error == ARRAY_OK_ERROR && unaffordable.capacity == 4);
+    test_check(unknown.error == ARRAY_OK_ERROR && unknown.capacity == 4);
+
+    for(int i = 0; i < 1000; ++i) {
+        array_add(int, learned, i);
+    }
+    test_check(learned.capacity == 1000);
+
+    array_free(learned);
+    array_free(clamped);
+    array_free(unaffordable);
+    array_free(unknown);
+    return test_result();
+}
@@ -0,0 +1,98 @@
+/* A small threshold so the batches are split across several threads */
+#define ARRAY_PARALLEL_THRESHOLD 4096
+#define ARRAY_THREADS 4
+
+#include "array_query.h"
+#include "test.h"
+
+int main(void) {
+    unsigned long long state = 41;
+    array_struct(int32_t) price;
+    array_struct(int64_t) qty;
+    array_struct(float) score;
+    array_struct(double) weight;
+    array_init(int32_t, price, 1);
+    array_init(int64_t, qty, 1);
+    array_init(float, score, 1);
+    array_init(double, weight, 1);
+    for(int i = 0; i < 100003; ++i) {
+        array_add(int32_t, price, (int32_t)(test_rand(&state) % 40) - 5);
+        array_add(int64_t, qty, (int64_t)(test_rand(&state) % 300));
+        array_add(float, score, (float)(test_rand(&state) % 1000) / 8);
+        array_add(double, weight, (double)(test_rand(&state) % 6));
+    }
+
+    /* price < 10 and (qty > 100 or not weight == 3) */
+    array_column cols[] = { array_column_of(price), array_column_of(qty), array_column_of(score), array_column_of(weight) };
+    array_query_pred where[] = {
+        array_query_cmp(0, ARRAY_CMP_LT, 10), array_query_cmp(1, ARRAY_CMP_GT, 100),
+        array_query_cmp(3, ARRAY_CMP_EQ, 3), array_query_not(), array_query_or(), array_query_and()
+    };
+    array_query q = { cols, 4, where, 6 };
+    array_query_agg aggs[] = { { ARRAY_AGG_COUNT, 0 }, { ARRAY_AGG_SUM, 1 }, { ARRAY_AGG_MIN, 2 }, { ARRAY_AGG_MAX, 3 },
+        { ARRAY_AGG_SUM, 0 } };
+    double results[5];
+    test_check(array_query_aggregate(&q, aggs, 5, results) == ARRAY_OK_ERROR);
+
+    double count = 0, qty_sum = 0, score_min = INFINITY, weight_max = -INFINITY, price_sum = 0;
+    array_struct(uint64_t) expected;
+    array_init(uint64_t, expected, 1);
+    for(uint64_t i = 0; i < price.size; ++i) {
+        if(price.buf[i] < 10 && (qty.buf[i] > 100 || !(weight.buf[i] == 3))) {
+            ++count;
+            qty_sum += (double)qty.buf[i];
+            score_min = score.buf[i] < score_min ? score.buf[i] : score_min;
+            weight_max = weight.buf[i] > weight_max ? weight.buf[i] : weight_max;
+            price_sum += price.buf[i];
+            array_add(uint64_t, expected, i);
+        }
+    }
+    test_check(results[0] == count && results[1] == qty_sum && results[2] == score_min);
+    test_check(results[3] == weight_max && results[4] == price_sum);
+
+    array_struct(uint64_t) rows;
+    array_init(uint64_t, rows, 1);
+    array_query_select(&q, rows);
+    test_check(rows.error == ARRAY_OK_ERROR);
+    test_check(array_equal(rows, expected));
+
+    array_struct(double) qty_out;
+    array_init(double, qty_out, 1);
+    array_query_project(cols[1], rows, qty_out);
+    int ok = qty_out.size == rows.size;
+    for(uint64_t i = 0; ok && i < rows.size; ++i) {
+        ok &= qty_out.buf[i] == (double)qty.buf[rows.buf[i]];
+    }
+    test_check(ok);
+
+    /* Without predicates every row matches */
+    array_query all = { cols, 4, NULL, 0 };
+    test_check(array_query_aggregate(&all, aggs, 1, results) == ARRAY_OK_ERROR && results[0] == price.size);
+
+    array_query_pred dangling[] = { array_query_cmp(0, ARRAY_CMP_LT, 10), array_query_and() };
+    array_query bad = { cols, 4, dangling, 2 };
+    test_check(array_query_aggregate(&bad, aggs, 1, results) == ARRAY_INVALID_DATA);
+    array_query_pred missing[] = { array_query_cmp(9, ARRAY_CMP_LT, 10) };
+    bad.where = missing;
+    bad.nwhere = 1;
+    test_check(array_query_aggregate(&bad, aggs, 1, results) == ARRAY_OUT_OF_BOUNDS);
+    array_remove(double, weight);
+    cols[3] = array_column_of(weight);
+    array_query_select(&q, rows);
+    test_check(rows.error == ARRAY_SIZE_MISMATCH);
+
+    rows.size = 0;
+    array_clear_error(rows);
+    array_add(uint64_t, rows, weight.size);
+    array_query_project(cols[3], rows, qty_out);
+    test_check(qty_out.error == ARRAY_OUT_OF_BOUNDS);
+
+    array_free(price);
+    array_free(qty);
+    array_free(score);
+    array_free(weight);
+    array_free(expected);
+    array_free(rows);
+    array_free(qty_out);
+    return test_result();
+}
@@ -0,0 +1,61 @@
+#include "array_range.h"
+#include "test.h"
+
+int main(void) {
+    unsigned long long state = 19;
+    array_struct(int64_t) a;
+    array_init(int64_t, a, 1);
+    for(int i = 0; i < 1000; ++i) {
+        array_add(int64_t, a, (int64_t)(test_rand(&state) % 2000001) - 1000000);
+    }
+    array_range_index idx;
+    array_range_build(a, &idx);
+    test_check(idx.error == ARRAY_OK_ERROR);
+
+    /* Queries after every kind of mutation are compared against a scan of the range */
+    int ok = 1;
+    for(int step = 0; step < 20000; ++step) {
+        uint64_t at = a.size > 0 ? test_rand(&state) % a.size : 0;
+        int64_t v = (int64_t)(test_rand(&state) % 2000001) - 1000000;
+        switch(test_rand(&state) % 5) {
+        case 0: array_add(int64_t, a, v); break;
+        case 1: array_add_index(int64_t, a, at, v); break;
+        case 2: if(a.size > 0) { array_set(a, at, v); } break;
+        case 3: if(a.size > 0) { array_remove_index(int64_t, a, at); } break;
+        default: if(a.size > 0) { array_remove(int64_t, a); } break;
+        }
+        if(step % 5000 == 4999) {
+            array_fill(int64_t, a, a.size / 2 + 1, v);
+        }
+        uint64_t l = test_rand(&state) % (a.size + 1);
+        uint64_t r = l + test_rand(&state) % (a.size + 2 - l);
+        int64_t sum = 0;
+        int64_t min = INT64_MAX;
+        int64_t max = INT64_MIN;
+        for(uint64_t i = l; i < r && i < a.size; ++i) {
+            sum += a.buf[i];
+            min = a.buf[i] < min ? a.buf[i] : min;
+            max = a.buf[i] > max ? a.buf[i] : max;
+        }
+        ok &= array_range_sum(&idx, l, r) == sum;
+        ok &= array_range_min(&idx, l, r) == min;
+        ok &= array_range_max(&idx, l, r) == max;
+    }
+    test_check(ok);
+    test_check(idx.error == ARRAY_OK_ERROR);
+
+    /* Writes through buf are picked up by a rebuild */
+    for(uint64_t i = 0; i < a.size; ++i) {
+        a.buf[i] = (int64_t)i;
+    }
+    array_range_rebuild(a, &idx);
+    uint64_t n = a.size;
+    test_check(array_range_sum(&idx, 0, n) == (int64_t)(n * (n - 1) / 2));
+    test_check(array_range_min(&idx, 3, n) == 3 && array_range_max(&idx, 0, n + 100) == (int64_t)n - 1);
+    test_check(array_range_sum(&idx, 5, 5) == 0 && array_range_min(&idx, 5, 5) == INT64_MAX);
+
+    array_range_free(a, &idx);
+    test_check(a.hooks == NULL);
+    array_free(a);
+    return test_result();
+}
@@ -0,0 +1,107 @@
+#include <sys/wait.h>
+#include "array_shm.h"
+#include "test.h"
+
+int main(void) {
+    char name[64];
+    snprintf(name, sizeof(name), "/array-test-%ld", (long)getpid());
+    array_struct(int) table;
+    array_shm_create(int, table, name, 16);
+    test_check(table.error == ARRAY_OK_ERROR);
+    for(int i = 0; i < 100000; ++i) {
+        array_add(int, table, i);
+    }
+    test_check(table.error == ARRAY_OK_ERROR && table.size == 100000);
+
+    /* Another process maps the same pages by name */
+    pid_t child = fork();
+    if(child == 0) {
+        array_struct(int) view;
+        array_shm_attach(int, view, name, 0);
+        int ok = view.error == ARRAY_OK_ERROR && view.size == 100000;
+        for(uint64_t i = 0; ok && i < view.size; ++i) {
+            ok = view.buf[i] == (int)i;
+        }
+        array_free(view);
+        _exit(ok ? 0 : 1);
+    }
+    int status = 1;
+    test_check(child > 0 && waitpid(child, &status, 0) == child);
+    test_check(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    /* A reader sees appends and the growth of the segment once it refreshes */
+    array_struct(int) view;
+    array_shm_attach(int, view, name, 0);
+    test_check(view.error == ARRAY_OK_ERROR && view.size == 100000);
+    for(int i = 100000; i < 300000; ++i) {
+        array_add(int, table, i);
+    }
+    test_check(view.size == 100000);
+    array_shm_refresh(view);
+    test_check(view.error == ARRAY_OK_ERROR && view.size == 300000);
+    test_check(view.buf[299999] == 299999 && view.buf[0] == 0);
+    array_set(table, 5, -5);
+    test_check(view.buf[5] == -5);
+
+    /* A read only view cannot grow */
+    array_add(int, view, 1);
+    test_check(view.error == ARRAY_OUT_OF_MEM);
+    array_free(view);
+
+    /* A shared writer publishes its changes to the creator */
+    array_struct(int) writer;
+    array_shm_attach(int, writer, name, 1);
+    array_add(int, writer, 42);
+    array_shm_refresh(table);
+    test_check(table.size == 300001 && table.buf[300000] == 42);
+    array_free(writer);
+
+    /* A header from a faulty peer is refused and the view keeps what it saw last */
+    array_struct(int) reader;
+    array_shm_attach(int, reader, name, 0);
+    array__shm_header* head = (array__shm_header*)((unsigned char*)table.buf - ARRAY_SHM_HEADER);
+    uint64_t size = head->size;
+    uint64_t capacity = head->capacity;
+    head->size = capacity + 1;
+    array_shm_refresh(reader);
+    test_check(reader.error == ARRAY_INVALID_DATA && reader.size == 300001);
+    head->size = size;
+    uint64_t corrupt[] = { UINT64_MAX / 2, capacity * 4 };
+    for(int c = 0; c < 2; ++c) {
+        array_clear_error(reader);
+        head->capacity = corrupt[c];
+        array_shm_refresh(reader);
+        test_check(reader.error == ARRAY_INVALID_DATA && reader.size == 300001);
+    }
+    head->capacity = capacity;
+    array_clear_error(reader);
+    array_shm_refresh(reader);
+    test_check(reader.error == ARRAY_OK_ERROR && reader.buf[300000] == 42);
+    array_free(reader);
+
+    array_struct(int64_t) wide;
+    array_shm_attach(int64_t, wide, name, 0);
+    test_check(wide.error == ARRAY_SIZE_MISMATCH);
+
+    FILE* file = tmpfile();
+    fputs("not a shared array, just some text that is long enough to hold a header", file);
+    fflush(file);
+    array_struct(int) bogus;
+    array_shm_attach_fd(int, bogus, dup(fileno(file)), 0);
+    test_check(bogus.error == ARRAY_INVALID_DATA);
+    fclose(file);
+
+    array_struct(int) missing;
+    array_shm_attach(int, missing, "/array-test-missing", 0);
+    test_check(missing.error == ARRAY_IO_ERROR);
+
+    array_struct(int) plain;
+    array_init(int, plain, 1);
+    array_shm_refresh(plain);
+    test_check(plain.error == ARRAY_INVALID_DATA && array_shm_fd(plain) == -1);
+    array_free(plain);
+
+    array_free(table);
+    test_check(array_shm_unlink(name) == 0);
+    return test_result();
+}
@@ -0,0 +1,89 @@
+#include <sys/wait.h>
+#include "array_shm.h"
+#include "test.h"
+
+/* Sends a descriptor that is not a sealed array the way array_shm_send would */
+static void send_raw(int sock, int fd) {
+    test_check(array__shm_send(sock, fd) == ARRAY_OK_ERROR);
+}
+
+int main(void) {
+    int fds[2];
+    test_check(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+    array_struct(double) built;
+    array_shm_create(double, built, NULL, 4);
+    for(int i = 0; i < 10000; ++i) {
+        array_add(double, built, i * 0.5);
+    }
+    array_shm_seal(built);
+    test_check(built.error == ARRAY_OK_ERROR);
+    test_check(built.capacity == 10000 && built.buf[9999] == 4999.5);
+
+    /* Nothing can change a sealed segment, not even through its descriptor */
+    int fd = array_shm_fd(built);
+    test_check(ftruncate(fd, 1 << 20) != 0);
+    test_check(mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) == MAP_FAILED);
+    array_add(double, built, 1.0);
+    test_check(built.error == ARRAY_OUT_OF_MEM && built.size == 10000);
+    array_clear_error(built);
+    array_shm_seal(built);
+    test_check(built.error == ARRAY_INVALID_DATA);
+    array_clear_error(built);
+
+    /* The receiver maps the same pages in another process */
+    array_shm_send(built, fds[0]);
+    test_check(built.error == ARRAY_OK_ERROR);
+    pid_t child = fork();
+    if(child == 0) {
+        array_struct(double) view;
+        array_shm_recv(double, view, fds[1]);
+        int ok = view.error == ARRAY_OK_ERROR && view.size == 10000;
+        for(uint64_t i = 0; ok && i < view.size; ++i) {
+            ok = view.buf[i] == i * 0.5;
+        }
+        ok = ok && (fcntl(array_shm_fd(view), F_GETFD) & FD_CLOEXEC);
+        array_free(view);
+        _exit(ok ? 0 : 1);
+    }
+    int status = 1;
+    test_check(child > 0 && waitpid(child, &status, 0) == child);
+    test_check(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    /* A descriptor without every seal could still change under the receiver */
+    array_struct(double) view;
+    array_struct(double) unsealed;
+    array_shm_create(double, unsealed, NULL, 4);
+    array_add(double, unsealed, 1.0);
+    array_shm_send(unsealed, fds[0]);
+    array_shm_recv(double, view, fds[1]);
+    test_check(view.error == ARRAY_INVALID_DATA && view.buf == NULL);
+
+    FILE* file = tmpfile();
+    send_raw(fds[0], fileno(file));
+    array_shm_recv(double, view, fds[1]);
+    test_check(view.error == ARRAY_INVALID_DATA);
+    fclose(file);
+
+    array_shm_send(built, fds[0]);
+    array_struct(float) narrow;
+    array_shm_recv(float, narrow, fds[1]);
+    test_check(narrow.error == ARRAY_SIZE_MISMATCH);
+
+    /* A message without a descriptor is rejected */
+    test_check(write(fds[0], "x", 1) == 1);
+    array_shm_recv(double, view, fds[1]);
+    test_check(view.error == ARRAY_INVALID_DATA);
+
+    array_struct(double) plain;
+    array_init(double, plain, 1);
+    array_shm_seal(plain);
+    test_check(plain.error == ARRAY_INVALID_DATA);
+    array_free(plain);
+
+    array_free(unsealed);
+    array_free(built);
+    close(fds[0]);
+    close(fds[1]);
+    return test_result();
+}
@@ -0,0 +1,99 @@
+#include "array_simd.h"
+#include "test.h"
+
+/* Quarters of small integers keep every result exact, so each kernel must match plain C bit for bit */
+#define TEST_SIMD(T) do { \
+        array_struct(T) a, b, c, d; \
+        array_struct(uint8_t) mask; \
+        array_init(T, a, 1); \
+        array_init(T, b, 1); \
+        array_init(T, c, 1); \
+        array_init(T, d, 1); \
+        array_init(uint8_t, mask, 1); \
+        for(uint64_t i = 0; i < n; ++i) { \
+            array_add(T, a, (T)((int)(test_rand(&state) % 2001) - 1000) / 4); \
+            array_add(T, b, (T)((int)(test_rand(&state) % 2001) - 1000) / 4); \
+            array_add(T, c, (T)((int)(test_rand(&state) % 2001) - 1000) / 4); \
+        } \
+        int ok = 1; \
+        array_vadd(d, a, b); \
+        for(uint64_t i = 0; i < n; ++i) ok &= d.buf[i] == a.buf[i] + b.buf[i]; \
+        array_vsub(d, a, b); \
+        for(uint64_t i = 0; i < n; ++i) ok &= d.buf[i] == a.buf[i] - b.buf[i]; \
+        array_vmul(d, a, b); \
+        for(uint64_t i = 0; i < n; ++i) ok &= d.buf[i] == a.buf[i] * b.buf[i]; \
+        array_vfma(d, a, b, c); \
+        for(uint64_t i = 0; i < n; ++i) ok &= d.buf[i] == a.buf[i] * b.buf[i] + c.buf[i]; \
+        array_vscale(d, a, (T)0.5); \
+        for(uint64_t i = 0; i < n; ++i) ok &= d.buf[i] == a.buf[i] * (T)0.5; \
+        array_vadd_scalar(d, a, (T)3); \
+        for(uint64_t i = 0; i < n; ++i) ok &= d.buf[i] == a.buf[i] + (T)3; \
+        array_vclamp(d, a, (T)-10, (T)10); \
+        for(uint64_t i = 0; i < n; ++i) ok &= d.buf[i] == (a.buf[i] < -10 ? -10 : a.buf[i] > 10 ? 10 : a.buf[i]); \
+        array_vabs(d, a); \
+        for(uint64_t i = 0; i < n; ++i) ok &= d.buf[i] == (a.buf[i] < 0 ? -a.buf[i] : a.buf[i]); \
+        test_check(d.error == ARRAY_OK_ERROR && d.size == n); \
+        test_check(ok); \
+        for(int pred = ARRAY_CMP_EQ; pred <= ARRAY_CMP_GE; ++pred) { \
+            array_vcmp(mask, a, pred, b); \
+            ok = mask.size == n; \
+            for(uint64_t i = 0; i < n; ++i) { \
+                T x = a.buf[i], y = b.buf[i]; \
+                int want = pred == ARRAY_CMP_EQ ? x == y : pred == ARRAY_CMP_NE ? x != y : pred == ARRAY_CMP_LT ? x < y \
+                    : pred == ARRAY_CMP_LE ? x <= y : pred == ARRAY_CMP_GT ? x > y : x >= y; \
+                ok &= mask.buf[i] == want; \
+            } \
+            test_check(ok); \
+        } \
+        if(n > 0) { \
+            a.buf[n - 1] = (T)NAN; \
+            array_vclamp(d, a, (T)-10, (T)10); \
+            test_check(isnan(d.buf[n - 1])); \
+            array_vcmp_scalar(mask, a, ARRAY_CMP_NE, (T)0); \
+            test_check(mask.buf[n - 1] == 1); \
+            array_vcmp_scalar(mask, a, ARRAY_CMP_LT, (T)0); \
+            test_check(mask.buf[n - 1] == 0); \
+        } \
+        array_add(T, c, 0); \
+        array_vadd(d, a, c); \
+        test_check(d.error == ARRAY_SIZE_MISMATCH); \
+        array_free(a); \
+        array_free(b); \
+        array_free(c); \
+        array_free(d); \
+        array_free(mask); \
+    } while(0)
+
+int main(void) {
+    unsigned long long state = 7;
+    /* Sizes around the vector widths exercise the masked tails of every kernel */
+    uint64_t sizes[] = { 0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 33, 1003 };
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        uint64_t n = sizes[s];
+        TEST_SIMD(float);
+        TEST_SIMD(double);
+    }
+
+    /* An error already set on any array is kept, a size mismatch does not replace it */
+    array_struct(float) x, y;
+    array_struct(uint8_t) mask;
+    array_init(float, x, 4);
+    array_init(float, y, 4);
+    array_init(uint8_t, mask, 4);
+    array_fill(float, x, 3, 1.0f);
+    array_fill(float, y, 2, 1.0f);
+    mask.error = ARRAY_OUT_OF_MEM;
+    array_vcmp(mask, x, ARRAY_CMP_EQ, y);
+    test_check(mask.error == ARRAY_OUT_OF_MEM);
+    mask.error = ARRAY_OK_ERROR;
+    x.error = ARRAY_OUT_OF_BOUNDS;
+    array_vcmp(mask, x, ARRAY_CMP_EQ, y);
+    test_check(mask.error == ARRAY_OK_ERROR && x.error == ARRAY_OUT_OF_BOUNDS);
+    x.error = ARRAY_OK_ERROR;
+    array_vcmp(mask, x, ARRAY_CMP_EQ, y);
+    test_check(mask.error == ARRAY_SIZE_MISMATCH);
+    array_free(x);
+    array_free(y);
+    array_free(mask);
+    return test_result();
+}
@@ -0,0 +1,134 @@
+#include <math.h>
+#include "array_sort.h"
+#include "test.h"
+
+typedef struct {
+    int key;
+    int seq;
+} pair;
+
+static int pair_cmp(const void* a, const void* b) {
+    int x = ((const pair*)a)->key;
+    int y = ((const pair*)b)->key;
+    return (x > y) - (x < y);
+}
+
+/* Ascending values, and ascending indices among equal values since the sort is stable */
+#define TEST_SORTED(values, perm, ok) do { \
+        ok = perm.size == values.size; \
+        for(uint64_t i = 1; ok && i < perm.size; ++i) { \
+            ok &= values.buf[perm.buf[i - 1]] < values.buf[perm.buf[i]] || \
+                (values.buf[perm.buf[i - 1]] == values.buf[perm.buf[i]] && perm.buf[i - 1] < perm.buf[i]); \
+        } \
+    } while(0)
+
+int main(void) {
+    unsigned long long state = 23;
+    int ok;
+    array_struct(uint64_t) perm;
+    array_init(uint64_t, perm, 1);
+
+    array_struct(int) ints;
+    array_init(int, ints, 1);
+    for(int i = 0; i < 20000; ++i) {
+        array_add(int, ints, (int)(test_rand(&state) % 200) - 100);
+    }
+    array_add(int, ints, INT32_MIN);
+    array_add(int, ints, INT32_MAX);
+    array_argsort(ints, perm);
+    TEST_SORTED(ints, perm, ok);
+    test_check(ok);
+
+    array_struct(int64_t) wide;
+    array_init(int64_t, wide, 1);
+    for(int i = 0; i < 5000; ++i) {
+        array_add(int64_t, wide, (int64_t)(test_rand(&state) << 31 ^ test_rand(&state)) * (i % 2 ? -1 : 1));
+    }
+    array_add(int64_t, wide, INT64_MIN);
+    array_argsort(wide, perm);
+    TEST_SORTED(wide, perm, ok);
+    test_check(ok && perm.buf[0] == wide.size - 1);
+
+    array_struct(double) d;
+    array_init(double, d, 1);
+    double specials[] = { 1.5, -0.0, 0.0, -1e300, 1e300, INFINITY, -INFINITY, 0x1p-1074, -2.0, 1.5 };
+    for(size_t i = 0; i < sizeof(specials) / sizeof(specials[0]); ++i) {
+        array_add(double, d, specials[i]);
+    }
+    array_argsort(d, perm);
+    TEST_SORTED(d, perm, ok);
+    test_check(ok);
+    test_check(perm.buf[0] == 6 && perm.buf[9] == 5);
+    test_check(perm.buf[3] == 1 && perm.buf[4] == 2);
+
+    array_struct(unsigned char) bytes;
+    array_init(unsigned char, bytes, 1);
+    for(int i = 0; i < 1000; ++i) {
+        array_add(unsigned char, bytes, (unsigned char)test_rand(&state));
+    }
+    array_argsort(bytes, perm);
+    TEST_SORTED(bytes, perm, ok);
+    test_check(ok);
+
+    array_struct(pair) pairs;
+    array_init(pair, pairs, 1);
+    for(int i = 0; i < 3000; ++i) {
+        array_add(pair, pairs, ((pair){ (int)(test_rand(&state) % 50), i }));
+    }
+    array_argsort_by(pairs, perm, pair_cmp);
+    ok = perm.size == pairs.size;
+    for(uint64_t i = 1; ok && i < perm.size; ++i) {
+        pair x = pairs.buf[perm.buf[i - 1]];
+        pair y = pairs.buf[perm.buf[i]];
+        ok &= x.key < y.key || (x.key == y.key && x.seq < y.seq);
+    }
+    test_check(ok);
+
+    /* One permutation puts several parallel arrays in the same order */
+    array_struct(int) seqs;
+    array_init(int, seqs, 1);
+    array_foreach(pair, p, pairs) {
+        array_add(int, seqs, p.seq);
+    }
+    array_apply_permutation(pairs, perm);
+    array_apply_permutation(seqs, perm);
+    ok = pairs.error == ARRAY_OK_ERROR && seqs.error == ARRAY_OK_ERROR;
+    for(uint64_t i = 0; i < pairs.size; ++i) {
+        ok &= seqs.buf[i] == pairs.buf[i].seq && (i == 0 || pairs.buf[i - 1].key <= pairs.buf[i].key);
+    }
+    test_check(ok);
+
+    /* Invalid permutations are rejected before anything moves */
+    array_struct(int) copy;
+    array_clone(int, copy, seqs);
+    uint64_t saved = perm.buf[1];
+    perm.buf[1] = perm.buf[0];
+    array_apply_permutation(seqs, perm);
+    test_check(seqs.error == ARRAY_INVALID_DATA);
+    array_clear_error(seqs);
+    perm.buf[1] = perm.size;
+    array_apply_permutation(seqs, perm);
+    test_check(seqs.error == ARRAY_OUT_OF_BOUNDS);
+    array_clear_error(seqs);
+    perm.buf[1] = saved;
+    array_remove(int, seqs);
+    array_apply_permutation(seqs, perm);
+    test_check(seqs.error == ARRAY_SIZE_MISMATCH);
+    test_check(memcmp(seqs.buf, copy.buf, sizeof(int) * seqs.size) == 0);
+    /* The permutation is left unchanged by a rejected apply */
+    ok = 1;
+    for(uint64_t i = 0; i < perm.size; ++i) {
+        ok &= perm.buf[i] < perm.size;
+    }
+    test_check(ok);
+
+    array_free(perm);
+    array_free(ints);
+    array_free(wide);
+    array_free(d);
+    array_free(bytes);
+    array_free(pairs);
+    array_free(seqs);
+    array_free(copy);
+    return test_result();
+}
@@ -0,0 +1,125 @@
+#include <stdint.h>
+#include <unistd.h>
+#include "array_string.h"
+#include "test.h"
+
+#define is_text(a, text) (a.error == ARRAY_OK_ERROR && a.size == strlen(text) && memcmp(a.buf, text, a.size) == 0)
+
+static const char* format(double x) {
+    static char out[ARRAY__STR_DOUBLE_MAX + 1];
+    unsigned n = array__str_double(out, x);
+    out[n] = '\0';
+    return out;
+}
+
+/* Length of the shortest %g output that reads back as x */
+static size_t shortest_length(double x) {
+    char out[ARRAY__STR_DOUBLE_MAX];
+    for(int precision = 1; precision <= 17; ++precision) {
+        snprintf(out, sizeof(out), "%.*g", precision, x);
+        if(strtod(out, NULL) == x) {
+            break;
+        }
+    }
+    return strlen(out);
+}
+
+static void read_back(int fd, char* text, size_t max) {
+    ssize_t n = read(fd, text, max - 1);
+    text[n < 0 ? 0 : n] = '\0';
+}
+
+int main(void) {
+    array_struct(char) a;
+    array_init(char, a, 4);
+    array_str_append_cstr(a, "id=");
+    array_str_append_int(a, -42);
+    array_str_append(a, " n=", 3);
+    array_str_append_uint(a, 0);
+    array_str_append_cstr(a, " ");
+    array_str_append_int(a, INT64_MIN);
+    array_str_append_cstr(a, " ");
+    array_str_append_uint(a, UINT64_MAX);
+    test_check(is_text(a, "id=-42 n=0 -9223372036854775808 18446744073709551615"));
+    array_str_terminate(a);
+    test_check(a.error == ARRAY_OK_ERROR && strcmp(a.buf, "id=-42 n=0 -9223372036854775808 18446744073709551615") == 0);
+
+    /* Every integer width agrees with printf */
+    unsigned long long state = 1;
+    for(int i = 0; i < 100000; ++i) {
+        int64_t v = (int64_t)(test_rand(&state) << 33 ^ test_rand(&state)) >> (i % 64);
+        char expect[32];
+        snprintf(expect, sizeof(expect), "%lld", (long long)v);
+        a.size = 0;
+        array_str_append_int(a, v);
+        test_check(is_text(a, expect));
+    }
+
+    test_check(strcmp(format(0.1), "0.1") == 0);
+    test_check(strcmp(format(0.1 + 0.2), "0.30000000000000004") == 0);
+    test_check(strcmp(format(1e100), "1e+100") == 0);
+    test_check(strcmp(format(-2.5e-7), "-2.5e-07") == 0);
+    test_check(strcmp(format(0.0001), "0.0001") == 0);
+    test_check(strcmp(format(100000000000000.0), "100000000000000") == 0);
+    test_check(strcmp(format(1e15), "1e+15") == 0);
+    test_check(strcmp(format(0.0), "0") == 0);
+    test_check(strcmp(format(-0.0), "-0") == 0);
+    test_check(strcmp(format(5e-324), "5e-324") == 0);
+    test_check(strcmp(format(INFINITY), "inf") == 0);
+    test_check(strcmp(format(-INFINITY), "-inf") == 0);
+    test_check(strstr(format(NAN), "nan") != NULL);
+
+    /* Random bit patterns and short decimals read back exactly and are as short as the shortest %g */
+    for(int i = 0; i < 200000; ++i) {
+        uint64_t bits = test_rand(&state) << 33 ^ test_rand(&state) << 2 ^ test_rand(&state);
+        double x;
+        if(i & 1) {
+            memcpy(&x, &bits, sizeof(x));
+        }
+        else {
+            x = (double)(bits % 100000000) / array__str_pow10[bits % 9];
+        }
+        if(x != x) {
+            continue;
+        }
+        const char* text = format(x);
+        test_check(strtod(text, NULL) == x);
+        if(!(fabs(x) < 1e15 && x == (double)(int64_t)x)) {
+            test_check(strlen(text) == shortest_length(x));
+        }
+    }
+
+    /* Flushing writes every byte and empties the array */
+    int fds[2];
+    test_check(pipe(fds) == 0);
+    char text[256];
+    a.size = 0;
+    array_str_append_cstr(a, "hello ");
+    array_str_append_double(a, 1.5);
+    array_str_flush_at(a, fds[1], 64);
+    test_check(a.size == 9);
+    array_str_flush(a, fds[1]);
+    test_check(a.error == ARRAY_OK_ERROR && a.size == 0);
+    read_back(fds[0], text, sizeof(text));
+    test_check(strcmp(text, "hello 1.5") == 0);
+
+    /* Small writes are buffered, one that reaches the threshold goes out together with the buffer */
+    array_str_write(a, fds[1], "abc", 3, 8);
+    test_check(is_text(a, "abc"));
+    array_str_write(a, fds[1], "0123456789", 10, 8);
+    test_check(a.error == ARRAY_OK_ERROR && a.size == 0);
+    read_back(fds[0], text, sizeof(text));
+    test_check(strcmp(text, "abc0123456789") == 0);
+    close(fds[0]);
+    close(fds[1]);
+
+    /* A failed flush keeps the contents */
+    array_str_append_cstr(a, "kept");
+    array_str_flush(a, -1);
+    test_check(a.error == ARRAY_IO_ERROR && a.size == 4 && memcmp(a.buf, "kept", 4) == 0);
+    array_str_append_cstr(a, "ignored");
+    test_check(a.size == 4);
+    array_clear_error(a);
+    array_free(a);
+    return test_result();
+}
@@ -0,0 +1,68 @@
+#include "array_vm.h"
+#include "test.h"
+
+/* Counts the resident pages of [p, p + bytes) */
+static uint64_t resident_pages(const void* p, uint64_t bytes) {
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t)p / page * page;
+    uint64_t pages = ((uintptr_t)p + bytes - begin + page - 1) / page;
+    unsigned char* vec = malloc(pages);
+    uint64_t count = 0;
+    if(mincore((void*)begin, pages * page, vec) == 0) {
+        for(uint64_t i = 0; i < pages; ++i) {
+            count += vec[i] & 1;
+        }
+    }
+    free(vec);
+    return count;
+}
+
+int main(void) {
+    array_struct(uint64_t) a;
+    array_init(uint64_t, a, 1);
+    array_set_allocator(a, array_vm_allocator());
+    test_check(a.error == ARRAY_OK_ERROR);
+    for(uint64_t i = 0; i < (1 << 20); ++i) {
+        array_add(uint64_t, a, i * 3);
+    }
+    test_check(a.error == ARRAY_OK_ERROR && a.size == (1 << 20));
+    test_check((uintptr_t)a.buf % 64 == 0);
+    uint64_t* before = a.buf;
+    uint64_t full = resident_pages(a.buf, sizeof(uint64_t) * a.capacity);
+
+    /* Shrinking keeps the elements where they are and gives the pages past the capacity back */
+    while(a.size > 1000) {
+        array_remove(uint64_t, a);
+    }
+    test_check(a.buf == before);
+    test_check(a.capacity < 4096);
+    int ok = 1;
+    for(uint64_t i = 0; i < a.size; ++i) {
+        ok &= a.buf[i] == i * 3;
+    }
+    test_check(ok);
+    test_check(resident_pages(a.buf, sizeof(uint64_t) * (1 << 20)) < full / 64);
+
+    /* Growing again reuses the mapping, released pages come back zeroed and are rewritten */
+    for(uint64_t i = a.size; i < (1 << 20); ++i) {
+        array_add(uint64_t, a, i * 3);
+    }
+    test_check(a.buf == before);
+    ok = 1;
+    for(uint64_t i = 0; i < a.size; ++i) {
+        ok &= a.buf[i] == i * 3;
+    }
+    test_check(ok);
+
+    array_struct(uint64_t) b;
+    array_init(uint64_t, b, 1);
+    array_set_allocator(b, array_vm_allocator());
+    array_copy(uint64_t, b, a);
+    test_check(b.error == ARRAY_OK_ERROR && array_equal(a, b));
+    array_fill(uint64_t, b, 5000, 7);
+    test_check(b.size == 5000 && b.buf[4999] == 7);
+
+    array_free(a);
+    array_free(b);
+    return test_result();
+}
@@ -0,0 +1,41 @@
+#include "array.h"
+
+/*
+*   Loops that should auto-vectorize, compiled by check_vectorized.cmake with the compiler's
+*   vectorization report. Every line calling an iteration macro has to be reported as vectorized.
+*/
+
+typedef array_struct(int) int_array;
+typedef array_struct(float) float_array;
+
+int sum(int_array a) {
+    int s = 0;
+    array_foreach(int, x, a) { s += x; }
+    return s;
+}
+
+void scale(float_array a, float k) {
+    array_foreach_ptr(float, p, a) { *p *= k; }
+}
+
+int sum_reverse(int_array a) {
+    int s = 0;
+    array_foreach_reverse(int, x, a) { s += x; }
+    return s;
+}
+
+void halve_reverse(float_array a) {
+    array_foreach_ptr_reverse(float, p, a) { *p = *p * 0.5f + 1.0f; }
+}
+
+void axpy(float_array x, float_array y, float k) {
+    array_foreach_zip(i, x, y) { y.buf[i] += k * x.buf[i]; }
+}
+
+void add(float_array a, float_array b, float_array c) {
+    array_foreach_zip3(i, a, b, c) { c.buf[i] = a.buf[i] + b.buf[i]; }
+}
+
+void fma4(float_array a, float_array b, float_array c, float_array d) {
+    array_foreach_zip4(i, a, b, c, d) { d.buf[i] = a.buf[i] * b.buf[i] + c.buf[i]; }
+}